@@ -1,5 +1,10 @@
 #include "tests/test_camera.c"
 #include "tests/test_image.c"
+#include "tests/test_name_template.c"
+#include "tests/test_executor.c"
+#include "tests/test_ring_file.c"
+#include "tests/test_container.c"
+#include "tests/test_select.c"
 #include "lib/global.h"
 
 #include <check.h>
@@ -48,6 +53,11 @@ int main(
 	{
 		srunner_add_suite( runner, camera_suite() );
 		srunner_add_suite( runner, image_suite() );
+		srunner_add_suite( runner, name_template_suite() );
+		srunner_add_suite( runner, executor_suite() );
+		srunner_add_suite( runner, ring_file_suite() );
+		srunner_add_suite( runner, container_suite() );
+		srunner_add_suite( runner, select_suite() );
 	}
 	char* suite_name = NULL;
 	char* case_name = NULL;
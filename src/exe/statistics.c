@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <stdio.h> // <- work with files
 #include <string.h>
+#include <errno.h>
 #include <sys/syslog.h>
 
 
@@ -27,9 +28,10 @@ typedef struct {
  * Global Constants
 ********************/
 
-const char short_options[] = "h";
+const char short_options[] = "hp";
 const  struct option long_options[] = {
 	{ "help", no_argument, 0, 'h' },
+	{ "parse-log", no_argument, 0, 'p' },
 	{ 0,0,0,0 },
 };
 const char dev_name[] = "/dev/video0";
@@ -41,6 +43,10 @@ const uint iterations_save_img = 10;
 
 const char* output_dir = "local/output/statistics/imgs";
 
+// --parse-log: print these log files instead of running the benchmarks:
+static bool parse_log = false;
+static int log_files_index = 0;
+
 /********************
  * Function Decls
 ********************/
@@ -58,6 +64,13 @@ ret_t print_all_camera_modes(
 );
 ret_t print_platform_info();
 
+// print a binary log file written by
+// the log file sink (see 'lib/output.h') as text:
+// "<monotonic time in s> <level>: <message>"
+ret_t print_log_file(
+		const char* filename
+);
+
 
 void print_cmd_line_info(
 		// int argc,
@@ -105,6 +118,14 @@ int main(
 			return EXIT_FAILURE;
 		}
 	}
+	if( parse_log ) {
+		for( int i=log_files_index; i<argc; i++ ) {
+			if( RET_SUCCESS != print_log_file( argv[i] ) ) {
+				return EXIT_FAILURE;
+			}
+		}
+		return EXIT_SUCCESS;
+	}
 	log_init(
 			argv[0],
 			(log_config_t){
@@ -409,12 +430,64 @@ void program_exit( runtime_data_t* data )
 	camera_exit( &data->camera );
 }
 
+ret_t print_log_file(
+		const char* filename
+)
+{
+	FILE* file = fopen( filename, "rb" );
+	if( !file ) {
+		fprintf( stderr, "ERROR: '%s': %s\n", filename, strerror(errno) );
+		return RET_FAILURE;
+	}
+	log_file_header_t header;
+	if(
+			1 != fread( &header, sizeof(header), 1, file )
+			|| memcmp( header.magic, LOG_FILE_MAGIC, sizeof(header.magic) )
+	) {
+		fprintf( stderr, "ERROR: '%s': not a log file\n", filename );
+		fclose( file );
+		return RET_FAILURE;
+	}
+	printf( "# %s: monotonic %llu.%09llu = realtime %llu.%09llu\n",
+			filename,
+			(unsigned long long )(header.monotonic_ns / 1000000000),
+			(unsigned long long )(header.monotonic_ns % 1000000000),
+			(unsigned long long )(header.realtime_ns / 1000000000),
+			(unsigned long long )(header.realtime_ns % 1000000000)
+	);
+	char msg[STR_BUFFER_SIZE];
+	log_file_record_t record;
+	while( 1 == fread( &record, sizeof(record), 1, file ) ) {
+		if(
+				record.len >= STR_BUFFER_SIZE
+				|| record.len != fread( msg, 1, record.len, file )
+		) {
+			// the last record may be incomplete
+			// if the program has been killed:
+			fprintf( stderr, "WARNING: '%s': truncated record\n", filename );
+			break;
+		}
+		msg[record.len] = '\0';
+		const bool newline = (record.len > 0 && msg[record.len-1] == '\n');
+		printf( "%llu.%09llu %s: %s%s",
+				(unsigned long long )(record.time_ns / 1000000000),
+				(unsigned long long )(record.time_ns % 1000000000),
+				log_level_str( record.level ),
+				msg,
+				newline ? "" : "\n"
+		);
+	}
+	fclose( file );
+	return RET_SUCCESS;
+}
+
 void print_cmd_line_info(
 		// int argc,
 		char* argv[]
 )
 {
-	printf( "usage: %s\n", argv[0] );
+	printf( "usage: %s [--parse-log|-p FILE...]\n", argv[0] );
+	printf( "--parse-log|-p FILE...: print log files written with 'synchronome --log-file' as text\n" );
 }
 
 int parse_cmd_line_args(
@@ -436,7 +509,14 @@ int parse_cmd_line_args(
 			case 'h':
 				return -1;
 			break;
+			case 'p':
+				parse_log = true;
+			break;
+			case '?':
+				return 1;
+			break;
 		}
 	}
+	log_files_index = optind;
 	return 0;
 }
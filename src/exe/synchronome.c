@@ -35,17 +35,37 @@ typedef enum {
 // synchronome:
 
 static const synchronome_args_t synchronome_def_args = {
+	.dev_names = { "/dev/video0" },
+	.camera_count = 1,
 	.pixel_format = V4L2_PIX_FMT_YUYV,
 	.output_dir = "local/output/synchronome",
+	.mode_cache_dir = NULL,
 	.acq_interval = { 1, 3 },
 	.clock_tick_interval = { 1, 1 },
 	.tick_threshold = 0.15,
+	.tick_estimator = TICK_ESTIMATOR_VOTE,
+	.fast_start = false,
 	.max_frames = -1,
 	.size = {
 			.width = 320,
 			.height = 240,
 	},
 	.compress_bundle_size = 0,
+	.compress_keyframe_interval = 0,
+	.output_format = OUTPUT_FORMAT_RGB,
+	.output_size = {
+			.width = 0,
+			.height = 0,
+	},
+	.container = false,
+	.container_max_size_mb = 1024,
+	.container_max_frames = 0,
+	.ring_file_slots = 0,
+	.shard_frames = 0,
+	.shard_hourly = false,
+	.atomic_files = false,
+	.wait_strategy = WAIT_BLOCK,
+	.spin_us = 50,
 };
 
 static const log_config_t log_def_config= {
@@ -59,18 +79,38 @@ static const log_config_t log_def_config= {
 	.warning_enable_log = true,
 	.error_enable_print = true,
 	.error_enable_log = true,
+	.file_path = NULL,
+	.file_max_size = 64*1024*1024,
+	.file_max_count = 8,
 };
 
 const char synchronome_short_options[] = "ho:s:a:c:t:n:v";
 const  struct option synchronome_long_options[] = {
 	{ "help", no_argument, 0, 'h' },
 	{ "output-dir", required_argument, 0, 'o' },
+	{ "camera", required_argument, 0, 0 },
 	{ "size", required_argument, 0, 's' },
 	{ "acq-interval", required_argument, 0, 'a' },
 	{ "clock-tick", required_argument, 0, 'c' },
 	{ "tick-thresh", required_argument, 0, 't' },
 	{ "max-frames", required_argument, 0, 'n' },
 	{ "compress", required_argument, 0, 0 },
+	{ "compress-keyframe", required_argument, 0, 0 },
+	{ "pll", no_argument, 0, 0 },
+	{ "fast-start", no_argument, 0, 0 },
+	{ "format", required_argument, 0, 0 },
+	{ "output-format", required_argument, 0, 0 },
+	{ "output-size", required_argument, 0, 0 },
+	{ "container", no_argument, 0, 0 },
+	{ "container-size", required_argument, 0, 0 },
+	{ "container-frames", required_argument, 0, 0 },
+	{ "ring-file", required_argument, 0, 0 },
+	{ "shard", required_argument, 0, 0 },
+	{ "shard-hourly", no_argument, 0, 0 },
+	{ "atomic-files", no_argument, 0, 0 },
+	{ "wait-strategy", required_argument, 0, 0 },
+	{ "spin-us", required_argument, 0, 0 },
+	{ "mode-cache", required_argument, 0, 0 },
 	// logging:
 	{ "verbose", no_argument, 0, 'v' },
 	{ "error-print", required_argument, 0, 0 },
@@ -83,6 +123,9 @@ const  struct option synchronome_long_options[] = {
 	{ "verbose-log", required_argument, 0, 0 },
 	{ "timing-print", required_argument, 0, 0 },
 	{ "timing-log", required_argument, 0, 0 },
+	{ "log-file", required_argument, 0, 0 },
+	{ "log-file-size", required_argument, 0, 0 },
+	{ "log-file-count", required_argument, 0, 0 },
 	{ 0,0,0,0 },
 };
 
@@ -217,10 +260,13 @@ int main(
 					return EXIT_FAILURE;
 				}
 			}
-			log_init(
+			if( RET_SUCCESS != log_init(
 					LOG_PREFIX,
 					log_config
-			);
+			) ) {
+				log_exit();
+				return EXIT_FAILURE;
+			}
 			{
 				struct sigaction sa;
 				memset( &sa, 0, sizeof(sa));
@@ -376,6 +422,8 @@ int synchronome_parse_cmd_line_args(
 	// - opterr: if 1, getop_long automatically prints errors
 	// - optopt: erroneous opt char (if error)
 	int option_index = 0;
+	// the first --camera replaces the default camera:
+	bool camera_set = false;
 	while( true ) {
 		int c = getopt_long(
 				argc, argv,
@@ -387,7 +435,18 @@ int synchronome_parse_cmd_line_args(
 		switch( c ) {
 			case 0: {
 				struct option long_option = synchronome_long_options[option_index];
-				if( !strcmp("compress", long_option.name) ) {
+				if( !strcmp("camera", long_option.name) ) {
+					if( !camera_set ) {
+						args->camera_count = 0;
+						camera_set = true;
+					}
+					if( args->camera_count >= SYNCHRONOME_MAX_CAMERAS ) {
+						log_error( "too many cameras (max: %u)\n", SYNCHRONOME_MAX_CAMERAS );
+						return 1;
+					}
+					args->dev_names[args->camera_count++] = optarg;
+				}
+				else if( !strcmp("compress", long_option.name) ) {
 					char* next_tok;
 					args->compress_bundle_size = strtol(optarg, &next_tok, 10);
 					if( next_tok == optarg) {
@@ -395,6 +454,109 @@ int synchronome_parse_cmd_line_args(
 						return 1;
 					}
 				}
+				else if( !strcmp("compress-keyframe", long_option.name) ) {
+					char* next_tok;
+					args->compress_keyframe_interval = strtol(optarg, &next_tok, 10);
+					if( next_tok == optarg) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("pll", long_option.name) ) {
+					args->tick_estimator = TICK_ESTIMATOR_PLL;
+				}
+				else if( !strcmp("fast-start", long_option.name) ) {
+					args->fast_start = true;
+				}
+				else if( !strcmp("format", long_option.name) ) {
+					args->pixel_format = image_pixel_format_from_str( optarg );
+					if( args->pixel_format == 0 ) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("output-format", long_option.name) ) {
+					if( !strcmp("rgb", optarg) ) {
+						args->output_format = OUTPUT_FORMAT_RGB;
+					}
+					else if( !strcmp("yuv420", optarg) ) {
+						args->output_format = OUTPUT_FORMAT_YUV420;
+					}
+					else if( !strcmp("jpeg", optarg) ) {
+						args->output_format = OUTPUT_FORMAT_JPEG;
+					}
+					else if( !strcmp("gray", optarg) ) {
+						args->output_format = OUTPUT_FORMAT_GRAY;
+					}
+					else {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("output-size", long_option.name) ) {
+					if( RET_SUCCESS != parse_2_toks(optarg, 'x', &args->output_size.width, &args->output_size.height) ) {
+						log_error( "invalid format. expected: WxH\n" );
+						return 1;
+					}
+				}
+				else if( !strcmp("container", long_option.name) ) {
+					args->container = true;
+				}
+				else if( !strcmp("container-size", long_option.name) ) {
+					char* next_tok;
+					args->container_max_size_mb = strtol(optarg, &next_tok, 10);
+					if( next_tok == optarg) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("container-frames", long_option.name) ) {
+					char* next_tok;
+					args->container_max_frames = strtol(optarg, &next_tok, 10);
+					if( next_tok == optarg) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("wait-strategy", long_option.name) ) {
+					if( RET_SUCCESS != wait_strategy_from_str( optarg, &args->wait_strategy ) ) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("spin-us", long_option.name) ) {
+					char* next_tok;
+					args->spin_us = strtol(optarg, &next_tok, 10);
+					if( next_tok == optarg) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("mode-cache", long_option.name) ) {
+					args->mode_cache_dir = optarg;
+				}
+				else if( !strcmp("ring-file", long_option.name) ) {
+					char* next_tok;
+					args->ring_file_slots = strtol(optarg, &next_tok, 10);
+					if( next_tok == optarg) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("shard", long_option.name) ) {
+					char* next_tok;
+					args->shard_frames = strtol(optarg, &next_tok, 10);
+					if( next_tok == optarg) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
+				else if( !strcmp("shard-hourly", long_option.name) ) {
+					args->shard_hourly = true;
+				}
+				else if( !strcmp("atomic-files", long_option.name) ) {
+					args->atomic_files = true;
+				}
 				else if( !strcmp("error-print", long_option.name) ) {
 					char* next_tok;
 					log_config->error_enable_print = (bool )strtol(optarg, &next_tok, 10);
@@ -475,6 +637,26 @@ int synchronome_parse_cmd_line_args(
 						return 1;
 					}
 				}
+				else if( !strcmp("log-file", long_option.name) ) {
+					log_config->file_path = optarg;
+				}
+				else if( !strcmp("log-file-size", long_option.name) ) {
+					char* next_tok;
+					const long size_mb = strtol(optarg, &next_tok, 10);
+					if( next_tok == optarg || size_mb < 0 ) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+					log_config->file_max_size = (size_t )size_mb * 1024 * 1024;
+				}
+				else if( !strcmp("log-file-count", long_option.name) ) {
+					char* next_tok;
+					log_config->file_max_count = strtol(optarg, &next_tok, 10);
+					if( next_tok == optarg) {
+						log_error( "invalid argument for %s\n", long_option.name );
+						return 1;
+					}
+				}
 			}
 			break;
 			case 'h':
@@ -539,6 +721,30 @@ int synchronome_parse_cmd_line_args(
 		log_error( "unexpected argument %s\n", argv[optind] );
 		return 1;
 	}
+	if( args->shard_frames > 0 || args->shard_hourly || args->atomic_files ) {
+		if( args->container || args->ring_file_slots > 0 ) {
+			log_error( "--shard, --shard-hourly and --atomic-files only apply to one file per frame\n" );
+			return 1;
+		}
+		if( args->shard_frames > 0 && args->shard_hourly ) {
+			log_error( "--shard and --shard-hourly are exclusive\n" );
+			return 1;
+		}
+	}
+	if( args->output_format == OUTPUT_FORMAT_JPEG ) {
+		if( args->pixel_format != V4L2_PIX_FMT_MJPEG ) {
+			log_error( "--output-format jpeg requires --format mjpeg\n" );
+			return 1;
+		}
+		if( args->ring_file_slots > 0 || args->compress_keyframe_interval > 0 ) {
+			log_error( "--output-format jpeg: --ring-file and --compress-keyframe not supported\n" );
+			return 1;
+		}
+		if( args->output_size.width > 0 ) {
+			log_error( "--output-format jpeg: --output-size not supported\n" );
+			return 1;
+		}
+	}
 	return 0;
 }
 
@@ -560,6 +766,11 @@ void synchronome_print_cmd_line_info(
 			"\n"
 			"OPTIONS:\n"
 	);
+	printf(
+			"--camera DEV: capture from this device. May be repeated to watch several clocks (max: %u), frames of camera N are stored in 'OUTPUT_DIR/camN'. default: %s\n",
+			SYNCHRONOME_MAX_CAMERAS,
+			synchronome_def_args.dev_names[0]
+	);
 	printf(
 			"--size|-s SIZE_DESCR: image size. Format WxH. default: 320x240\n"
 	);
@@ -577,6 +788,12 @@ void synchronome_print_cmd_line_info(
 			"--tick-thresh|-t FLOAT: threshold for tick detection (fraction of (max-avg)). default: %f\n",
 			synchronome_def_args.tick_threshold
 	);
+	printf(
+			"--pll: track tick phase and period with a PLL instead of correcting drift by whole frames. Needs only 2 (instead of 3) frames per tick\n"
+	);
+	printf(
+			"--fast-start: seed the image diff statistics from a burst of frames at the native camera rate and confirm sync after 2 instead of 4 ticks\n"
+	);
 	printf(
 			"--max-frames|-n NUMBER: number of frames select (-1 means no limit). default: %d\n",
 			synchronome_def_args.max_frames
@@ -585,6 +802,57 @@ void synchronome_print_cmd_line_info(
 			"--compress FRAMES_COUNT: compress into archives containing FRAMES_COUNT frames (0 means disabled). default: %d\n",
 			synchronome_def_args.compress_bundle_size
 	);
+	printf(
+			"--compress-keyframe FRAMES_COUNT: in archives, store every FRAMES_COUNT'th frame as is and the frames in between XORed with their predecessor (0 means disabled). default: %d\n",
+			synchronome_def_args.compress_keyframe_interval
+	);
+	printf(
+			"--format FORMAT: camera pixel format. 'yuyv': uncompressed, 'nv12', 'yu12': uncompressed 4:2:0, 'grey': luma only, 'mjpeg': compressed (higher resolutions and frame rates over USB, select only decodes the DC coefficients). default: %s\n",
+			image_pixel_format_str( synchronome_def_args.pixel_format )
+	);
+	printf(
+			"--output-format FORMAT: format of converted frames. 'rgb': save .ppm files, 'yuv420': save .y4m files (half the size), 'jpeg': save the camera's frames as .jpg files without decoding (requires --format mjpeg), 'gray': save the luma as .pgm files (a third of rgb, requires a YUV or MJPEG --format). default: %s\n",
+			image_output_format_str( synchronome_def_args.output_format )
+	);
+	printf(
+			"--output-size WxH: downscale converted frames to WxH (2x, 4x: averaging, otherwise bilinear, not for 'jpeg'). default: capture size\n"
+	);
+	printf(
+			"--container: append frames to container files (.y4m, multi image .ppm or .mjpeg, plus .idx index) instead of writing one file per frame\n"
+	);
+	printf(
+			"--container-size MiB: start a new container file after MiB MiB (0 means no limit). default: %u\n",
+			synchronome_def_args.container_max_size_mb
+	);
+	printf(
+			"--container-frames FRAMES_COUNT: start a new container file after FRAMES_COUNT frames (0 means no limit). default: %u\n",
+			synchronome_def_args.container_max_frames
+	);
+	printf(
+			"--ring-file FRAMES_COUNT: write frames into a preallocated, memory mapped ring file ('OUTPUT_DIR/frames.ring') keeping the last FRAMES_COUNT frames (0 means disabled). default: %u\n",
+			synchronome_def_args.ring_file_slots
+	);
+	printf(
+			"--shard FRAMES_COUNT: write every FRAMES_COUNT frames into a new subdirectory ('OUTPUT_DIR/NNNNNN', 0 means disabled). default: %u\n",
+			synchronome_def_args.shard_frames
+	);
+	printf(
+			"--shard-hourly: write frames into one subdirectory per hour ('OUTPUT_DIR/YYYYMMDD_HH', UTC)\n"
+	);
+	printf(
+			"--atomic-files: write frames into unnamed files (O_TMPFILE) and link them when complete, readers never see partial files\n"
+	);
+	printf(
+			"--wait-strategy STRATEGY: how select waits for input (convert always sleeps). 'block': sleep in sem_wait, 'spin': busy wait (only for isolated cpus, select must not share its cpu with other cameras), 'spin-block': busy wait for --spin-us, then sleep. default: %s\n",
+			wait_strategy_str( synchronome_def_args.wait_strategy )
+	);
+	printf(
+			"--spin-us USEC: busy wait budget for 'spin-block'. default: %u\n",
+			synchronome_def_args.spin_us
+	);
+	printf(
+			"--mode-cache DIR: cache the supported camera modes in DIR to speed up startup, '': don't cache. default: OUTPUT_DIR\n"
+	);
 	printf(
 			"--verbose|-v: show verbose messages (stdout + log)\n"
 	);
@@ -628,6 +896,17 @@ void synchronome_print_cmd_line_info(
 			"--timing-log BOOL: print profiling messages to log. default: %u\n",
 			log_def_config.time_enable_log
 	);
+	printf(
+			"--log-file PATH: log to binary files 'PATH.0', 'PATH.1', ... instead of syslog. Read them with 'statistics --parse-log'\n"
+	);
+	printf(
+			"--log-file-size MB: start a new log file after this size, 0: never. default: %zu\n",
+			log_def_config.file_max_size / (1024*1024)
+	);
+	printf(
+			"--log-file-count N: keep the last N log files, 0: all. default: %u\n",
+			log_def_config.file_max_count
+	);
 	printf(
 			"--output-dir|-o DIR: output recorded images here. default: '%s'\n",
 			synchronome_def_args.output_dir
@@ -639,6 +918,9 @@ void synchronome_print_args(
 )
 {
 	log_verbose( "selected settings:\n" );
+	for( uint i=0; i<args->camera_count; i++ ) {
+		log_verbose( "camera %u: %s\n", i, args->dev_names[i] );
+	}
 	log_verbose( "size: %ux%u\n", args->size.width, args->size.height );
 	log_verbose( "acquisition interval (in s): %u/%u\n",
 			args->acq_interval.numerator,
@@ -648,7 +930,20 @@ void synchronome_print_args(
 			args->clock_tick_interval.numerator,
 			args->clock_tick_interval.denominator
 	);
+	log_verbose( "tick estimator: %s\n", select_tick_estimator_str( args->tick_estimator ) );
+	log_verbose( "fast start: %s\n", args->fast_start ? "yes" : "no" );
+	log_verbose( "wait strategy: %s\n", wait_strategy_str( args->wait_strategy ) );
 	log_verbose( "output dir: %s\n", args->output_dir );
+	log_verbose( "mode cache dir: %s\n",
+			args->mode_cache_dir == NULL ? args->output_dir
+			: args->mode_cache_dir[0] == '\0' ? "(none)"
+			: args->mode_cache_dir
+	);
+	log_verbose( "camera format: %s\n", image_pixel_format_str( args->pixel_format ) );
+	log_verbose( "output format: %s\n", image_output_format_str( args->output_format ) );
+	if( args->output_size.width > 0 ) {
+		log_verbose( "output size: %ux%u\n", args->output_size.width, args->output_size.height );
+	}
 }
 
 // capture:
@@ -1,6 +1,16 @@
 /************************
  * compress multiple frames
  * into zip files
+ *
+ * delta mode (keyframe_interval > 0):
+ * only every keyframe_interval'th frame of a package
+ * is stored as is ("imageNNNN.ppm"). The frames in between
+ * are stored XORed with their predecessor ("imageNNNN.xor.ppm",
+ * second comment line names the reference).
+ * Static image regions become zero and deflate very well.
+ *
+ * JPEG frames are stored as is ("imageNNNN.jpg"),
+ * delta mode does not apply.
  ************************/
 #include "compressor.h"
 
@@ -9,16 +19,13 @@
 #include "lib/image.h"
 #include "lib/output.h"
 #include "lib/global.h"
-#include "lib/thread.h"
+#include "lib/zip_stream.h"
 
-#include <semaphore.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
 
-#include <zip.h>
-
 // sockets:
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -26,16 +33,6 @@
 #include <arpa/inet.h>
 
 
-/********************
- * Types
-********************/
-
-typedef struct {
-	char arch_filename[STR_BUFFER_SIZE];
-	zip_t* zip_archive;
-	FILE* mem_file;
-} data_t;
-
 /********************
  * Function Decls
 ********************/
@@ -49,146 +46,299 @@ typedef struct {
 #define API_RUN( FUNC_CALL ) { \
 	if( RET_SUCCESS != FUNC_CALL ) { \
 		LOG_ERROR( "error in '%s'\n", #FUNC_CALL ); \
-		compressor_cleanup(); \
+		compressor_cleanup( compressor ); \
 		return RET_FAILURE; \
 	} \
 }
 
-ret_t compressor_cleanup();
+// fields of the templates,
+// in the order they are appended:
+enum {
+	NAME_PACKAGE,
+	NAME_COUNTER,
+};
+
+enum {
+	HEADER_TIME, // + milliseconds
+	HEADER_REFERENCE = HEADER_TIME + 2, // xor_header only
+};
+
+// close the current archive:
+ret_t compressor_cleanup(
+		compressor_t* compressor
+);
+
+ret_t compressor_init_templates(
+		compressor_t* compressor
+);
 
-static data_t data;
+void compressor_init_entry_name(
+		name_template_t* name,
+		const char* ext
+);
+
+// add the frame as is ("imageNNNN.jpg"),
+// no delta mode:
+ret_t compressor_add_jpeg(
+		compressor_t* compressor,
+		const rgb_entry_t* frame
+);
+
+// dst = src XOR prev, prev = src
+void compressor_delta_encode(
+		const byte_t* src,
+		byte_t* prev,
+		byte_t* dst,
+		const size_t size
+);
 
 /********************
  * API Def
 ********************/
 
-ret_t compressor_run(
-		const compressor_args_t args,
-		rgb_consumers_queue_t* input_queue,
-		sem_t* done_processing
+ret_t compressor_init(
+		compressor_t* compressor,
+		const compressor_args_t args
 )
 {
-	thread_info( SERVICE_NAME );
-
-	uint counter = 0;
-	uint package_counter = 0;
-	uint frame_acc_count = 0;
-	char timestamp_str[STR_BUFFER_SIZE];
-	while(true) {
-		rgb_consumers_queue_read_start( input_queue );
-		if(
-				rgb_consumers_queue_get_should_stop( input_queue )
-				&& rgb_consumers_queue_get_count( input_queue ) == 0
-		) {
-			LOG_VERBOSE( "stop received\n" );
-			break;
-		}
-		frame_acc_count++;
-		LOG_VERBOSE( "received %u\n", counter );
- 		// open archive:
-		if( data.zip_archive == NULL )
-		{
-			snprintf( data.arch_filename, STR_BUFFER_SIZE, "%s/package%04u.zip", args.shared_dir, package_counter);
-			LOG_VERBOSE( "creating archive: %s\n", data.arch_filename );
-			int err;
-			data.zip_archive = zip_open( data.arch_filename, ZIP_CREATE | ZIP_TRUNCATE | ZIP_CHECKCONS, &err );
-			if( data.zip_archive == NULL ) {
-				zip_error_t error;
-				zip_error_init_with_code(&error, err);
-				LOG_ERROR("cannot open zip archive '%s': %s\n",
-						data.arch_filename, zip_error_strerror(&error)
-				);
-				zip_error_fini(&error);
-				compressor_cleanup();
-				return RET_FAILURE;
-			}
+	(*compressor) = (compressor_t){ .args = args };
+	API_RUN( compressor_init_templates( compressor ) );
+	if( args.format == OUTPUT_FORMAT_YUV420 ) {
+		compressor->rgb_buffer_size = image_rgb_size( args.image_size.width, args.image_size.height );
+		CALLOC( compressor->rgb_buffer, compressor->rgb_buffer_size, 1 );
+	}
+	if( args.keyframe_interval > 0 ) {
+		const size_t size = image_rgb_size( args.image_size.width, args.image_size.height );
+		CALLOC( compressor->prev_frame, size, 1 );
+		CALLOC( compressor->delta_buffer, size, 1 );
+	}
+	return RET_SUCCESS;
+}
+
+ret_t compressor_exit(
+		compressor_t* compressor
+)
+{
+	LOG_VERBOSE( "stopping\n" );
+	const ret_t ret = compressor_cleanup( compressor );
+	FREE( compressor->rgb_buffer );
+	FREE( compressor->prev_frame );
+	FREE( compressor->delta_buffer );
+	return ret;
+}
+
+ret_t compressor_frame(
+		compressor_t* compressor,
+		const rgb_entry_t* frame
+)
+{
+	const compressor_args_t* args = &compressor->args;
+	compressor->frame_acc_count++;
+	LOG_VERBOSE( "received %u\n", compressor->counter );
+	// open archive:
+	if( compressor->zip_archive.file == NULL )
+	{
+		snprintf( compressor->arch_filename, STR_BUFFER_SIZE, "%s/package%04u.zip", args->shared_dir, compressor->package_counter);
+		LOG_VERBOSE( "creating archive: %s\n", compressor->arch_filename );
+		API_RUN( zip_stream_open(
+				&compressor->zip_archive,
+				compressor->arch_filename,
+				args->package_size,
+				Z_DEFAULT_COMPRESSION
+		) );
+	}
+	// add file to archive:
+	if( args->format == OUTPUT_FORMAT_JPEG ) {
+		API_RUN( compressor_add_jpeg( compressor, frame ) );
+	}
+	else {
+		const bool gray = (args->format == OUTPUT_FORMAT_GRAY);
+		const byte_t* rgb_data = frame->frame.data;
+		uint rgb_size = frame->frame.size;
+		if( args->format == OUTPUT_FORMAT_YUV420 ) {
+			API_RUN( image_yuv420_to_rgb(
+					args->image_size.width,
+					args->image_size.height,
+					frame->frame.data,
+					frame->frame.size,
+					compressor->rgb_buffer,
+					compressor->rgb_buffer_size
+			) );
+			rgb_data = compressor->rgb_buffer;
+			rgb_size = compressor->rgb_buffer_size;
 		}
-		// add file to archive:
-		{
-			rgb_entry_t* frame = *rgb_consumers_queue_read_get( input_queue );
-			// add all accumulated images to archive:
-			char filename[STR_BUFFER_SIZE] = "";
-			snprintf( filename, STR_BUFFER_SIZE, "package%04u/image%04u.ppm", package_counter, counter );
-			LOG_VERBOSE( "adding file: %s\n", filename );
-
-			char* file_content = NULL;
-			size_t file_size = 0;
-			data.mem_file = open_memstream(&file_content, &file_size);
-			if( data.mem_file == NULL ) {
-				LOG_ERROR_STD_LIB(open_memstream);
-				compressor_cleanup();
-				return RET_FAILURE;
-			}
-			snprintf(timestamp_str, STR_BUFFER_SIZE, "%lu.%lu",
-					frame->time.tv_sec,
-					frame->time.tv_nsec / 1000 / 1000
-			);
-			API_RUN( image_save_ppm_to_ram(
-						filename,
-						timestamp_str,
-						frame->frame.data,
-						frame->frame.size,
-						args.image_size.width,
-						args.image_size.height,
-						data.mem_file
-						) );
-			if( fclose(data.mem_file) ) {
-				LOG_ERROR_STD_LIB(fclose);
-				compressor_cleanup();
-				return RET_FAILURE;
-			}
-			data.mem_file = NULL;
-			LOG_VERBOSE( "file size: %d\n", file_size );
-			zip_source_t* zip_source = zip_source_buffer_create(file_content, file_size, 1, 0 ); // auto-frees file_conten, when no longer needed by zip
-			if( zip_source == NULL ) {
-				LOG_ERROR("cannot add file to zip archive %s\n", zip_strerror(data.zip_archive));
-				zip_source_free( zip_source );
-				compressor_cleanup();
-				return RET_FAILURE;
+		// every package starts with a keyframe:
+		const bool keyframe = (
+				args->keyframe_interval == 0
+				|| (compressor->frame_acc_count - 1) % args->keyframe_interval == 0
+		);
+		if( args->keyframe_interval > 0 ) {
+			rgb_size = gray
+				? image_output_size( OUTPUT_FORMAT_GRAY, args->image_size.width, args->image_size.height )
+				: image_rgb_size( args->image_size.width, args->image_size.height );
+			if( keyframe ) {
+				memcpy( compressor->prev_frame, rgb_data, rgb_size );
 			}
-			if( -1 == zip_file_add( data.zip_archive, filename, zip_source, ZIP_FL_ENC_UTF_8 ) ) {
-				LOG_ERROR("cannot add file to zip archive %s\n", zip_strerror(data.zip_archive) );
-				zip_source_free( zip_source );
-				compressor_cleanup();
-				return RET_FAILURE;
+			else {
+				compressor_delta_encode( rgb_data, compressor->prev_frame, compressor->delta_buffer, rgb_size );
+				rgb_data = compressor->delta_buffer;
 			}
 		}
-		rgb_consumers_queue_read_stop_dump( input_queue );
-		// close archive, when we have enough files:
-		if( frame_acc_count >= args.package_size ) {
-			LOG_VERBOSE( "write archive %s\n", data.arch_filename );
-			API_RUN(compressor_cleanup());
-			package_counter++;
-			frame_acc_count = 0;
+		name_template_t* name = keyframe ? &compressor->entry_name : &compressor->xor_entry_name;
+		name_template_set( name, NAME_PACKAGE, compressor->package_counter );
+		name_template_set( name, NAME_COUNTER, compressor->counter );
+		LOG_VERBOSE( "adding file: %s\n", name_template_str( name ) );
+
+		// stream ppm/pgm header + image data into the archive:
+		name_template_t* header = keyframe ? &compressor->header : &compressor->xor_header;
+		name_template_set_time( header, HEADER_TIME, &frame->time );
+		if( !keyframe ) {
+			name_template_set( header, HEADER_REFERENCE, compressor->prev_frame_counter );
 		}
-		API_RUN( sem_post( done_processing ) );
-		counter++;
+		compressor->prev_frame_counter = compressor->counter;
+		API_RUN( zip_stream_entry_start( &compressor->zip_archive, name_template_str( name ) ) );
+		API_RUN( zip_stream_entry_write( &compressor->zip_archive, name_template_str( header ), name_template_length( header ) ) );
+		API_RUN( zip_stream_entry_write( &compressor->zip_archive, rgb_data, rgb_size ) );
+		API_RUN( zip_stream_entry_end( &compressor->zip_archive ) );
 	}
-	LOG_VERBOSE( "stopping\n" );
-	compressor_cleanup();
+	// close archive, when we have enough files:
+	if( compressor->frame_acc_count >= args->package_size ) {
+		LOG_VERBOSE( "write archive %s\n", compressor->arch_filename );
+		API_RUN( compressor_cleanup( compressor ) );
+		compressor->package_counter++;
+		compressor->frame_acc_count = 0;
+	}
+	compressor->counter++;
 	return RET_SUCCESS;
 }
 
-ret_t compressor_cleanup()
+ret_t compressor_cleanup(
+		compressor_t* compressor
+)
 {
 	ret_t ret = RET_SUCCESS;
-	if( data.mem_file != NULL ) {
-		if( fclose(data.mem_file) ) {
-			LOG_ERROR_STD_LIB(fclose);
-			compressor_cleanup();
-			ret = RET_FAILURE;
-		}
-		data.mem_file = NULL;
-	}
-	if( data.zip_archive != NULL ) {
-		if( 0 != zip_close( data.zip_archive ) ) {
-			LOG_ERROR("cannot close zip archive '%s': %s\n",
-					data.arch_filename, zip_strerror(data.zip_archive)
+	if( compressor->zip_archive.file != NULL ) {
+		if( RET_SUCCESS != zip_stream_close( &compressor->zip_archive ) ) {
+			LOG_ERROR("cannot close zip archive '%s'\n",
+					compressor->arch_filename
 			);
-			compressor_cleanup();
 			ret = RET_FAILURE;
 		}
-		data.zip_archive = NULL;
 	}
 	return ret;
 }
+
+ret_t compressor_add_jpeg(
+		compressor_t* compressor,
+		const rgb_entry_t* frame
+)
+{
+	name_template_t* name = &compressor->entry_name;
+	name_template_set( name, NAME_PACKAGE, compressor->package_counter );
+	name_template_set( name, NAME_COUNTER, compressor->counter );
+	LOG_VERBOSE( "adding file: %s\n", name_template_str( name ) );
+	name_template_set_time( &compressor->header, HEADER_TIME, &frame->time );
+	byte_t header[IMAGE_JPEG_HEADER_MAX_SIZE];
+	size_t header_size = 0;
+	if(
+			RET_SUCCESS != image_jpeg_header(
+				frame->frame.data, frame->frame.size,
+				name_template_str( &compressor->header ),
+				header, sizeof(header),
+				&header_size
+			)
+			|| RET_SUCCESS != zip_stream_entry_start( &compressor->zip_archive, name_template_str( name ) )
+			|| RET_SUCCESS != zip_stream_entry_write( &compressor->zip_archive, header, header_size )
+			// (the header replaces the SOI marker)
+			|| RET_SUCCESS != zip_stream_entry_write( &compressor->zip_archive, frame->frame.data + 2, frame->frame.size - 2 )
+			|| RET_SUCCESS != zip_stream_entry_end( &compressor->zip_archive )
+	) {
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
+ret_t compressor_init_templates(
+		compressor_t* compressor
+)
+{
+	const compressor_args_t* args = &compressor->args;
+	if( args->format == OUTPUT_FORMAT_JPEG ) {
+		compressor_init_entry_name( &compressor->entry_name, "jpg" );
+		name_template_init( &compressor->header );
+		name_template_append_time( &compressor->header );
+		if(
+				!name_template_is_valid( &compressor->entry_name )
+				|| !name_template_is_valid( &compressor->header )
+		) {
+			LOG_ERROR( "entry name too long\n" );
+			return RET_FAILURE;
+		}
+		return RET_SUCCESS;
+	}
+	// frames are stored as ppm, or pgm (GRAY):
+	const output_format_t file_format = (args->format == OUTPUT_FORMAT_GRAY)
+		? OUTPUT_FORMAT_GRAY
+		: OUTPUT_FORMAT_RGB;
+	const bool gray = (file_format == OUTPUT_FORMAT_GRAY);
+	compressor_init_entry_name( &compressor->entry_name, gray ? "pgm" : "ppm" );
+	compressor_init_entry_name( &compressor->xor_entry_name, gray ? "xor.pgm" : "xor.ppm" );
+	char prefix[STR_BUFFER_SIZE];
+	char suffix[STR_BUFFER_SIZE];
+	API_RUN( image_file_header(
+			file_format,
+			args->image_size.width,
+			args->image_size.height,
+			prefix, sizeof(prefix),
+			suffix, sizeof(suffix)
+	) );
+	name_template_init( &compressor->header );
+	name_template_append( &compressor->header, prefix );
+	name_template_append_time( &compressor->header );
+	name_template_append( &compressor->header, suffix );
+	// second comment line names the reference:
+	name_template_init( &compressor->xor_header );
+	name_template_append( &compressor->xor_header, prefix );
+	name_template_append_time( &compressor->xor_header );
+	name_template_append( &compressor->xor_header, "\n#xor image" );
+	name_template_append_field( &compressor->xor_header, 4 );
+	name_template_append( &compressor->xor_header, suffix );
+	if(
+			!name_template_is_valid( &compressor->entry_name )
+			|| !name_template_is_valid( &compressor->xor_entry_name )
+			|| !name_template_is_valid( &compressor->header )
+			|| !name_template_is_valid( &compressor->xor_header )
+	) {
+		LOG_ERROR( "entry name or header too long\n" );
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
+void compressor_init_entry_name(
+		name_template_t* name,
+		const char* ext
+)
+{
+	name_template_init( name );
+	name_template_append( name, "package" );
+	name_template_append_field( name, 4 );
+	name_template_append( name, "/image" );
+	name_template_append_field( name, 4 );
+	name_template_append( name, "." );
+	name_template_append( name, ext );
+}
+
+void compressor_delta_encode(
+		const byte_t* src,
+		byte_t* prev,
+		byte_t* dst,
+		const size_t size
+)
+{
+	for( size_t i=0; i<size; i++ ) {
+		const byte_t val = src[i];
+		dst[i] = val ^ prev[i];
+		prev[i] = val;
+	}
+}
@@ -3,19 +3,64 @@
 #include "lib/image.h"
 #include "queues/rgb_queue.h"
 #include "lib/global.h"
-
-#include <semaphore.h>
+#include "lib/zip_stream.h"
+#include "lib/name_template.h"
 
 
 typedef struct {
 	uint package_size;
 	char* shared_dir;
 	frame_size_t image_size;
+	// frames are converted to RGB
+	// if necessary (JPEG is stored as is,
+	// GRAY as PGM):
+	output_format_t format;
+	// store every keyframe_interval'th frame as is,
+	// the others XORed with their predecessor
+	// (0: no delta coding):
+	uint keyframe_interval;
 } compressor_args_t;
 
 
-ret_t compressor_run(
-		const compressor_args_t args,
-		rgb_consumers_queue_t* input_queue,
-		sem_t* done_processing
+typedef struct {
+	compressor_args_t args;
+	uint counter;
+	uint package_counter;
+	uint frame_acc_count;
+	char arch_filename[STR_BUFFER_SIZE];
+	// entries are streamed to disk,
+	// file == NULL if no archive is open:
+	zip_stream_t zip_archive;
+	// frames in other formats than RGB
+	// are converted here:
+	byte_t* rgb_buffer;
+	size_t rgb_buffer_size;
+	// delta mode:
+	byte_t* prev_frame;
+	byte_t* delta_buffer;
+	uint prev_frame_counter;
+	// entry names and headers, prepared once
+	// (see "lib/name_template.h"):
+	name_template_t entry_name;
+	name_template_t xor_entry_name;
+	name_template_t header; // JPEG: the comment
+	name_template_t xor_header;
+} compressor_t;
+
+ret_t compressor_init(
+		compressor_t* compressor,
+		const compressor_args_t args
+);
+
+// closes the current package:
+ret_t compressor_exit(
+		compressor_t* compressor
+);
+
+// add one frame to the current package.
+// not thread safe, frames are
+// added in the order of the calls
+ret_t compressor_frame(
+		compressor_t* compressor,
+		const rgb_entry_t* frame
 );
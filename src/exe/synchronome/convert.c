@@ -23,12 +23,17 @@
 // #define LOG_TIME(FMT,...)
 #define LOG_TIME(FMT,...) log_time( "%-20s %4lu.%06lu: " FMT, SERVICE_NAME, current_time.tv_sec, current_time.tv_nsec/1000, ## __VA_ARGS__ )
 
+/********************
+ * API Def
+********************/
 
 ret_t convert_run(
 		const USEC deadline_us,
-		const img_format_t src_format,
+		const image_converter_t* converter,
 		select_queue_t* input_queue,
-		rgb_queue_t* rgb_queue
+		rgb_queue_t* rgb_queue,
+		frame_stages_t* stages,
+		frame_window_t* frame_window
 )
 {
 	thread_info( "convert" );
@@ -58,17 +63,25 @@ ret_t convert_run(
 			rgb_queue_push_start( rgb_queue, &dst_entry );
 			dst_entry->time = entry.time;
 			// TODO: fix error handling:
-			if( RET_SUCCESS != image_convert_to_rgb(
-					src_format,
+			if( RET_SUCCESS != image_converter_run(
+					converter,
 					entry.frame.data,
+					entry.frame.size,
 					dst_entry->frame.data,
-					dst_entry->frame.size
+					dst_entry->frame.max_size
 			) ) {
-				LOG_ERROR("error in '%s'\n", "image_convert_to_rgb" );
+				LOG_ERROR("error in '%s'\n", "image_converter_run" );
+				frame_window_unpin( frame_window, &entry.frame );
 				return RET_FAILURE;
 			}
+			// (jpeg frames have variable size):
+			dst_entry->frame.size = (converter->dst_format == OUTPUT_FORMAT_JPEG)
+				? entry.frame.size
+				: converter->dst_size;
 			rgb_queue_push_end( rgb_queue );
+			frame_stages_submit( stages, dst_entry );
 		}
+		frame_window_unpin( frame_window, &entry.frame );
 		select_queue_read_stop_dump(input_queue);
 		// log timing info:
 		current_time = time_measure_current_time();
@@ -2,12 +2,19 @@
 
 #include "queues/select_queue.h"
 #include "queues/rgb_queue.h"
+#include "queues/frame_window.h"
+#include "frame_stages.h"
+#include "lib/image.h"
 
 #include <semaphore.h>
 
+// the converter is prepared before the stage
+// starts (formats, output size, lookup tables):
 ret_t convert_run(
 		const USEC deadline_us,
-		const img_format_t src_format,
+		const image_converter_t* converter,
 		select_queue_t* input_queue,
-		rgb_queue_t* rgb_queue
+		rgb_queue_t* rgb_queue,
+		frame_stages_t* stages, // converted frames are submitted here
+		frame_window_t* frame_window // to unpin converted frames
 );
@@ -18,24 +18,36 @@
 
 int set_camera_format(
 		camera_t* camera,
+		const char* mode_cache_dir,
 		const pixel_format_t pixel_format,
 		const frame_size_t size,
 		const frame_interval_t* acq_interval
 );
 
-DECL_RING_BUFFER(frames,frame_buffer_t)
-
-/********************
- * Global Data:
-********************/
+// the frame intervals supported for
+// a pixel format and frame size:
+ret_t list_frame_intervals(
+		camera_t* camera,
+		const char* mode_cache_dir,
+		const pixel_format_t pixel_format,
+		const frame_size_t size,
+		frame_interval_descrs_t* interval_descrs
+);
 
-typedef struct {
-	frames_t frames;
-	pthread_mutex_t mutex;
-} frame_dumpster_t;
+ret_t frame_acq_bootstrap(
+		const USEC bootstrap_us,
+		camera_t* camera,
+		frame_dumpster_t* frame_dumpster,
+		sem_t* sem,
+		bool* stop,
+		acq_queue_t* acq_queue
+);
 
-// frames that may be returned to the camera:
-static frame_dumpster_t frame_dumpster;
+// return dumped frames back to camera:
+void frame_acq_return_dumped_frames(
+		camera_t* camera,
+		frame_dumpster_t* frame_dumpster
+);
 
 /********************
  * Function Defs
@@ -63,11 +75,14 @@ static frame_dumpster_t frame_dumpster;
 }
 
 #define LOG_TIME(FMT,...) log_time( "%-20s %4lu.%06lu: " FMT, SERVICE_NAME, current_time.tv_sec, current_time.tv_nsec/1000, ## __VA_ARGS__ )
-static timeval_t current_time;
+// per thread (one capture thread per camera):
+static _Thread_local timeval_t current_time;
 
 ret_t frame_acq_init(
 		camera_t* camera,
+		frame_dumpster_t* frame_dumpster,
 		const char* dev_name,
+		const char* mode_cache_dir,
 		const uint buffer_size,
 		const pixel_format_t required_format,
 		const frame_size_t size,
@@ -80,6 +95,7 @@ ret_t frame_acq_init(
 	));
 	CAMERA_RUN(set_camera_format(
 				camera,
+				mode_cache_dir,
 				required_format,
 				size,
 				acq_interval
@@ -89,24 +105,27 @@ ret_t frame_acq_init(
 			buffer_size
 	));
 	CAMERA_RUN( camera_stream_start( camera ));
-	frames_init( &frame_dumpster.frames, buffer_size );
-	pthread_mutex_init( &frame_dumpster.mutex, 0);
+	frames_init( &frame_dumpster->frames, camera->buffer_container.count );
+	pthread_mutex_init( &frame_dumpster->mutex, 0);
 	return RET_SUCCESS;
 }
 
 ret_t frame_acq_exit(
-		camera_t* camera
+		camera_t* camera,
+		frame_dumpster_t* frame_dumpster
 )
 {
 	CAMERA_RUN( camera_stream_stop( camera ));
-	pthread_mutex_destroy( &frame_dumpster.mutex);
-	frames_exit( &frame_dumpster.frames );
+	pthread_mutex_destroy( &frame_dumpster->mutex);
+	frames_exit( &frame_dumpster->frames );
 	return RET_SUCCESS;
 }
 
 ret_t frame_acq_run(
 		const USEC deadline_us,
+		const USEC bootstrap_us,
 		camera_t* camera,
+		frame_dumpster_t* frame_dumpster,
 		sem_t* sem,
 		bool* stop,
 		acq_queue_t* acq_queue
@@ -114,6 +133,16 @@ ret_t frame_acq_run(
 {
 	thread_info( SERVICE_NAME );
 	LOG_VERBOSE( "deadline: %06luus\n", deadline_us  );
+	if( bootstrap_us > 0 ) {
+		API_RUN( frame_acq_bootstrap(
+				bootstrap_us,
+				camera,
+				frame_dumpster,
+				sem,
+				stop,
+				acq_queue
+		) );
+	}
 	while( true ) {
 		if( sem_wait_nointr( sem ) ) {
 			LOG_ERROR( "'sem_wait' failed: %s\n", strerror( errno ) );
@@ -127,23 +156,14 @@ ret_t frame_acq_run(
 		timeval_t start_time = current_time;
 		LOG_TIME( "START\n" );
 		// return dumped frames back to camera:
-		{
-			LOG_VERBOSE( "dumpster: read START\n" );
-			pthread_mutex_lock( &frame_dumpster.mutex );
-			while( frames_get_count(&frame_dumpster.frames) > 0 ) {
-				frame_buffer_t* frame = frames_get( &frame_dumpster.frames );
-				camera_return_frame( camera, frame );
-				frames_pop( &frame_dumpster.frames );
-			}
-			pthread_mutex_unlock( &frame_dumpster.mutex );
-			LOG_VERBOSE( "dumpster: read STOP\n" );
-		}
+		frame_acq_return_dumped_frames( camera, frame_dumpster );
 		current_time = time_measure_current_time();
 		// acquire next frame:
 		{
 			acq_entry_t* acq_entry = NULL;
 			acq_queue_push_start( acq_queue, &acq_entry );
 			acq_entry->time = start_time;
+			acq_entry->bootstrap = false;
 			CAMERA_RUN( camera_get_frame( camera, &acq_entry->frame ));
 			acq_queue_push_end( acq_queue );
 		}
@@ -168,21 +188,79 @@ ret_t frame_acq_run(
 }
 
 void frame_acq_return_frame(
+		frame_dumpster_t* frame_dumpster,
 		frame_buffer_t frame
 )
 {
 	LOG_VERBOSE( "dumpster: add START\n" );
-	pthread_mutex_lock( &frame_dumpster.mutex );
+	pthread_mutex_lock( &frame_dumpster->mutex );
 	frame_buffer_t* frame_dst = NULL;
-	frames_push_start(&frame_dumpster.frames, &frame_dst);
+	frames_push_start(&frame_dumpster->frames, &frame_dst);
 	(*frame_dst) = frame;
-	frames_push_end(&frame_dumpster.frames);
-	pthread_mutex_unlock( &frame_dumpster.mutex );
+	frames_push_end(&frame_dumpster->frames);
+	pthread_mutex_unlock( &frame_dumpster->mutex );
 	LOG_VERBOSE( "dumpster: add STOP\n" );
 }
 
+ret_t frame_acq_bootstrap(
+		const USEC bootstrap_us,
+		camera_t* camera,
+		frame_dumpster_t* frame_dumpster,
+		sem_t* sem,
+		bool* stop,
+		acq_queue_t* acq_queue
+)
+{
+	// the driver has been filling buffers since
+	// the stream started, skip these stale frames:
+	for( uint i=0; i<camera->buffer_container.count; i++ ) {
+		frame_buffer_t frame;
+		CAMERA_RUN( camera_get_frame( camera, &frame ));
+		CAMERA_RUN( camera_return_frame( camera, &frame ));
+	}
+	timeval_t start_time = time_measure_current_time();
+	uint frame_count = 0;
+	while( !(*stop) ) {
+		frame_acq_return_dumped_frames( camera, frame_dumpster );
+		acq_entry_t* acq_entry = NULL;
+		acq_queue_push_start( acq_queue, &acq_entry );
+		// stamped before DQBUF, like sequenced frames:
+		acq_entry->time = time_measure_current_time();
+		acq_entry->bootstrap = true;
+		CAMERA_RUN( camera_get_frame( camera, &acq_entry->frame ));
+		acq_queue_push_end( acq_queue );
+		frame_count++;
+		timeval_t runtime;
+		time_delta( &acq_entry->time, &start_time, &runtime );
+		if( time_us_from_timespec( &runtime ) >= bootstrap_us ) {
+			break;
+		}
+	}
+	LOG_VERBOSE( "bootstrap: %u frames\n", frame_count );
+	// ignore sequencer ticks missed during the burst:
+	while( 0 == sem_trywait( sem ) ) {}
+	return RET_SUCCESS;
+}
+
+void frame_acq_return_dumped_frames(
+		camera_t* camera,
+		frame_dumpster_t* frame_dumpster
+)
+{
+	LOG_VERBOSE( "dumpster: read START\n" );
+	pthread_mutex_lock( &frame_dumpster->mutex );
+	while( frames_get_count(&frame_dumpster->frames) > 0 ) {
+		frame_buffer_t* frame = frames_get( &frame_dumpster->frames );
+		camera_return_frame( camera, frame );
+		frames_pop( &frame_dumpster->frames );
+	}
+	pthread_mutex_unlock( &frame_dumpster->mutex );
+	LOG_VERBOSE( "dumpster: read STOP\n" );
+}
+
 int set_camera_format(
 		camera_t* camera,
+		const char* mode_cache_dir,
 		const pixel_format_t pixel_format,
 		const frame_size_t size,
 		const frame_interval_t* acq_interval
@@ -190,8 +268,9 @@ int set_camera_format(
 )
 {
 	frame_interval_descrs_t interval_descrs;
-	if( RET_SUCCESS != camera_list_frame_intervals(
+	if( RET_SUCCESS != list_frame_intervals(
 				camera,
+				mode_cache_dir,
 				pixel_format,
 				size,
 				&interval_descrs
@@ -234,4 +313,56 @@ int set_camera_format(
 	return RET_SUCCESS;
 }
 
+ret_t list_frame_intervals(
+		camera_t* camera,
+		const char* mode_cache_dir,
+		const pixel_format_t pixel_format,
+		const frame_size_t size,
+		frame_interval_descrs_t* interval_descrs
+)
+{
+	if( mode_cache_dir != NULL ) {
+		// (large, don't put it on the stack):
+		camera_mode_descrs_t* modes = NULL;
+		CALLOC( modes, 1, sizeof(camera_mode_descrs_t) );
+		bool from_cache = false;
+		if( RET_SUCCESS != camera_list_modes_cached(
+					camera,
+					mode_cache_dir,
+					modes,
+					&from_cache
+		) ) {
+			FREE( modes );
+			return RET_FAILURE;
+		}
+		LOG_VERBOSE( "%s: modes %s\n",
+				camera->dev_name,
+				from_cache ? "read from cache" : "enumerated"
+		);
+		interval_descrs->count = 0;
+		for( uint i=0; i<modes->count; i++ ) {
+			const camera_mode_descr_t* mode = &modes->mode_descrs[i];
+			if(
+					mode->pixel_format_descr.pixelformat == pixel_format
+					&& mode->frame_size_descr.discrete.width == size.width
+					&& mode->frame_size_descr.discrete.height == size.height
+			) {
+				interval_descrs->descrs[interval_descrs->count] = mode->frame_interval_descr;
+				interval_descrs->count++;
+			}
+		}
+		FREE( modes );
+		// only discrete modes are cached:
+		if( interval_descrs->count > 0 ) {
+			return RET_SUCCESS;
+		}
+	}
+	return camera_list_frame_intervals(
+			camera,
+			pixel_format,
+			size,
+			interval_descrs
+	);
+}
+
 DEF_RING_BUFFER(frames,frame_buffer_t)
@@ -1,13 +1,29 @@
 #pragma once
 
 #include "lib/camera.h"
+#include "lib/ring_buffer.h"
 #include "queues/acq_queue.h"
 
+#include <pthread.h>
 #include <semaphore.h>
 
+DECL_RING_BUFFER(frames,frame_buffer_t)
+
+// frames that may be returned to the camera
+// (one per camera):
+typedef struct {
+	frames_t frames;
+	pthread_mutex_t mutex;
+} frame_dumpster_t;
+
+// mode_cache_dir: look up the camera modes
+// in this directory (see 'camera_list_modes_cached'),
+// NULL: ask the camera
 ret_t frame_acq_init(
 		camera_t* camera,
+		frame_dumpster_t* frame_dumpster,
 		const char* dev_name,
+		const char* mode_cache_dir,
 		const uint buffer_size,
 		const pixel_format_t required_format,
 		const frame_size_t size,
@@ -15,12 +31,18 @@ ret_t frame_acq_init(
 );
 
 ret_t frame_acq_exit(
-		camera_t* camera
+		camera_t* camera,
+		frame_dumpster_t* frame_dumpster
 );
 
+// bootstrap_us > 0: before waiting for the sequencer,
+// capture frames at the native camera rate
+// for this long (see `acq_entry_t.bootstrap`)
 ret_t frame_acq_run(
 		const USEC deadline_us,
+		const USEC bootstrap_us,
 		camera_t* camera,
+		frame_dumpster_t* frame_dumpster,
 		sem_t* sem,
 		bool* stop,
 		acq_queue_t* acq_queue
@@ -30,5 +52,6 @@ ret_t frame_acq_run(
 // simply enqueues the frame to
 // be returned to the camera
 void frame_acq_return_frame(
+		frame_dumpster_t* frame_dumpster,
 		frame_buffer_t frame
 );
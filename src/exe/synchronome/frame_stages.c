@@ -0,0 +1,164 @@
+#include "frame_stages.h"
+
+#include "lib/output.h"
+#include "lib/global.h"
+
+
+#define SERVICE_NAME "frame_stages"
+
+#define LOG_ERROR(fmt,...) log_error( "%-20s: " fmt, SERVICE_NAME , ## __VA_ARGS__ )
+
+/********************
+ * Function Decls
+********************/
+
+// tasks:
+void frame_stages_store(
+		void* arg
+);
+
+void frame_stages_compress(
+		void* arg
+);
+
+// release all frames at the front
+// of the queue which are done:
+void frame_stages_release(
+		void* arg
+);
+
+void frame_stages_job_done(
+		frame_job_t* job
+);
+
+/********************
+ * API Def
+********************/
+
+void frame_stages_init(
+		frame_stages_t* stages,
+		executor_t* executor,
+		rgb_queue_t* rgb_queue,
+		write_to_storage_t* storage,
+		compressor_t* compressor
+)
+{
+	const uint max_count = rgb_queue_get_max_count( rgb_queue );
+	stages->rgb_queue = rgb_queue;
+	stages->storage = storage;
+	stages->compressor = compressor;
+	stages->jobs = NULL;
+	CALLOC( stages->jobs, max_count, sizeof(frame_job_t) );
+	stages->submit_count = 0;
+	stages->release_count = 0;
+	stages->failed = false;
+	// every frame posts at most one task per strand:
+	executor_strand_init( &stages->storage_strand, executor, max_count );
+	executor_strand_init( &stages->compressor_strand, executor, max_count );
+	executor_strand_init( &stages->release_strand, executor, max_count );
+}
+
+void frame_stages_exit(
+		frame_stages_t* stages
+)
+{
+	assert( stages->release_count == stages->submit_count );
+	executor_strand_exit( &stages->release_strand );
+	executor_strand_exit( &stages->compressor_strand );
+	executor_strand_exit( &stages->storage_strand );
+	FREE( stages->jobs );
+}
+
+void frame_stages_submit(
+		frame_stages_t* stages,
+		rgb_entry_t* entry
+)
+{
+	// the queue has one producer, so the n'th
+	// frame is in slot n % max_count:
+	const uint max_count = rgb_queue_get_max_count( stages->rgb_queue );
+	frame_job_t* job = &stages->jobs[stages->submit_count % max_count];
+	assert( entry == &stages->rgb_queue->entries[stages->submit_count % max_count] );
+	job->stages = stages;
+	job->entry = entry;
+	job->pending = 1 + (stages->compressor != NULL ? 1 : 0);
+	stages->submit_count++;
+	executor_strand_post( &stages->storage_strand, frame_stages_store, job );
+	if( stages->compressor != NULL ) {
+		executor_strand_post( &stages->compressor_strand, frame_stages_compress, job );
+	}
+}
+
+ret_t frame_stages_get_ret(
+		frame_stages_t* stages
+)
+{
+	return stages->failed ? RET_FAILURE : RET_SUCCESS;
+}
+
+/********************
+ * Private Defs
+********************/
+
+void frame_stages_store(
+		void* arg
+)
+{
+	frame_job_t* job = arg;
+	frame_stages_t* stages = job->stages;
+	if( !stages->failed ) {
+		if( RET_SUCCESS != write_to_storage_frame( stages->storage, job->entry ) ) {
+			LOG_ERROR( "write_to_storage failed, skipping all following frames\n" );
+			stages->failed = true;
+		}
+	}
+	frame_stages_job_done( job );
+}
+
+void frame_stages_compress(
+		void* arg
+)
+{
+	frame_job_t* job = arg;
+	frame_stages_t* stages = job->stages;
+	if( !stages->failed ) {
+		if( RET_SUCCESS != compressor_frame( stages->compressor, job->entry ) ) {
+			LOG_ERROR( "compressor failed, skipping all following frames\n" );
+			stages->failed = true;
+		}
+	}
+	frame_stages_job_done( job );
+}
+
+void frame_stages_job_done(
+		frame_job_t* job
+)
+{
+	if( --job->pending == 0 ) {
+		executor_strand_post( &job->stages->release_strand, frame_stages_release, job->stages );
+	}
+}
+
+void frame_stages_release(
+		void* arg
+)
+{
+	frame_stages_t* stages = arg;
+	const uint max_count = rgb_queue_get_max_count( stages->rgb_queue );
+	uint done_count = 0;
+	while(
+			stages->release_count + done_count < stages->submit_count
+			&& stages->jobs[(stages->release_count + done_count) % max_count].pending == 0
+	) {
+		done_count++;
+	}
+	// the rgb_queue is never stopped,
+	// so every batch contains at least one frame:
+	while( done_count > 0 ) {
+		rgb_entry_t* entries = NULL;
+		const uint count = rgb_queue_read_n_start( stages->rgb_queue, done_count, &entries );
+		rgb_queue_read_n_stop_dump( stages->rgb_queue, count );
+		stages->release_count += count;
+		done_count -= count;
+	}
+}
@@ -0,0 +1,74 @@
+/************************
+ * best effort stages of a camera pipeline
+ * (write_to_storage, compressor), run as tasks
+ * on a shared executor instead of one thread
+ * per service.
+ *
+ * Every converted frame becomes one task per stage.
+ * Each stage has its own strand: frames pass a stage
+ * in order, different stages (and cameras)
+ * run in parallel.
+ * A frame is released from the rgb_queue when all
+ * stages are done with it, frames are released
+ * in the order they have been submitted.
+ ************************/
+#pragma once
+
+#include "queues/rgb_queue.h"
+#include "write_to_storage.h"
+#include "compressor.h"
+#include "lib/executor.h"
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+
+struct frame_stages;
+
+typedef struct {
+	struct frame_stages* stages;
+	rgb_entry_t* entry;
+	// stages not done with the frame:
+	_Atomic uint pending;
+} frame_job_t;
+
+typedef struct frame_stages {
+	rgb_queue_t* rgb_queue;
+	write_to_storage_t* storage;
+	compressor_t* compressor; // NULL: disabled
+	executor_strand_t storage_strand;
+	executor_strand_t compressor_strand;
+	executor_strand_t release_strand;
+	// one job per rgb_queue slot:
+	frame_job_t* jobs;
+	_Atomic uint64_t submit_count;
+	uint64_t release_count; // release strand only
+	_Atomic bool failed;
+} frame_stages_t;
+
+void frame_stages_init(
+		frame_stages_t* stages,
+		executor_t* executor,
+		rgb_queue_t* rgb_queue,
+		write_to_storage_t* storage,
+		compressor_t* compressor
+);
+
+// all submitted frames must have been
+// processed (e.g. executor_exit):
+void frame_stages_exit(
+		frame_stages_t* stages
+);
+
+// called by the (only) producer of the rgb_queue
+// after 'rgb_queue_push_end':
+void frame_stages_submit(
+		frame_stages_t* stages,
+		rgb_entry_t* entry
+);
+
+// RET_FAILURE if a stage failed
+// (all stages skip the following frames):
+ret_t frame_stages_get_ret(
+		frame_stages_t* stages
+);
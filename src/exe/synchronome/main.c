@@ -3,6 +3,7 @@
 #include "exe/synchronome/queues/acq_queue.h"
 #include "exe/synchronome/queues/select_queue.h"
 #include "exe/synchronome/queues/rgb_queue.h"
+#include "exe/synchronome/queues/frame_window.h"
 // services:
 #include "frame_acq.h"
 #include "lib/global.h"
@@ -10,10 +11,15 @@
 #include "convert.h"
 #include "write_to_storage.h"
 #include "compressor.h"
+#include "frame_stages.h"
 
 #include "lib/camera.h"
 #include "lib/time.h"
 #include "lib/thread.h"
+#include "lib/executor.h"
+#include "lib/pipeline.h"
+#include "lib/wait.h"
+#include "lib/histogram.h"
 #include "lib/output.h"
 
 #include <getopt.h>
@@ -27,6 +33,7 @@
 #include <semaphore.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 
 /********************
@@ -34,123 +41,202 @@
 ********************/
 
 typedef struct {
-	// Resources:
-	camera_t camera;
-	acq_queue_t acq_queue;
-	select_queue_t select_queue;
-	rgb_queue_t rgb_queue;
-	rgb_consumers_queue_t rgb_consumers_queue;
-	sem_t rgb_consumers_done;
-	// 
-	bool stop;
-	// deadlines:
-	USEC deadline_select_us;
-	USEC deadline_convert_us;
-} runtime_data_t;
-
-typedef struct {
-	pthread_t td;
-	ret_t ret;
-	sem_t sem;
-} camera_thread_t;
-
-typedef struct {
-	pthread_t td;
-	ret_t ret;
-} select_thread_t;
-
-typedef struct {
-	pthread_t td;
-	ret_t ret;
-} convert_thread_t;
-
-typedef struct {
-	pthread_t td;
-	ret_t ret;
-	// parameters:
-} write_to_storage_thread_t;
-
-typedef struct {
-	pthread_t td;
-	ret_t ret;
-	// parameters:
-} compressor_thread_t;
+	USEC bootstrap_us;
+} camera_parameters_t;
 
 typedef struct {
 	pthread_t td;
 	ret_t ret;
 } log_thread_t;
 
-typedef struct {
-	frame_size_t frame_size;
-	const char* output_dir;
-	bool other_services;
-} write_to_storage_parameters_t;
-
 typedef struct {
 	float acq_interval;
 	float clock_tick_interval;
 	float tick_threshold;
-	const int max_frames;
+	tick_estimator_t tick_estimator;
+	int max_frames;
 } select_parameters_t;
 
+// one capture pipeline per camera:
+typedef struct {
+	uint index;
+	const char* dev_name;
+	char output_dir[STR_BUFFER_SIZE];
+	// Resources:
+	camera_t camera;
+	frame_dumpster_t frame_dumpster;
+	acq_queue_t acq_queue;
+	frame_window_t frame_window;
+	select_queue_t select_queue;
+	rgb_queue_t rgb_queue;
+	// posted by the sequencer:
+	sem_t camera_sem;
+	bool stop;
+	// service parameters:
+	camera_parameters_t camera_params;
+	select_parameters_t select_params;
+	output_format_t output_format;
+	frame_size_t output_size;
+	// prepared before convert starts:
+	image_converter_t converter;
+	// real time services:
+	pipeline_t pipeline;
+	// best effort stages (run on the executor):
+	write_to_storage_t storage;
+	compressor_t compressor;
+	bool compress;
+	frame_stages_t stages;
+} camera_context_t;
+
+typedef struct {
+	camera_context_t cameras[SYNCHRONOME_MAX_CAMERAS];
+	uint camera_count;
+	// shared by the best effort stages of all cameras:
+	executor_t executor;
+	// for the inputs of the real time consumers:
+	wait_config_t wait_config;
+	// deadlines:
+	USEC deadline_select_us;
+	USEC deadline_convert_us;
+} runtime_data_t;
+
+// real time services of a camera are pinned
+// to these cpu slots
+// (services in the same slot share a cpu):
+typedef enum {
+	SERVICE_SLOT_CAPTURE,
+	SERVICE_SLOT_SELECT, // select, convert
+	SERVICE_SLOT_COUNT
+} service_slot_t;
+
 /********************
  * Global Data
 ********************/
 
 static runtime_data_t data;
 
-static camera_thread_t camera_thread;
-static select_thread_t select_thread;
-static convert_thread_t convert_thread;
-static write_to_storage_thread_t write_to_storage_thread;
-static compressor_thread_t compressor_thread;
 static log_thread_t log_thread;
 
 const uint select_queue_count = 16;
 const uint rgb_queue_count = 64;
-const uint file_queue_count = 8;
+// per worker. Each camera occupies at most
+// one task per strand (see "frame_stages.h"):
+const uint executor_task_count = 3 * SYNCHRONOME_MAX_CAMERAS;
+// startup: wait this long for the first frame of a camera:
+const int camera_ready_timeout_ms = 5000;
 
 /********************
  * Function Decls
 ********************/
 
 ret_t synchronome_init(
-		const frame_size_t size,
+		const synchronome_args_t args,
 		const uint frame_buffer_count
 );
 ret_t synchronome_exit(void);
 
 ret_t synchronome_setup(
+		const synchronome_args_t args,
+		const uint frame_window_count,
+		const uint frame_buffer_count
+);
+
+ret_t synchronome_wait(void);
+
+ret_t camera_context_init(
+		camera_context_t* context,
+		const uint index,
 		const synchronome_args_t args,
 		const uint frame_buffer_count
 );
 
-ret_t synchronome_wait(
+ret_t camera_context_exit(
+		camera_context_t* context
+);
+
+ret_t camera_context_start(
+		camera_context_t* context,
 		const synchronome_args_t args
 );
 
+ret_t camera_context_wait(
+		camera_context_t* context
+);
+
+// after the executor has been drained:
+ret_t camera_context_exit_stages(
+		camera_context_t* context
+);
+
+void camera_context_stop(
+		camera_context_t* context
+);
+
+void camera_context_print_metrics(
+		camera_context_t* context
+);
+
+// cpu for a service slot of a camera:
+int service_cpu(
+		const uint camera_index,
+		const service_slot_t slot
+);
+
+// spinning select stages must not share a cpu
+// with services of other cameras:
+ret_t check_spin_cpus(
+		const uint camera_count
+);
+
+// cpus not used by any real time service slot,
+// returns the number of cpus:
+uint executor_cpus(
+		int* cpus
+);
+
+void dump_frame(
+		void* context,
+		frame_buffer_t frame
+);
+
 void sequencer(int);
-void synchronome_cancel_all_services(void);
 
-void* camera_thread_run(
-		void* thread_args
+// NULL: no mode cache:
+const char* mode_cache_dir(
+		const synchronome_args_t* args
 );
 
-void* select_thread_run(
-		void* thread_args
+// size of converted frames:
+frame_size_t output_frame_size(
+		const synchronome_args_t* args
 );
 
-void* convert_thread_run(
-		void* thread_args
+// pipeline stages:
+ret_t capture_stage_run(
+		void* arg,
+		const USEC deadline_us
 );
 
-void* write_to_storage_thread_run(
-		void* thread_args
+void capture_stage_stop(
+		void* arg
 );
 
-void* compressor_thread_run(
-		void* thread_args
+ret_t select_stage_run(
+		void* arg,
+		const USEC deadline_us
+);
+
+ret_t convert_stage_run(
+		void* arg,
+		const USEC deadline_us
+);
+
+void acq_queue_close(
+		void* queue
+);
+
+void select_queue_close(
+		void* queue
 );
 
 void* log_thread_run(
@@ -180,17 +266,22 @@ ret_t synchronome_run(
 		const synchronome_args_t args
 )
 {
-	uint frame_buffer_count;
+	uint frame_window_count;
 	API_RUN( select_get_frame_acc_count(
 			(float )args.acq_interval.numerator / (float )args.acq_interval.denominator,
 			(float )args.clock_tick_interval.numerator / (float )args.clock_tick_interval.denominator,
-			&frame_buffer_count
+			args.tick_estimator,
+			&frame_window_count
 	));
-	// add safety margin:
-	frame_buffer_count += 2;
+	const uint frame_buffer_count =
+		frame_window_count
+		+ 2 // selected frames being converted
+		+ 2 // being filled by the driver
+	;
+	log_verbose( "frame_window_count: %u\n", frame_window_count );
 	log_verbose( "frame_buffer_count: %u\n", frame_buffer_count );
 	if( RET_SUCCESS != synchronome_init(
-				args.size,
+				args,
 				frame_buffer_count
 	) ) {
 		synchronome_exit();
@@ -199,11 +290,12 @@ ret_t synchronome_run(
 	ret_t ret = RET_SUCCESS;
 	if( RET_SUCCESS != synchronome_setup(
 				args,
+				frame_window_count,
 				frame_buffer_count
 	) ) {
 		ret = RET_FAILURE;
 	};
-	if( RET_SUCCESS != synchronome_wait(args) ) {
+	if( RET_SUCCESS != synchronome_wait() ) {
 		ret = RET_FAILURE;
 	}
 	if( RET_SUCCESS !=  synchronome_exit() ) {
@@ -212,53 +304,26 @@ ret_t synchronome_run(
 	return ret;
 }
 
-ret_t synchronome_wait(
-		synchronome_args_t args
-)
+ret_t synchronome_wait(void)
 {
 	log_verbose( "MAIN: wait\n" );
 	ret_t ret = RET_SUCCESS;
-	log_verbose( "MAIN: wait for select\n" );
-	if( RET_SUCCESS != thread_join_ret(
-				select_thread.td
-	)) {
-		ret = RET_FAILURE;
-	}
-	// stop frame_acq thread:
-	data.stop = true;
-	if( sem_post( &camera_thread.sem ) ) {
-		log_error( "synchronome_cancel_all_services: 'sem_post' failed: %s\n", strerror( errno ) );
-	}
-	// stop convert:
-	select_queue_set_should_stop( &data.select_queue );
-	log_verbose( "MAIN: wait for convert\n" );
-	if( RET_SUCCESS != thread_join_ret(
-				convert_thread.td
-				)) {
-		ret = RET_FAILURE;
+	for( uint i=0; i<data.camera_count; i++ ) {
+		if( RET_SUCCESS != camera_context_wait( &data.cameras[i] ) ) {
+			ret = RET_FAILURE;
+		}
 	}
-
-	rgb_queue_set_should_stop( &data.rgb_queue );
-	log_verbose( "MAIN: wait for writer\n" );
-	if( RET_SUCCESS != thread_join_ret(
-				write_to_storage_thread.td
-				)) {
+	log_verbose( "MAIN: wait for executor\n" );
+	if( RET_SUCCESS != executor_exit( &data.executor ) ) {
 		ret = RET_FAILURE;
 	}
-	if( args.compress_bundle_size > 0 ) {
-		rgb_consumers_queue_set_should_stop( &data.rgb_consumers_queue );
-		log_verbose( "MAIN: wait for compressor\n" );
-		if( RET_SUCCESS != thread_join_ret(
-					compressor_thread.td
-					)) {
+	for( uint i=0; i<data.camera_count; i++ ) {
+		if( RET_SUCCESS != camera_context_exit_stages( &data.cameras[i] ) ) {
 			ret = RET_FAILURE;
 		}
 	}
-	log_verbose( "MAIN: wait for camera\n" );
-	if( RET_SUCCESS != thread_join_ret(
-				camera_thread.td
-				)) {
-		ret = RET_FAILURE;
+	for( uint i=0; i<data.camera_count; i++ ) {
+		camera_context_print_metrics( &data.cameras[i] );
 	}
 	log_stop();
 	log_verbose( "MAIN: wait for log\n" );
@@ -274,98 +339,225 @@ ret_t synchronome_wait(
 void synchronome_stop(void)
 {
 	log_verbose( "synchronome_stop\n" );
-	acq_queue_set_should_stop( &data.acq_queue ); // <- stop "select"
-	// stop frame_acq thread:
-	data.stop = true;
-	if( sem_post( &camera_thread.sem ) ) {
-		log_error( "synchronome_cancel_all_services: 'sem_post' failed: %s\n", strerror( errno ) );
+	for( uint i=0; i<data.camera_count; i++ ) {
+		camera_context_stop( &data.cameras[i] );
 	}
 }
 
-void dump_frame(frame_buffer_t frame)
+void dump_frame(
+		void* context,
+		frame_buffer_t frame
+)
 {
-	frame_acq_return_frame( frame );
+	camera_context_t* camera_context = context;
+	frame_acq_return_frame( &camera_context->frame_dumpster, frame );
 }
 
 ret_t synchronome_init(
-		const frame_size_t size,
+		const synchronome_args_t args,
+		const uint frame_buffer_count
+)
+{
+	if( args.camera_count == 0 || args.camera_count > SYNCHRONOME_MAX_CAMERAS ) {
+		log_error( "invalid number of cameras: %u (1...%u)\n",
+				args.camera_count,
+				SYNCHRONOME_MAX_CAMERAS
+		);
+		return RET_FAILURE;
+	}
+	data.wait_config = (wait_config_t){
+		.strategy = args.wait_strategy,
+		.spin_count = (args.wait_strategy == WAIT_SPIN_THEN_BLOCK)
+			? wait_calibrate_spin_count( args.spin_us )
+			: 0,
+	};
+	if( args.wait_strategy != WAIT_BLOCK ) {
+		API_RUN( check_spin_cpus( args.camera_count ) );
+	}
+	log_verbose( "wait: %s, spin count: %lu\n",
+			wait_strategy_str( data.wait_config.strategy ),
+			(unsigned long )data.wait_config.spin_count
+	);
+	data.camera_count = 0;
+	for( uint i=0; i<args.camera_count; i++ ) {
+		data.camera_count++;
+		API_RUN( camera_context_init(
+				&data.cameras[i],
+				i,
+				args,
+				frame_buffer_count
+		) );
+	}
+	return RET_SUCCESS;
+}
+
+ret_t synchronome_exit(void)
+{
+	ret_t ret = RET_SUCCESS;
+	for( uint i=0; i<data.camera_count; i++ ) {
+		if( RET_SUCCESS != camera_context_exit( &data.cameras[i] ) ) {
+			ret = RET_FAILURE;
+		}
+	}
+	log_info( "shutdown\n" );
+	return ret;
+}
+
+ret_t synchronome_setup(
+		const synchronome_args_t args,
+		const uint frame_window_count,
+		const uint frame_buffer_count
+)
+{
+	data.deadline_select_us = (float )args.acq_interval.numerator / (float )args.acq_interval.denominator * 1000 * 1000 / 2;
+	data.deadline_convert_us = (float )args.acq_interval.numerator / (float )args.acq_interval.denominator * 1000 * 1000 / 2;
+	if( thread_get_cpu_count() < 4 ) {
+		log_error( "system provides less than 4 cpu cores\n" );
+		return RET_FAILURE;
+	}
+	for( uint i=0; i<data.camera_count; i++ ) {
+		camera_context_t* context = &data.cameras[i];
+		API_RUN( frame_acq_init(
+				&context->camera,
+				&context->frame_dumpster,
+				context->dev_name,
+				mode_cache_dir( &args ),
+				frame_buffer_count,
+				args.pixel_format,
+				args.size,
+				&args.acq_interval
+		) );
+		// the driver may have allocated more buffers than requested:
+		frame_window_init(
+				&context->frame_window,
+				frame_window_count,
+				context->camera.buffer_container.count,
+				dump_frame,
+				context
+		);
+	}
+	// instead of a fixed delay,
+	// wait until every camera delivers frames:
+	for( uint i=0; i<data.camera_count; i++ ) {
+		if( RET_SUCCESS != camera_wait_frame( &data.cameras[i].camera, camera_ready_timeout_ms ) ) {
+			log_error( "%s\n", camera_error() );
+			return RET_FAILURE;
+		}
+	}
+	API_RUN( thread_create(
+			"log",
+			&log_thread.td,
+			log_thread_run,
+			NULL,
+			SCHED_OTHER,
+			-1,
+			0
+	) );
+	{
+		int cpus[EXECUTOR_MAX_WORKERS];
+		const uint worker_count = executor_cpus( cpus );
+		log_verbose( "executor: %u workers\n", worker_count );
+		API_RUN( executor_init(
+				&data.executor,
+				"worker",
+				cpus,
+				worker_count,
+				executor_task_count
+		) );
+	}
+	for( uint i=0; i<data.camera_count; i++ ) {
+		API_RUN( camera_context_start( &data.cameras[i], args ) );
+	}
+	// (all stages are running, see 'pipeline_start')
+	// one sequencer for all cameras:
+	time_add_timer(
+			sequencer,
+			1000*1000 * args.acq_interval.numerator / args.acq_interval.denominator
+	);
+	return RET_SUCCESS;
+}
+
+ret_t camera_context_init(
+		camera_context_t* context,
+		const uint index,
+		const synchronome_args_t args,
 		const uint frame_buffer_count
 )
 {
-	camera_zero( &data.camera );
-	data.stop = false;
+	context->index = index;
+	context->dev_name = args.dev_names[index];
+	if( args.camera_count > 1 ) {
+		snprintf( context->output_dir, STR_BUFFER_SIZE, "%s/cam%u",
+				args.output_dir,
+				index
+		);
+		if( -1 == mkdir( context->output_dir, 0755 ) && errno != EEXIST ) {
+			log_error( "'%s': 'mkdir' failed: %s\n", context->output_dir, strerror(errno) );
+			return RET_FAILURE;
+		}
+	}
+	else {
+		snprintf( context->output_dir, STR_BUFFER_SIZE, "%s", args.output_dir );
+	}
+	camera_zero( &context->camera );
+	context->stop = false;
+	{
+		char suffix[8];
+		snprintf( suffix, sizeof(suffix), "%u", index );
+		pipeline_init( &context->pipeline, suffix );
+	}
 	// allocate buffers:
 	acq_queue_init(
-			&data.acq_queue,
+			&context->acq_queue,
 			frame_buffer_count
 	);
 	select_queue_init(
-			&data.select_queue,
+			&context->select_queue,
 			select_queue_count
 	);
 	rgb_queue_init(
-			&data.rgb_queue,
+			&context->rgb_queue,
 			rgb_queue_count
 	);
-	rgb_consumers_queue_init(
-			&data.rgb_consumers_queue,
-			file_queue_count
-	);
-	if( sem_init( &data.rgb_consumers_done, 0, 0 ) ) {
-		log_error( "'sem_init': %s\n", strerror(errno) );
-		return RET_FAILURE;
-	}
-	rgb_queue_init_frames( &data.rgb_queue, size );
+	rgb_queue_init_frames( &context->rgb_queue, output_frame_size( &args ), args.output_format );
+	// select only: convert runs on the same cpu at a higher
+	// priority, spinning there would starve select (its producer):
+	acq_queue_set_wait_config( &context->acq_queue, data.wait_config );
 	// semaphore
-	if( sem_init( &camera_thread.sem, 0, 0 ) ) {
+	if( sem_init( &context->camera_sem, 0, 0 ) ) {
 		log_error( "'sem_init': %s\n", strerror(errno) );
 		return RET_FAILURE;
 	}
 	return RET_SUCCESS;
 }
 
-ret_t synchronome_exit(void)
+ret_t camera_context_exit(
+		camera_context_t* context
+)
 {
 	ret_t ret = RET_SUCCESS;
-	frame_acq_exit( &data.camera );
-	if( sem_destroy ( &data.rgb_consumers_done ) ) {
-		log_error( "'sem_destroy': %s\n", strerror(errno) );
-		ret = RET_FAILURE;
-	}
-	if( sem_destroy ( &camera_thread.sem ) ) {
+	// return remaining frames before the camera stops:
+	frame_window_exit( &context->frame_window );
+	frame_acq_exit( &context->camera, &context->frame_dumpster );
+	if( sem_destroy ( &context->camera_sem ) ) {
 		log_error( "'sem_destroy': %s\n", strerror(errno) );
 		ret = RET_FAILURE;
 	}
-	log_info( "shutdown\n" );
-	rgb_consumers_queue_exit( &data.rgb_consumers_queue );
-	rgb_queue_exit_frames( &data.rgb_queue );
-	rgb_queue_exit( &data.rgb_queue );
-	select_queue_exit( &data.select_queue );
-	acq_queue_exit( &data.acq_queue );
-	camera_exit( &data.camera );
+	pipeline_exit( &context->pipeline );
+	image_converter_exit( &context->converter );
+	rgb_queue_exit_frames( &context->rgb_queue );
+	rgb_queue_exit( &context->rgb_queue );
+	select_queue_exit( &context->select_queue );
+	acq_queue_exit( &context->acq_queue );
+	camera_exit( &context->camera );
 	return ret;
 }
 
-ret_t synchronome_setup(
-		const synchronome_args_t args,
-		const uint frame_buffer_count
+ret_t camera_context_start(
+		camera_context_t* context,
+		const synchronome_args_t args
 )
 {
-	data.deadline_select_us = (float )args.acq_interval.numerator / (float )args.acq_interval.denominator * 1000 * 1000 / 2;
-	data.deadline_convert_us = (float )args.acq_interval.numerator / (float )args.acq_interval.denominator * 1000 * 1000 / 2;
-	if( thread_get_cpu_count() < 4 ) {
-		log_error( "system provides less than 4 cpu cores\n" );
-		return RET_FAILURE;
-	}
-	frame_acq_init(
-			&data.camera,
-			"/dev/video0",
-			frame_buffer_count,
-			args.pixel_format,
-			args.size,
-			&args.acq_interval
-	);
-	sleep(1);
 	USEC capture_deadline = args.acq_interval.numerator * 1000 * 1000 / args.acq_interval.denominator;
 	// loosen the constraints a bit
 	// theoretically, we have to be strict.
@@ -376,163 +568,312 @@ ret_t synchronome_setup(
 		capture_deadline = args.acq_interval.numerator * 1000 * 1000 / (args.acq_interval.denominator-1);
 	}
 	capture_deadline = 1000*1000;
-	API_RUN( thread_create(
-			"log",
-			&log_thread.td,
-			log_thread_run,
-			NULL,
-			SCHED_OTHER,
-			-1,
-			0
-	) );
-	API_RUN( thread_create(
-			"capture",
-			&camera_thread.td,
-			camera_thread_run,
-			&capture_deadline,
-			SCHED_FIFO,
-			thread_get_max_priority(SCHED_FIFO),
-			1
-	) );
-	select_parameters_t select_params = {
+	context->camera_params = (camera_parameters_t){
+		// the burst must contain at least one tick:
+		.bootstrap_us = args.fast_start
+			? 1000*1000 * 5/4 * args.clock_tick_interval.numerator / args.clock_tick_interval.denominator
+			: 0,
+	};
+	context->select_params = (select_parameters_t){
 		.acq_interval = (float )args.acq_interval.numerator / (float )args.acq_interval.denominator,
 		.clock_tick_interval = (float )args.clock_tick_interval.numerator / (float )args.clock_tick_interval.denominator,
 		.tick_threshold = args.tick_threshold,
+		.tick_estimator = args.tick_estimator,
 		.max_frames = args.max_frames,
 	};
-	API_RUN( thread_create(
-			"select",
-			&select_thread.td,
-			select_thread_run,
-			&select_params,
-			SCHED_FIFO,
-			thread_get_max_priority(SCHED_FIFO)-1,
-			2
-	));
-	API_RUN( thread_create(
-			"convert",
-			&convert_thread.td,
-			convert_thread_run,
-			NULL,
-			SCHED_FIFO,
-			thread_get_max_priority(SCHED_FIFO),
-			2
-	));
-	write_to_storage_parameters_t write_to_storage_params = {
-		.frame_size = args.size,
-		.output_dir = args.output_dir,
-		.other_services = (args.compress_bundle_size > 0),
-	};
-	API_RUN(thread_create(
-			"storage",
-			&write_to_storage_thread.td,
-			write_to_storage_thread_run,
-			(void* )&write_to_storage_params,
-			SCHED_OTHER,
-			-1,
-			3	
-	));
-	const compressor_args_t compressor_params = {
-		.package_size = args.compress_bundle_size,
-		.shared_dir = args.output_dir,
-		.image_size = args.size,
-	};
-	if( args.compress_bundle_size > 0 ) {
-		API_RUN(thread_create(
-				"compressor",
-				&compressor_thread.td,
-				compressor_thread_run,
-				(void* )&compressor_params,
-				SCHED_OTHER,
-				-1,
-				3
-		));
-	}
-	sleep(1);
-	time_add_timer(
-			sequencer,
-			1000*1000 * args.acq_interval.numerator / args.acq_interval.denominator
+	context->output_format = args.output_format;
+	context->output_size = output_frame_size( &args );
+	// the format is fixed after the mode negotiation.
+	// (lookup tables are filled here, not on the convert thread)
+	API_RUN( image_converter_init(
+			&context->converter,
+			context->camera.format,
+			context->output_format
+	) );
+	API_RUN( image_converter_set_output_size(
+			&context->converter,
+			context->output_size.width,
+			context->output_size.height
+	) );
+	// best effort stages, must be ready before convert:
+	API_RUN( write_to_storage_init(
+			&context->storage,
+			(write_to_storage_args_t){
+				.mode = (args.ring_file_slots > 0)
+					? STORAGE_RING_FILE
+					: (args.container ? STORAGE_CONTAINER : STORAGE_FILE_PER_FRAME),
+				.frame_size = context->output_size,
+				.format = args.output_format,
+				.output_dir = context->output_dir,
+				.container_max_size = (size_t )args.container_max_size_mb * 1024 * 1024,
+				.container_max_frames = args.container_max_frames,
+				.ring_file_slots = args.ring_file_slots,
+				.shard_frames = args.shard_frames,
+				.shard_hourly = args.shard_hourly,
+				.atomic_files = args.atomic_files,
+			}
+	) );
+	context->compress = (args.compress_bundle_size > 0);
+	if( context->compress ) {
+		API_RUN( compressor_init(
+				&context->compressor,
+				(compressor_args_t){
+					.package_size = args.compress_bundle_size,
+					.shared_dir = context->output_dir,
+					.image_size = context->output_size,
+					.format = args.output_format,
+					.keyframe_interval = args.compress_keyframe_interval,
+				}
+		) );
+	}
+	frame_stages_init(
+			&context->stages,
+			&data.executor,
+			&context->rgb_queue,
+			&context->storage,
+			context->compress ? &context->compressor : NULL
 	);
+	// real time services:
+	pipeline_t* pipeline = &context->pipeline;
+	API_RUN( pipeline_add_queue( pipeline, "acq", &context->acq_queue, acq_queue_close ) );
+	API_RUN( pipeline_add_queue( pipeline, "select", &context->select_queue, select_queue_close ) );
+	// drained by the best effort stages:
+	API_RUN( pipeline_add_queue( pipeline, "rgb", &context->rgb_queue, NULL ) );
+	API_RUN( pipeline_add_stage( pipeline, (pipeline_stage_decl_t){
+			.name = "capture",
+			.run = capture_stage_run,
+			.stop = capture_stage_stop,
+			.arg = context,
+			.sched = PIPELINE_SCHED_RT,
+			.priority_offset = 0,
+			.cpu = service_cpu( context->index, SERVICE_SLOT_CAPTURE ),
+			.deadline_us = capture_deadline,
+			.outputs = { &context->acq_queue },
+	} ) );
+	API_RUN( pipeline_add_stage( pipeline, (pipeline_stage_decl_t){
+			.name = "select",
+			.run = select_stage_run,
+			.arg = context,
+			.sched = PIPELINE_SCHED_RT,
+			.priority_offset = 1,
+			.cpu = service_cpu( context->index, SERVICE_SLOT_SELECT ),
+			.deadline_us = data.deadline_select_us,
+			.inputs = { &context->acq_queue },
+			.outputs = { &context->select_queue },
+	} ) );
+	API_RUN( pipeline_add_stage( pipeline, (pipeline_stage_decl_t){
+			.name = "convert",
+			.run = convert_stage_run,
+			.arg = context,
+			.sched = PIPELINE_SCHED_RT,
+			.priority_offset = 0,
+			.cpu = service_cpu( context->index, SERVICE_SLOT_SELECT ),
+			.deadline_us = data.deadline_convert_us,
+			.inputs = { &context->select_queue },
+			.outputs = { &context->rgb_queue },
+	} ) );
+	API_RUN( pipeline_start( pipeline ) );
+	return RET_SUCCESS;
+}
+
+ret_t camera_context_wait(
+		camera_context_t* context
+)
+{
+	log_verbose( "MAIN: camera %u: wait\n", context->index );
+	return pipeline_wait( &context->pipeline );
+}
+
+ret_t camera_context_exit_stages(
+		camera_context_t* context
+)
+{
+	ret_t ret = frame_stages_get_ret( &context->stages );
+	frame_stages_exit( &context->stages );
+	if( RET_SUCCESS != write_to_storage_exit( &context->storage ) ) {
+		ret = RET_FAILURE;
+	}
+	if( context->compress ) {
+		if( RET_SUCCESS != compressor_exit( &context->compressor ) ) {
+			ret = RET_FAILURE;
+		}
+	}
+	return ret;
+}
+
+void camera_context_stop(
+		camera_context_t* context
+)
+{
+	pipeline_stop( &context->pipeline );
+}
+
+void camera_context_print_metrics(
+		camera_context_t* context
+)
+{
+	log_info( "camera %u (%s): captured: %lu, selected: %lu, converted: %lu\n",
+			context->index,
+			context->dev_name,
+			(unsigned long )acq_queue_get_push_count( &context->acq_queue ),
+			(unsigned long )select_queue_get_push_count( &context->select_queue ),
+			(unsigned long )rgb_queue_get_push_count( &context->rgb_queue )
+	);
+	log_verbose( "camera %u: queue peaks: acq: %u/%u, select: %u/%u, rgb: %u/%u\n",
+			context->index,
+			acq_queue_get_peak_count( &context->acq_queue ),
+			acq_queue_get_max_count( &context->acq_queue ),
+			select_queue_get_peak_count( &context->select_queue ),
+			select_queue_get_max_count( &context->select_queue ),
+			rgb_queue_get_peak_count( &context->rgb_queue ),
+			rgb_queue_get_max_count( &context->rgb_queue )
+	);
+	// wake latency of the real time consumers:
+	char name[STR_BUFFER_SIZE];
+	snprintf( name, STR_BUFFER_SIZE, "camera %u: select wake latency", context->index );
+	histogram_print( acq_queue_get_wake_latency( &context->acq_queue ), name, "ns" );
+	snprintf( name, STR_BUFFER_SIZE, "camera %u: convert wake latency", context->index );
+	histogram_print( select_queue_get_wake_latency( &context->select_queue ), name, "ns" );
+}
+
+int service_cpu(
+		const uint camera_index,
+		const service_slot_t slot
+)
+{
+	// cpu 0 is left to main and the log thread,
+	// the slots of all cameras are distributed
+	// round robin over the other cpus:
+	const uint cpu_count = thread_get_cpu_count();
+	return 1 + (camera_index * SERVICE_SLOT_COUNT + slot) % (cpu_count - 1);
+}
+
+ret_t check_spin_cpus(
+		const uint camera_count
+)
+{
+	for( uint i=0; i<camera_count; i++ ) {
+		const int select_cpu = service_cpu( i, SERVICE_SLOT_SELECT );
+		for( uint j=0; j<camera_count; j++ ) {
+			for( uint slot=0; slot<SERVICE_SLOT_COUNT; slot++ ) {
+				if(
+						!(j == i && slot == SERVICE_SLOT_SELECT)
+						&& service_cpu( j, slot ) == select_cpu
+				) {
+					log_error( "wait strategy '%s': camera %u: select shares cpu %d with other services, needs %u cpus\n",
+							wait_strategy_str( data.wait_config.strategy ),
+							i,
+							select_cpu,
+							1 + camera_count * SERVICE_SLOT_COUNT
+					);
+					return RET_FAILURE;
+				}
+			}
+		}
+	}
 	return RET_SUCCESS;
 }
 
-void* camera_thread_run(
-		void* p
+uint executor_cpus(
+		int* cpus
+)
+{
+	const uint cpu_count = thread_get_cpu_count();
+	uint count = 0;
+	for( uint cpu=0; cpu<cpu_count && count<EXECUTOR_MAX_WORKERS; cpu++ ) {
+		bool rt_cpu = false;
+		for( uint i=0; i<data.camera_count; i++ ) {
+			for( uint slot=0; slot<SERVICE_SLOT_COUNT; slot++ ) {
+				if( service_cpu( i, slot ) == (int )cpu ) {
+					rt_cpu = true;
+				}
+			}
+		}
+		if( !rt_cpu ) {
+			cpus[count] = cpu;
+			count++;
+		}
+	}
+	return count;
+}
+
+ret_t capture_stage_run(
+		void* arg,
+		const USEC deadline_us
 )
 {
-	const USEC deadline_us = *((USEC* )p);
-	camera_thread.ret = frame_acq_run(
+	camera_context_t* context = arg;
+	return frame_acq_run(
 			deadline_us,
-			&data.camera,
-			&camera_thread.sem,
-			&data.stop,
-			&data.acq_queue
+			context->camera_params.bootstrap_us,
+			&context->camera,
+			&context->frame_dumpster,
+			&context->camera_sem,
+			&context->stop,
+			&context->acq_queue
 	);
-	return &camera_thread.ret;
 }
 
-void* select_thread_run(
-		void* p
+void capture_stage_stop(
+		void* arg
 )
 {
-	const select_parameters_t select_params = *((select_parameters_t *)p);
-	select_thread.ret = select_run(
-			data.deadline_select_us,
-			data.camera.format,
+	camera_context_t* context = arg;
+	context->stop = true;
+	if( sem_post( &context->camera_sem ) ) {
+		log_error( "capture_stage_stop: 'sem_post' failed: %s\n", strerror( errno ) );
+	}
+}
+
+ret_t select_stage_run(
+		void* arg,
+		const USEC deadline_us
+)
+{
+	camera_context_t* context = arg;
+	const select_parameters_t select_params = context->select_params;
+	return select_run(
+			deadline_us,
+			context->camera.format,
 			select_params.acq_interval,
 			select_params.clock_tick_interval,
 			select_params.tick_threshold,
+			select_params.tick_estimator,
 			select_params.max_frames,
-			&data.acq_queue,
-			&data.select_queue,
-			dump_frame
+			&context->acq_queue,
+			&context->select_queue,
+			&context->frame_window
 	);
-	return &select_thread.ret;
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-parameter"
-void* convert_thread_run(
-		void* p
+ret_t convert_stage_run(
+		void* arg,
+		const USEC deadline_us
 )
 {
-	convert_thread.ret = convert_run(
-			data.deadline_convert_us,
-			data.camera.format,
-			&data.select_queue,
-			&data.rgb_queue
+	camera_context_t* context = arg;
+	return convert_run(
+			deadline_us,
+			&context->converter,
+			&context->select_queue,
+			&context->rgb_queue,
+			&context->stages,
+			&context->frame_window
 	);
-	return &convert_thread.ret;
 }
-#pragma GCC diagnostic pop
 
-void* write_to_storage_thread_run(
-		void* p
+void acq_queue_close(
+		void* queue
 )
 {
-	write_to_storage_parameters_t* params = p;
-	write_to_storage_thread.ret = write_to_storage_run(
-			&data.rgb_queue,
-			params->other_services ? &data.rgb_consumers_queue : NULL,
-			params->other_services ? &data.rgb_consumers_done : NULL,
-			params->frame_size,
-			params->output_dir
-	);
-	return &write_to_storage_thread.ret;
+	acq_queue_set_should_stop( queue );
 }
 
-
-void* compressor_thread_run(
-		void* p
+void select_queue_close(
+		void* queue
 )
 {
-	compressor_args_t* params = p;
-	write_to_storage_thread.ret = compressor_run(
-			*params,
-			&data.rgb_consumers_queue,
-			&data.rgb_consumers_done
-	);
-	return &compressor_thread.ret;
+	select_queue_set_should_stop( queue );
 }
 
 #pragma GCC diagnostic push
@@ -547,12 +888,37 @@ void* log_thread_run(
 }
 #pragma GCC diagnostic pop
 
+const char* mode_cache_dir(
+		const synchronome_args_t* args
+)
+{
+	if( args->mode_cache_dir == NULL ) {
+		return args->output_dir;
+	}
+	if( args->mode_cache_dir[0] == '\0' ) {
+		return NULL;
+	}
+	return args->mode_cache_dir;
+}
+
+frame_size_t output_frame_size(
+		const synchronome_args_t* args
+)
+{
+	if( args->output_size.width == 0 || args->output_size.height == 0 ) {
+		return args->size;
+	}
+	return args->output_size;
+}
+
 void sequencer(int sig) {
 	if( sig == SIGALRM ) {
-		if( sem_post( &camera_thread.sem ) == -1 ) {
-			// TODO: check if this is legal in a signal handler:
-			log_error( "sequencer: 'sem_post' failed: %s\n", strerror( errno ) );
-			exit(1);
+		for( uint i=0; i<data.camera_count; i++ ) {
+			if( sem_post( &data.cameras[i].camera_sem ) == -1 ) {
+				// TODO: check if this is legal in a signal handler:
+				log_error( "sequencer: 'sem_post' failed: %s\n", strerror( errno ) );
+				exit(1);
+			}
 		}
 	}
 }
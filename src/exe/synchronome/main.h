@@ -3,20 +3,58 @@
 #include "lib/global.h"
 
 #include "lib/camera.h"
+#include "lib/image.h"
+#include "lib/wait.h"
+#include "select.h"
 
 /********************
  * Function Decls
 ********************/
 
+#define SYNCHRONOME_MAX_CAMERAS 8
+
 typedef struct {
+	// one pipeline per camera.
+	// With more than one camera, frames are stored
+	// in "OUTPUT_DIR/camN" (N: index of the camera):
+	const char* dev_names[SYNCHRONOME_MAX_CAMERAS];
+	uint camera_count;
 	pixel_format_t pixel_format;
 	frame_size_t size;
 	frame_interval_t acq_interval;
 	frame_interval_t clock_tick_interval;
 	float tick_threshold;
+	tick_estimator_t tick_estimator;
+	// seed the diff statistics from a burst
+	// of frames at the native camera rate:
+	bool fast_start;
 	uint max_frames;
 	char* output_dir;
+	// camera modes are cached here
+	// (NULL: output_dir, "": no cache):
+	const char* mode_cache_dir;
 	uint compress_bundle_size; // 0 means no bundling
+	uint compress_keyframe_interval; // 0 means no delta coding
+	output_format_t output_format;
+	// downscale converted frames
+	// (0x0: capture size):
+	frame_size_t output_size;
+	// append frames to container files
+	// instead of one file per frame:
+	bool container;
+	uint container_max_size_mb; // 0 means no limit
+	uint container_max_frames; // 0 means no limit
+	// write frames into a memory mapped
+	// ring file with this many slots (0: disabled):
+	uint ring_file_slots;
+	// one file per frame only:
+	uint shard_frames; // 0: no sharding
+	bool shard_hourly;
+	bool atomic_files;
+	// how select waits for its input
+	// (convert always blocks):
+	wait_strategy_t wait_strategy;
+	uint spin_us; // WAIT_SPIN_THEN_BLOCK only
 } synchronome_args_t;
 
 ret_t synchronome_run( const synchronome_args_t args );
@@ -4,11 +4,14 @@
 #include "lib/spsc_queue.h"
 #include "lib/time.h"
 
-typedef void (*dump_frame_func_t)(frame_buffer_t frame);
+typedef void (*dump_frame_func_t)(void* context, frame_buffer_t frame);
 
 typedef struct {
 	timeval_t time;
 	frame_buffer_t frame;
+	// captured at the native camera rate
+	// before the sequencer starts (fast start):
+	bool bootstrap;
 } acq_entry_t;
 
 DECL_SPSC_QUEUE(acq_queue,acq_entry_t)
@@ -0,0 +1,110 @@
+#include "frame_window.h"
+
+#include "lib/output.h"
+
+#include <stdatomic.h>
+
+
+void frame_window_init(
+		frame_window_t* window,
+		const uint max_count,
+		const uint buffer_count,
+		dump_frame_func_t dump_frame,
+		void* dump_context
+)
+{
+	frame_history_init( &window->history, max_count );
+	window->pin_counts = NULL;
+	CALLOC( window->pin_counts, buffer_count, sizeof(_Atomic int) );
+	window->buffer_count = buffer_count;
+	window->dump_frame = dump_frame;
+	window->dump_context = dump_context;
+}
+
+void frame_window_exit(
+		frame_window_t* window
+)
+{
+	if( window->pin_counts == NULL ) {
+		// not initialized
+		return;
+	}
+	frame_window_clear( window );
+	frame_history_exit( &window->history );
+	FREE( window->pin_counts );
+}
+
+void frame_window_clear(
+		frame_window_t* window
+)
+{
+	while( frame_history_get_count( &window->history ) > 0 ) {
+		frame_window_unpin( window, &frame_history_get( &window->history )->frame );
+		frame_history_pop( &window->history );
+	}
+}
+
+uint frame_window_get_count(
+		frame_window_t* window
+)
+{
+	return frame_history_get_count( &window->history );
+}
+
+uint frame_window_get_max_count(
+		frame_window_t* window
+)
+{
+	return frame_history_get_max_count( &window->history );
+}
+
+acq_entry_t* frame_window_get_index(
+		frame_window_t* window,
+		const uint index
+)
+{
+	return frame_history_get_index( &window->history, index );
+}
+
+bool frame_window_push(
+		frame_window_t* window,
+		const acq_entry_t* entry
+)
+{
+	bool dropped = false;
+	if( frame_history_get_count( &window->history ) >= frame_history_get_max_count( &window->history ) ) {
+		frame_window_unpin( window, &frame_history_get( &window->history )->frame );
+		frame_history_pop( &window->history );
+		dropped = true;
+	}
+	frame_window_pin( window, &entry->frame );
+	acq_entry_t* dst = NULL;
+	frame_history_push_start( &window->history, &dst );
+	(*dst) = (*entry);
+	frame_history_push_end( &window->history );
+	return dropped;
+}
+
+void frame_window_pin(
+		frame_window_t* window,
+		const frame_buffer_t* frame
+)
+{
+	assert( frame->index >= 0 && (uint )frame->index < window->buffer_count );
+	atomic_fetch_add( &window->pin_counts[frame->index], 1 );
+}
+
+void frame_window_unpin(
+		frame_window_t* window,
+		const frame_buffer_t* frame
+)
+{
+	assert( frame->index >= 0 && (uint )frame->index < window->buffer_count );
+	const int pin_count = atomic_fetch_sub( &window->pin_counts[frame->index], 1 ) - 1;
+	assert( pin_count >= 0 );
+	if( pin_count == 0 ) {
+		window->dump_frame( window->dump_context, *frame );
+	}
+}
+
+DEF_RING_BUFFER(frame_history,acq_entry_t)
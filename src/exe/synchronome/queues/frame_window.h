@@ -0,0 +1,80 @@
+/****************************
+ * Frame History Window
+ *
+ * the last 'max_count' acquired frames,
+ * oldest first (no synchronization: one owner).
+ * Camera buffers are reference counted ("pinned"):
+ * - frames in the window are pinned by it
+ * - consumers pin frames they keep beyond the window
+ *   and unpin them when done (thread safe)
+ * A frame is returned to the camera as soon
+ * as it is no longer pinned.
+ ***************************/
+#pragma once
+
+#include "acq_queue.h"
+#include "lib/ring_buffer.h"
+
+
+DECL_RING_BUFFER(frame_history,acq_entry_t)
+
+typedef struct {
+	frame_history_t history;
+	// pin count per camera buffer index:
+	_Atomic int* pin_counts;
+	uint buffer_count;
+	dump_frame_func_t dump_frame;
+	void* dump_context;
+} frame_window_t;
+
+void frame_window_init(
+		frame_window_t* window,
+		const uint max_count,
+		const uint buffer_count, // number of camera buffers
+		dump_frame_func_t dump_frame,
+		void* dump_context // passed to 'dump_frame'
+);
+
+// unpins all frames in the window
+// (no-op if not initialized)
+void frame_window_exit(
+		frame_window_t* window
+);
+
+// unpins all frames in the window
+void frame_window_clear(
+		frame_window_t* window
+);
+
+uint frame_window_get_count(
+		frame_window_t* window
+);
+
+uint frame_window_get_max_count(
+		frame_window_t* window
+);
+
+// 0: oldest
+acq_entry_t* frame_window_get_index(
+		frame_window_t* window,
+		const uint index
+);
+
+// add the latest frame.
+// If the window is full, the oldest
+// frame is dropped (unpinned).
+// returns true if a frame was dropped
+bool frame_window_push(
+		frame_window_t* window,
+		const acq_entry_t* entry
+);
+
+void frame_window_pin(
+		frame_window_t* window,
+		const frame_buffer_t* frame
+);
+
+void frame_window_unpin(
+		frame_window_t* window,
+		const frame_buffer_t* frame
+);
@@ -13,15 +13,20 @@
 
 DEF_SPSC_QUEUE(rgb_queue,rgb_entry_t,DBG_LOG,ERR_LOG);
 
-void rgb_queue_init_frames( rgb_queue_t* queue, const frame_size_t size)
+void rgb_queue_init_frames(
+		rgb_queue_t* queue,
+		const frame_size_t size,
+		const output_format_t format
+)
 {
 	const uint max_count = rgb_queue_get_max_count(queue);
 	for( uint i=0; i<max_count; ++i ) {
 		queue->entries[i].frame.data = NULL;
-		queue->entries[i].frame.size = image_rgb_size( size.width, size.height );
+		queue->entries[i].frame.max_size = image_output_size( format, size.width, size.height );
+		queue->entries[i].frame.size = queue->entries[i].frame.max_size;
 		CALLOC(
 				queue->entries[i].frame.data,
-				queue->entries[i].frame.size,
+				queue->entries[i].frame.max_size,
 				1
 		);
 	}
@@ -33,5 +38,3 @@ void rgb_queue_exit_frames( rgb_queue_t* queue )
 		FREE( queue->entries[i].frame.data );
 	}
 }
-
-DEF_SPSC_QUEUE(rgb_consumers_queue,rgb_entry_t*,DBG_LOG,ERR_LOG);
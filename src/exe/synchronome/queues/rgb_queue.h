@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lib/camera.h"
+#include "lib/image.h"
 #include "lib/time.h"
 #include "lib/spsc_queue.h"
 
@@ -8,7 +9,8 @@
 
 typedef struct {
 	byte_t* data;
-	uint size;
+	uint size; // bytes used
+	uint max_size;
 } rgb_frame_t;
 
 typedef struct {
@@ -18,7 +20,11 @@ typedef struct {
 
 DECL_SPSC_QUEUE(rgb_queue,rgb_entry_t)
 
-void rgb_queue_init_frames( rgb_queue_t* queue, const frame_size_t size);
+// allocate frames of max_size
+// `image_output_size(format, size)`:
+void rgb_queue_init_frames(
+		rgb_queue_t* queue,
+		const frame_size_t size,
+		const output_format_t format
+);
 void rgb_queue_exit_frames( rgb_queue_t* queue );
-
-DECL_SPSC_QUEUE(rgb_consumers_queue,rgb_entry_t*)
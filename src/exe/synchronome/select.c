@@ -7,9 +7,30 @@
 #include "lib/time.h"
 #include "lib/thread.h"
 
+#include <math.h>
+
 
 const uint adjustment_inertia = 4;
 const uint sync_threshold = 4;
+// fast start: the first tick comes from the bootstrap
+// burst, one more tick on time confirms the sync:
+const uint fast_start_sync_threshold = 2;
+// minimum number of bootstrap diffs
+// to seed the diff statistics:
+const uint bootstrap_min_diff_count = 8;
+
+// PLL loop gains (phase, period).
+// Measured tick times are quantized to the
+// acquisition interval, small gains average
+// out this error over several ticks:
+const double pll_alpha = 0.2;
+const double pll_beta = 0.02;
+// weak pull of the predicted tick
+// towards the center of the measurement window:
+const double pll_center_gain = 0.3;
+// period estimate is kept within this
+// fraction of the nominal tick interval:
+const double pll_max_period_deviation = 0.1;
 
 
 // calculate avg diff over an
@@ -21,13 +42,48 @@ DECL_RING_BUFFER(diff_buffer,float)
 typedef struct {
 	diff_buffer_t diff_buffer;
 	float median_diff;
+	float lower_quartile_diff;
 	float avg_diff;
 	float max_diff;
 	float min_diff;
+	// seeded from a bootstrap burst:
+	// statistics are valid before the buffer is full.
+	// The burst diffs are dropped when sequencing starts,
+	// the order statistics keep their burst values until
+	// 'bootstrap_min_diff_count' sequenced diffs arrived.
+	// Until the buffer has been refilled, max_diff is
+	// at least 'seed_max_diff':
+	bool seeded;
+	float seed_max_diff;
+	uint seed_frames_left;
 } diff_statistics_t;
 
+// diffs between frames of the bootstrap burst:
+typedef struct {
+	// last frame was part of the burst:
+	bool active;
+	uint diff_count;
+	float max_diff;
+	// time of the frame after the max diff:
+	timeval_t max_diff_time;
+} bootstrap_state_t;
+
+// sub-frame estimate of a detected tick,
+// available one frame after the detection.
+// times in seconds:
+typedef struct {
+	bool valid;
+	// time of the frame the tick was detected in:
+	double frame_time;
+	// estimated time of the tick,
+	// within [frame_time - acq_interval, frame_time]:
+	double tick_time;
+} tick_measurement_t;
+
 typedef struct {
 	uint sync_status;
+	// consecutive ticks on time needed:
+	uint threshold;
 	timeval_t last_tick_time;
 } synchronize_state_t;
 
@@ -38,8 +94,26 @@ typedef struct {
 	int requested_drift_correction;
 	int select_prefer_latest;
 	bool sleep_one_frame;
+	// sub-frame estimates of the last
+	// two measured ticks (seconds, < 0: none):
+	double last_tick_estimate;
+	double prev_tick_estimate;
 } tick_parser_state_t;
 
+// all times in seconds:
+typedef struct {
+	// predicted time of the next tick:
+	double next_tick;
+	// estimated tick interval:
+	double period;
+	// select the frame closest to this time
+	// (in the middle between two ticks):
+	double next_select;
+	// target of the last selection:
+	double last_select;
+	int selected_count;
+} pll_state_t;
+
 typedef struct {
 	// how many frames
 	// have been accumulated:
@@ -48,10 +122,18 @@ typedef struct {
 	synchronize_state_t synchronize_state;
 	// tick/phase statistics:
 	tick_parser_state_t tick_parser_state;
+	pll_state_t pll_state;
 	// selection data:
 	int last_tick_index;
+	bool prev_tick_detected;
 	// image diff statistics:
 	diff_statistics_t diff_statistics;
+	bootstrap_state_t bootstrap_state;
+	// MJPEG: luma of the last two frames,
+	// frames are never fully decoded for the diff:
+	bool jpeg;
+	image_luma_t lumas[2];
+	uint luma_index; // newest frame
 
 } select_state_t;
 
@@ -59,11 +141,16 @@ typedef struct {
  * Function Decls
 ********************/
 
-void cleanup_frames(
-		const uint max_frame_acc_count,
-		dump_frame_func_t dump_frame,
-		uint* frame_acc_count,
-		acq_queue_t* input_queue
+void select_state_exit(
+		select_state_t* state
+);
+
+// diff of the two newest frames in the window:
+ret_t select_diff(
+		const img_format_t src_format,
+		select_state_t* state,
+		frame_window_t* frame_window,
+		float* diff_value
 );
 
 int update_img_diff(
@@ -72,6 +159,34 @@ int update_img_diff(
 		diff_statistics_t* diff_statistics
 );
 
+// min, max, median, ... over the values in the diff buffer
+// (the buffer may be partially filled):
+void update_diff_order_statistics(
+		diff_statistics_t* diff_statistics
+);
+
+// use the diffs of the bootstrap burst as a preliminary
+// diff statistic, and its max diff as the first tick:
+void bootstrap_finish(
+		const bootstrap_state_t* bootstrap_state,
+		diff_statistics_t* diff_statistics,
+		synchronize_state_t* synchronize_state
+);
+
+// drop the burst diffs from the diff buffer,
+// keep the statistics derived from them:
+void bootstrap_drop_diffs(
+		diff_statistics_t* diff_statistics
+);
+
+// fit a parabola through the diff values
+// around a tick detected in the previous frame:
+tick_measurement_t estimate_tick_time(
+		const timeval_t tick_frame_time,
+		const float acq_interval,
+		diff_statistics_t* diff_statistics
+);
+
 int synchronize(
 		const timeval_t frame_time,
 		const bool tick_detected,
@@ -90,19 +205,51 @@ int tick_parser(
 		const float acq_interval,
 		const float clock_tick_interval,
 		const bool tick_detected,
+		const tick_measurement_t* tick_measurement,
 		const uint frame_acc_count,
 		const int max_frames, // -1 means no limit
 		tick_parser_state_t* state,
-		acq_queue_t* input_queue,
+		frame_window_t* frame_window,
 		select_queue_t* output_queue,
 		int* last_tick_index
 );
 
+void pll_tick_parser_init(
+		const timeval_t frame_time,
+		const float acq_interval,
+		const float clock_tick_interval,
+		pll_state_t* state
+);
+
+int pll_tick_parser(
+		const timeval_t frame_time,
+		const float acq_interval,
+		const float clock_tick_interval,
+		const tick_measurement_t* tick_measurement,
+		const uint frame_acc_count,
+		const int max_frames, // -1 means no limit
+		pll_state_t* state,
+		frame_window_t* frame_window,
+		select_queue_t* output_queue
+);
+
+// index of the frame closest to 'target_time':
+int select_closest_frame(
+		const double target_time,
+		const uint frame_acc_count,
+		frame_window_t* frame_window
+);
+
+double time_sec_from_timespec(
+		const timeval_t* time
+);
+
 /********************
  * Function Defs
 ********************/
 
-static timeval_t current_time;
+// per thread (one select thread per camera):
+static _Thread_local timeval_t current_time;
 
 #define SERVICE_NAME "select"
 
@@ -154,11 +301,11 @@ static timeval_t current_time;
 		}
 
 /* Remark:
- * this function will clean up old frames.
- * Consumers of the output_queue must
- * be fast enough processing selected frames,
- * before they will be cleaned up to prevent
- * a segfault!
+ * frames are moved from the input_queue
+ * into 'frame_window' immediately.
+ * Selected frames are pinned before they are
+ * pushed to the output_queue, consumers
+ * must unpin them when done.
  */
 ret_t select_run(
 		const USEC deadline_us,
@@ -166,10 +313,11 @@ ret_t select_run(
 		const float acq_interval,
 		const float clock_tick_interval,
 		const float tick_threshold,
+		const tick_estimator_t tick_estimator,
 		const int max_frames, // -1 means no limit
 		acq_queue_t* input_queue,
 		select_queue_t* output_queue,
-		dump_frame_func_t dump_frame
+		frame_window_t* frame_window
 )
 {
 	thread_info( SERVICE_NAME );
@@ -182,32 +330,70 @@ ret_t select_run(
 	API_RUN( select_get_frame_acc_count(
 			acq_interval,
 			clock_tick_interval,
+			tick_estimator,
 			&max_frame_acc_count
 	) );
-	static select_state_t state;
+	ASSERT( frame_window_get_max_count( frame_window ) >= max_frame_acc_count );
+	select_state_t state = { 0 };
 	state.tick_parser_state.measured_tick_count = -1;
 	const int sampling_resolution = clock_tick_interval / acq_interval ;
 	VERBOSE_PRINT( "max_frame_acc_count: %4u\n", max_frame_acc_count );
 	VERBOSE_PRINT( "sampling_resolution: %d\n", sampling_resolution );
+	VERBOSE_PRINT( "tick estimator: %s\n", select_tick_estimator_str( tick_estimator ) );
 	diff_buffer_init( &state.diff_statistics.diff_buffer, diff_buffer_max_count );
 	state.diff_statistics.median_diff = -1;
 	state.diff_statistics.max_diff = 0;
 	state.diff_statistics.min_diff = 100;
+	state.synchronize_state.threshold = sync_threshold;
+	state.jpeg = (src_format.pixelformat == V4L2_PIX_FMT_MJPEG);
+	if( state.jpeg ) {
+		image_luma_init( &state.lumas[0], src_format.width, src_format.height );
+		image_luma_init( &state.lumas[1], src_format.width, src_format.height );
+	}
 	while( true ) {
-		// cleanup obsolete old frames:
-		cleanup_frames( max_frame_acc_count, dump_frame, &state.frame_acc_count, input_queue );
 		// get next frame:
 		acq_queue_read_start( input_queue );
 		if( acq_queue_get_should_stop( input_queue ) ) {
 			VERBOSE_PRINT( "stopping\n" );
-			diff_buffer_exit( &state.diff_statistics.diff_buffer );
+			select_state_exit( &state );
 			break;
 		}
 		current_time = time_measure_current_time();
 		timeval_t start_time = current_time;
 		LOG_TIME( "START\n" );
-		state.frame_acc_count++;
-		timeval_t frame_time = acq_queue_read_get_index(input_queue,state.frame_acc_count-1)->time;
+		const acq_entry_t* entry = acq_queue_read_get( input_queue );
+		const bool bootstrap = entry->bootstrap;
+		if( state.bootstrap_state.active && !bootstrap ) {
+			// first sequenced frame:
+			bootstrap_finish(
+					&state.bootstrap_state,
+					&state.diff_statistics,
+					&state.synchronize_state
+			);
+			state.bootstrap_state.active = false;
+			// burst frames have a different interval:
+			frame_window_clear( frame_window );
+			bootstrap_drop_diffs( &state.diff_statistics );
+		}
+		state.bootstrap_state.active = bootstrap;
+		// move it into the window (dropping the oldest frame),
+		// the queue slot is free again right away:
+		if( frame_window_push( frame_window, entry ) ) {
+			// keep pointing to the same frame:
+			state.last_tick_index--;
+		}
+		acq_queue_read_stop_dump( input_queue );
+		state.frame_acc_count = frame_window_get_count( frame_window );
+		timeval_t frame_time = frame_window_get_index(frame_window,state.frame_acc_count-1)->time;
+		if( state.jpeg ) {
+			const frame_buffer_t* frame = &frame_window_get_index(frame_window,state.frame_acc_count-1)->frame;
+			state.luma_index ^= 1;
+			API_RUN(image_jpeg_luma(
+					frame->data,
+					frame->size,
+					&state.lumas[state.luma_index]
+			));
+		}
 		if( state.frame_acc_count < 2 ) {
 			LOG_TIME_END()
 			continue;
@@ -215,12 +401,23 @@ ret_t select_run(
 		ASSERT( state.frame_acc_count >= 2 );
 		// calc image difference:
 		float diff_value;
-		API_RUN(image_diff(
+		API_RUN(select_diff(
 				src_format,
-				acq_queue_read_get_index(input_queue,state.frame_acc_count-1)->frame.data,
-				acq_queue_read_get_index(input_queue,state.frame_acc_count-2)->frame.data,
+				&state,
+				frame_window,
 				&diff_value
 		));
+		if( bootstrap ) {
+			// only collect diff statistics:
+			update_img_diff( frame_time, diff_value, &state.diff_statistics);
+			if( diff_value > state.bootstrap_state.max_diff ) {
+				state.bootstrap_state.max_diff = diff_value;
+				state.bootstrap_state.max_diff_time = frame_time;
+			}
+			state.bootstrap_state.diff_count++;
+			LOG_TIME_END()
+			continue;
+		}
 		// update image diff statistics
 		{
 			int ret = update_img_diff( frame_time, diff_value, &state.diff_statistics);
@@ -229,9 +426,28 @@ ret_t select_run(
 				continue;
 			}
 		}
-		ASSERT( diff_buffer_get_count(&state.diff_statistics.diff_buffer) >= diff_buffer_max_count );
+		ASSERT(
+				state.diff_statistics.seeded
+				|| diff_buffer_get_count(&state.diff_statistics.diff_buffer) >= diff_buffer_max_count
+		);
 
-		bool tick_detected = ((diff_value - state.diff_statistics.median_diff) / (state.diff_statistics.max_diff - state.diff_statistics.median_diff)) > tick_threshold;
+		// with only 2 frames per tick (PLL), up to half of the
+		// diff values are ticks, so the median is no baseline:
+		const float base_diff = (tick_estimator == TICK_ESTIMATOR_PLL)
+			? state.diff_statistics.lower_quartile_diff
+			: state.diff_statistics.median_diff;
+		bool tick_detected = ((diff_value - base_diff) / (state.diff_statistics.max_diff - base_diff)) > tick_threshold;
+		// sub-frame time of a tick
+		// detected in the previous frame:
+		tick_measurement_t tick_measurement = { .valid = false };
+		if( state.prev_tick_detected ) {
+			tick_measurement = estimate_tick_time(
+					frame_window_get_index(frame_window,state.frame_acc_count-2)->time,
+					acq_interval,
+					&state.diff_statistics
+			);
+		}
+		state.prev_tick_detected = tick_detected;
 
 		// initial sync phase:
 		{
@@ -243,13 +459,24 @@ ret_t select_run(
 					&state.synchronize_state
 			);
 			if( 1 == ret ) {
-				diff_buffer_exit( &state.diff_statistics.diff_buffer );
+				select_state_exit( &state );
 				return RET_FAILURE;
 			}
 			if( -1 == ret ) {
 				LOG_TIME_END()
 				continue;
 			}
+			if( -2 == ret && tick_estimator == TICK_ESTIMATOR_PLL ) {
+				pll_tick_parser_init(
+						frame_time,
+						acq_interval,
+						clock_tick_interval,
+						&state.pll_state
+				);
+				VERBOSE_PRINT_FRAME( "TICK 0\n" );
+				LOG_TIME_END()
+				continue;
+			}
 			if( -2 == ret ) {
 				// initialize next phase:
 				tick_parser_init(
@@ -258,11 +485,33 @@ ret_t select_run(
 				);
 				state.last_tick_index = state.frame_acc_count-1;
 				VERBOSE_PRINT_FRAME( "TICK 0\n" );
-				state.last_tick_index--;
 				LOG_TIME_END()
 				continue;
 			}
 		}
+		if( tick_estimator == TICK_ESTIMATOR_PLL ) {
+			int ret = pll_tick_parser(
+					frame_time,
+					acq_interval,
+					clock_tick_interval,
+					&tick_measurement,
+					state.frame_acc_count,
+					max_frames,
+					&state.pll_state,
+					frame_window,
+					output_queue
+			);
+			if( ret == 1 ) {
+				select_state_exit( &state );
+				return RET_FAILURE;
+			}
+			else if( ret == -1 ) {
+				select_state_exit( &state );
+				break;
+			}
+			LOG_TIME_END()
+			continue;
+		}
 		state.tick_parser_state.frame_index ++;
 
 		// autonomously execute tick every clock_tick_rate:
@@ -281,64 +530,101 @@ ret_t select_run(
 					acq_interval,
 					clock_tick_interval,
 					tick_detected,
+					&tick_measurement,
 					state.frame_acc_count,
 					max_frames,
 					&state.tick_parser_state,
-					input_queue,
+					frame_window,
 					output_queue,
 					&state.last_tick_index
 			);
 			if( ret == 1 ) {
-				diff_buffer_exit( &state.diff_statistics.diff_buffer );
+				select_state_exit( &state );
 				return RET_FAILURE;
 			}
 			else if( ret == -1 ) {
-				diff_buffer_exit( &state.diff_statistics.diff_buffer );
+				select_state_exit( &state );
 				break;
 			}
 		}
-		state.last_tick_index--;
 		LOG_TIME_END()
 	}
 	VERBOSE_PRINT( "finished\n" );
 	return RET_SUCCESS;
 }
 
+void select_state_exit(
+		select_state_t* state
+)
+{
+	diff_buffer_exit( &state->diff_statistics.diff_buffer );
+	if( state->jpeg ) {
+		image_luma_exit( &state->lumas[0] );
+		image_luma_exit( &state->lumas[1] );
+	}
+}
+
+ret_t select_diff(
+		const img_format_t src_format,
+		select_state_t* state,
+		frame_window_t* frame_window,
+		float* diff_value
+)
+{
+	if( state->jpeg ) {
+		// (the luma of every frame pushed
+		// into the window has been decoded)
+		return image_luma_diff(
+				&state->lumas[state->luma_index],
+				&state->lumas[state->luma_index ^ 1],
+				diff_value
+		);
+	}
+	return image_diff(
+			src_format,
+			frame_window_get_index(frame_window,state->frame_acc_count-1)->frame.data,
+			frame_window_get_index(frame_window,state->frame_acc_count-2)->frame.data,
+			diff_value
+	);
+}
+
 // how many frames will be accumulated
 // at maximum while running `select_run`?
 ret_t select_get_frame_acc_count(
 		const float acq_interval,
 		const float clock_tick_interval,
+		const tick_estimator_t tick_estimator,
 		uint* frame_acc_count
 )
 {
 	const int sampling_resolution = clock_tick_interval / acq_interval ;
 	ASSERT( acq_interval > 0.001 );
 	ASSERT( clock_tick_interval > 0.001 );
-	ASSERT( sampling_resolution >= 3 );
+	if( tick_estimator == TICK_ESTIMATOR_PLL ) {
+		ASSERT( sampling_resolution >= 2 );
+	}
+	else {
+		ASSERT( sampling_resolution >= 3 );
+	}
 	(*frame_acc_count) =
 		sampling_resolution
 		+ 1 // frame select is one frame AFTER internal tick
-		+ 1 // one frame deadline for further processing
-		+ 2 // some headroom, just to be safe...
+		+ 1 // previous frame (image diff)
+		+ 1 // interval stretched by a drift correction
 	;
 	ASSERT( (*frame_acc_count) > 2 );
 	return RET_SUCCESS;
 }
 
-// cleanup obsolete old frames:
-void cleanup_frames(
-		const uint max_frame_acc_count,
-		dump_frame_func_t dump_frame,
-		uint* frame_acc_count,
-		acq_queue_t* input_queue
-) {
-	if( (*frame_acc_count) >= max_frame_acc_count ) {
-		// dump obsolete frames:
-		dump_frame( acq_queue_read_get_index(input_queue,0)->frame );
-		acq_queue_read_stop_dump(input_queue);
-		(*frame_acc_count)--;
+const char* select_tick_estimator_str(
+		const tick_estimator_t tick_estimator
+)
+{
+	switch( tick_estimator ) {
+		case TICK_ESTIMATOR_VOTE: return "vote";
+		case TICK_ESTIMATOR_PLL: return "pll";
 	}
+	return "unknown";
 }
 
 int compare_float( const void* p1, const void* p2 ) {
@@ -356,7 +642,6 @@ int update_img_diff(
 		const float diff_value,
 		diff_statistics_t* diff_statistics
 ) {
-	static float sorted[diff_buffer_max_count];
 	if( diff_buffer_get_count(&diff_statistics->diff_buffer) < diff_buffer_max_count ) {
 		// cumulative average:
 		const uint n = diff_buffer_get_count(&diff_statistics->diff_buffer);
@@ -369,6 +654,12 @@ int update_img_diff(
 		diff_buffer_push_start( &diff_statistics->diff_buffer, &dst );
 		(*dst) = diff_value;
 		diff_buffer_push_end( &diff_statistics->diff_buffer );
+		if(
+				diff_statistics->seeded
+				&& n+1 >= bootstrap_min_diff_count
+		) {
+			update_diff_order_statistics( diff_statistics );
+		}
 	}
 	else {
 		float oldest_diff = *diff_buffer_get( &diff_statistics->diff_buffer );
@@ -377,17 +668,14 @@ int update_img_diff(
 		diff_buffer_push_start( &diff_statistics->diff_buffer, &dst );
 		(*dst) = diff_value;
 		diff_buffer_push_end( &diff_statistics->diff_buffer );
-		// not very efficient, but works:
-		for( uint i=0; i<diff_buffer_max_count; i++ ) {
-			sorted[i] = *diff_buffer_get_index(&diff_statistics->diff_buffer, i);
-		}
-		qsort(&sorted, diff_buffer_max_count, sizeof(float), compare_float);
-		diff_statistics->min_diff = sorted[0];
-		diff_statistics->max_diff = sorted[diff_buffer_max_count-1-2];
-		diff_statistics->median_diff = sorted[diff_buffer_max_count/2];
+		update_diff_order_statistics( diff_statistics );
 		diff_statistics->avg_diff -= oldest_diff / diff_buffer_max_count;
 		diff_statistics->avg_diff += diff_value / diff_buffer_max_count;
 	}
+	if( diff_statistics->seed_frames_left > 0 ) {
+		diff_statistics->max_diff = MAX( diff_statistics->max_diff, diff_statistics->seed_max_diff );
+		diff_statistics->seed_frames_left--;
+	}
 	VERBOSE_PRINT_FRAME( "diff value: %f, median: %f, range: %f...%f, avg: %f\n",
 			(diff_value  - diff_statistics->median_diff) / (diff_statistics->max_diff - diff_statistics->median_diff),
 			diff_statistics->median_diff,
@@ -396,7 +684,10 @@ int update_img_diff(
 			diff_statistics->avg_diff
 	);
 	// wait until diff statistics are stable
-	if( diff_buffer_get_count(&diff_statistics->diff_buffer) < diff_buffer_max_count ) {
+	if(
+			!diff_statistics->seeded
+			&& diff_buffer_get_count(&diff_statistics->diff_buffer) < diff_buffer_max_count
+	) {
 		VERBOSE_PRINT_FRAME( "collect diff statistics: %u/%u\n",
 				diff_buffer_get_count(&diff_statistics->diff_buffer),
 				diff_buffer_max_count
@@ -406,6 +697,66 @@ int update_img_diff(
 	return 0;
 }
 
+void update_diff_order_statistics(
+		diff_statistics_t* diff_statistics
+)
+{
+	float sorted[diff_buffer_max_count];
+	const uint n = diff_buffer_get_count(&diff_statistics->diff_buffer);
+	// not very efficient, but works:
+	for( uint i=0; i<n; i++ ) {
+		sorted[i] = *diff_buffer_get_index(&diff_statistics->diff_buffer, i);
+	}
+	qsort(&sorted, n, sizeof(float), compare_float);
+	diff_statistics->min_diff = sorted[0];
+	// ignore the 2 largest values (per full buffer) as outliers:
+	diff_statistics->max_diff = sorted[n-1-2*n/diff_buffer_max_count];
+	diff_statistics->median_diff = sorted[n/2];
+	diff_statistics->lower_quartile_diff = sorted[n/4];
+}
+
+void bootstrap_finish(
+		const bootstrap_state_t* bootstrap_state,
+		diff_statistics_t* diff_statistics,
+		synchronize_state_t* synchronize_state
+)
+{
+	const timeval_t frame_time = bootstrap_state->max_diff_time;
+	if( bootstrap_state->diff_count < bootstrap_min_diff_count ) {
+		LOG_WARNING_FRAME( "bootstrap: too few frames (%u < %u), no fast start\n",
+				bootstrap_state->diff_count,
+				bootstrap_min_diff_count
+		);
+		return;
+	}
+	update_diff_order_statistics( diff_statistics );
+	// the burst spans about one tick interval,
+	// i.e. it contains only one or two ticks:
+	diff_statistics->max_diff = bootstrap_state->max_diff;
+	diff_statistics->seeded = true;
+	diff_statistics->seed_max_diff = bootstrap_state->max_diff;
+	diff_statistics->seed_frames_left = diff_buffer_max_count;
+	// the max diff is taken as the first tick,
+	// the next one on time confirms the sync:
+	synchronize_state->sync_status = 1;
+	synchronize_state->threshold = fast_start_sync_threshold;
+	synchronize_state->last_tick_time = frame_time;
+	VERBOSE_PRINT_FRAME( "bootstrap: %u diffs, median: %f, max: %f, first tick\n",
+			bootstrap_state->diff_count,
+			diff_statistics->median_diff,
+			diff_statistics->max_diff
+	);
+}
+
+void bootstrap_drop_diffs(
+		diff_statistics_t* diff_statistics
+)
+{
+	while( diff_buffer_get_count( &diff_statistics->diff_buffer ) > 0 ) {
+		diff_buffer_pop( &diff_statistics->diff_buffer );
+	}
+}
+
 int synchronize(
 		const timeval_t frame_time,
 		const bool tick_detected,
@@ -415,7 +766,7 @@ int synchronize(
 ) {
 	const float sampling_precision = acq_interval / clock_tick_interval ;
 	const float epsilon = sampling_precision/2;
-	if( state->sync_status >= sync_threshold ) {
+	if( state->sync_status >= state->threshold ) {
 		return 0;
 	}
 	if( tick_detected ) {
@@ -425,7 +776,7 @@ int synchronize(
 			state->sync_status++;
 			VERBOSE_PRINT_FRAME( "sync: %u/%u\n",
 					state->sync_status,
-					sync_threshold
+					state->threshold
 			);
 			return -1;
 		}
@@ -444,17 +795,17 @@ int synchronize(
 			return -1;
 		}
 		state->sync_status++;
-		if( state->sync_status == sync_threshold ) {
+		if( state->sync_status == state->threshold ) {
 			VERBOSE_PRINT_FRAME( "sync: %u/%u\n",
 					state->sync_status,
-					sync_threshold
+					state->threshold
 			);
 			return -2;
 		}
 		state->last_tick_time = frame_time;
 		VERBOSE_PRINT_FRAME( "sync: %u/%u\n",
 				state->sync_status,
-				sync_threshold
+				state->threshold
 		);
 		return -1;
 	}
@@ -472,6 +823,8 @@ void tick_parser_init(
 	state->requested_drift_correction = 0;
 	state->select_prefer_latest = 0;
 	state->sleep_one_frame = false;
+	state->last_tick_estimate = -1;
+	state->prev_tick_estimate = -1;
 }
 
 // register detected ticks and drift:
@@ -480,10 +833,11 @@ int tick_parser(
 		const float acq_interval,
 		const float clock_tick_interval,
 		const bool tick_detected,
+		const tick_measurement_t* tick_measurement,
 		const uint frame_acc_count,
 		const int max_frames, // -1 means no limit
 		tick_parser_state_t* state,
-		acq_queue_t* input_queue,
+		frame_window_t* frame_window,
 		select_queue_t* output_queue,
 		int* last_tick_index
 )
@@ -491,6 +845,10 @@ int tick_parser(
 	const int sampling_resolution = clock_tick_interval / acq_interval;
 	const int tick_count = state->frame_index / sampling_resolution;
 	const int phase = state->frame_index % sampling_resolution;
+	if( tick_measurement->valid ) {
+		state->prev_tick_estimate = state->last_tick_estimate;
+		state->last_tick_estimate = tick_measurement->tick_time;
+	}
 	// 1. register measured ticks:
 	if( tick_detected ) {
 		// we are wating to detect a tick already executed:
@@ -604,17 +962,34 @@ int tick_parser(
 		if( max_frames >= 0 && tick_count > (int )max_frames ) {
 			return -1;
 		}
+		// if both ticks around the interval just passed
+		// have been estimated, take the frame in the middle
+		// (maximal settle time):
+		if(
+				tick_measurement->valid
+				&& state->prev_tick_estimate >= 0
+				&& fabs( (state->last_tick_estimate - state->prev_tick_estimate) - clock_tick_interval )
+					< clock_tick_interval / 2
+		) {
+			const double target_time = (state->prev_tick_estimate + state->last_tick_estimate) / 2;
+			selected_frame_index = MIN(
+					select_closest_frame( target_time, frame_acc_count, frame_window ),
+					(int )frame_acc_count-2
+			);
+		}
 		if( tick_count != 0 ) {
 			ASSERT( selected_frame_index >= 0 );
 			ASSERT( selected_frame_index < (int )(frame_acc_count-1) );
 			VERBOSE_PRINT_FRAME( "\tselected frame: %4lu.%03lu\n",
-				acq_queue_read_get_index(input_queue,selected_frame_index)->time.tv_sec,
-				acq_queue_read_get_index(input_queue,selected_frame_index)->time.tv_nsec/1000/1000
+				frame_window_get_index(frame_window,selected_frame_index)->time.tv_sec,
+				frame_window_get_index(frame_window,selected_frame_index)->time.tv_nsec/1000/1000
 			);
 			{
 				select_entry_t* push_dst;
 				select_queue_push_start( output_queue, &push_dst );
-				(*push_dst) = (*acq_queue_read_get_index(input_queue,selected_frame_index));
+				(*push_dst) = (*frame_window_get_index(frame_window,selected_frame_index));
+				// keep the frame until the consumer is done:
+				frame_window_pin( frame_window, &push_dst->frame );
 				select_queue_push_end( output_queue );
 			}
 			(*last_tick_index) = frame_acc_count-2;
@@ -625,4 +1000,187 @@ int tick_parser(
 	return 0;
 }
 
+void pll_tick_parser_init(
+		const timeval_t frame_time,
+		const float acq_interval,
+		const float clock_tick_interval,
+		pll_state_t* state
+)
+{
+	// the tick happened somewhere between
+	// the previous and this frame:
+	const double tick_time = time_sec_from_timespec( &frame_time ) - acq_interval / 2;
+	state->period = clock_tick_interval;
+	state->next_tick = tick_time + state->period;
+	state->next_select = tick_time + state->period / 2;
+	state->last_select = tick_time - state->period / 2;
+	state->selected_count = 0;
+}
+
+// track tick phase and period,
+// select the frame closest to the middle
+// between two predicted ticks:
+int pll_tick_parser(
+		const timeval_t frame_time,
+		const float acq_interval,
+		const float clock_tick_interval,
+		const tick_measurement_t* tick_measurement,
+		const uint frame_acc_count,
+		const int max_frames, // -1 means no limit
+		pll_state_t* state,
+		frame_window_t* frame_window,
+		select_queue_t* output_queue
+)
+{
+	const double time = time_sec_from_timespec( &frame_time );
+	// 1. correct phase and period by measured ticks:
+	if( tick_measurement->valid ) {
+		// ticks missed since the last measurement
+		// (otherwise the prediction stays one tick behind
+		// and all following measurements are ignored):
+		while( tick_measurement->tick_time > state->next_tick + state->period / 2 ) {
+			LOG_WARNING_FRAME( "missing TICK!\n" );
+			state->next_tick += state->period;
+		}
+		// the tick happened in (frame_time - acq_interval, frame_time].
+		// A prediction inside this window is consistent with
+		// the measurement, otherwise the error is the distance
+		// to the window (quantization does not cause jumps):
+		const double window_start = tick_measurement->frame_time - acq_interval;
+		const double window_end = tick_measurement->frame_time;
+		double phase_error = 0;
+		if( state->next_tick < window_start ) {
+			phase_error = window_start - state->next_tick;
+		}
+		else if( state->next_tick > window_end ) {
+			phase_error = window_end - state->next_tick;
+		}
+		phase_error += pll_center_gain * (tick_measurement->tick_time - state->next_tick);
+		if( fabs(phase_error) < state->period / 2 ) {
+			state->next_tick += pll_alpha * phase_error;
+			state->period += pll_beta * phase_error;
+			state->period = MAX( state->period, clock_tick_interval * (1 - pll_max_period_deviation) );
+			state->period = MIN( state->period, clock_tick_interval * (1 + pll_max_period_deviation) );
+			VERBOSE_PRINT_FRAME( "~TICK phase error: %+.6fs, period: %.6fs\n",
+					phase_error,
+					state->period
+			);
+			// select in the middle of the interval
+			// starting with the corrected tick
+			// (unless this interval has been selected already):
+			const double next_select = state->next_tick + state->period / 2;
+			if( next_select > state->last_select + state->period / 2 ) {
+				state->next_select = next_select;
+			}
+			state->next_tick += state->period;
+		}
+		else {
+			LOG_WARNING_FRAME( "ignoring TICK, phase error: %+.6fs\n", phase_error );
+		}
+	}
+	// no tick measured (in time): run free
+	// (measurements arrive one frame late)
+	else if( time - 3 * acq_interval / 2 > state->next_tick + state->period / 2 ) {
+		LOG_WARNING_FRAME( "missing TICK!\n" );
+		state->next_tick += state->period;
+	}
+	// 2. select, as soon as the frame
+	// closest to 'next_select' has arrived
+	// (on a tie, the later frame wins):
+	if( time + acq_interval / 2 > state->next_select ) {
+		if( max_frames >= 0 && state->selected_count >= max_frames ) {
+			return -1;
+		}
+		const int selected_frame_index = select_closest_frame(
+				state->next_select,
+				frame_acc_count,
+				frame_window
+		);
+		VERBOSE_PRINT_FRAME( "\tselected frame: %4lu.%03lu\n",
+			frame_window_get_index(frame_window,selected_frame_index)->time.tv_sec,
+			frame_window_get_index(frame_window,selected_frame_index)->time.tv_nsec/1000/1000
+		);
+		{
+			select_entry_t* push_dst;
+			select_queue_push_start( output_queue, &push_dst );
+			(*push_dst) = (*frame_window_get_index(frame_window,selected_frame_index));
+			// keep the frame until the consumer is done:
+			frame_window_pin( frame_window, &push_dst->frame );
+			select_queue_push_end( output_queue );
+		}
+		state->selected_count++;
+		state->last_select = state->next_select;
+		state->next_select += state->period;
+	}
+	return 0;
+}
+
+tick_measurement_t estimate_tick_time(
+		const timeval_t tick_frame_time,
+		const float acq_interval,
+		diff_statistics_t* diff_statistics
+)
+{
+	const uint count = diff_buffer_get_count( &diff_statistics->diff_buffer );
+	// (right after the bootstrap burst)
+	if( count < 3 ) {
+		return (tick_measurement_t){ .valid = false };
+	}
+	// diff values before, at and after the detected tick.
+	// A diff value belongs to the time between two frames:
+	const float before = *diff_buffer_get_index( &diff_statistics->diff_buffer, count-3 );
+	const float peak = *diff_buffer_get_index( &diff_statistics->diff_buffer, count-2 );
+	const float after = *diff_buffer_get_index( &diff_statistics->diff_buffer, count-1 );
+	// vertex of the parabola through the 3 values,
+	// in frames relative to 'peak':
+	float offset = 0;
+	const float curvature = before - 2 * peak + after;
+	if( curvature < 0 ) {
+		offset = 0.5 * (before - after) / curvature;
+		offset = MAX( offset, -0.5 );
+		offset = MIN( offset, 0.5 );
+	}
+	const double frame_time = time_sec_from_timespec( &tick_frame_time );
+	return (tick_measurement_t){
+		.valid = true,
+		.frame_time = frame_time,
+		.tick_time = frame_time - acq_interval / 2 + offset * acq_interval,
+	};
+}
+
+int select_closest_frame(
+		const double target_time,
+		const uint frame_acc_count,
+		frame_window_t* frame_window
+)
+{
+	// frames are ordered by time,
+	// search backwards from the latest one
+	// (on a tie, the later frame wins):
+	int selected_frame_index = frame_acc_count-1;
+	double min_distance = fabs(
+			time_sec_from_timespec( &frame_window_get_index(frame_window,selected_frame_index)->time )
+			- target_time
+	);
+	for( int i=frame_acc_count-2; i>=0; i-- ) {
+		const double distance = fabs(
+				time_sec_from_timespec( &frame_window_get_index(frame_window,i)->time )
+				- target_time
+		);
+		if( distance >= min_distance ) {
+			break;
+		}
+		min_distance = distance;
+		selected_frame_index = i;
+	}
+	return selected_frame_index;
+}
+
+double time_sec_from_timespec(
+		const timeval_t* time
+)
+{
+	return (double )time->tv_sec + (double )time->tv_nsec / 1000 / 1000 / 1000;
+}
+
 DEF_RING_BUFFER(diff_buffer,float)
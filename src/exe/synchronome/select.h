@@ -2,19 +2,32 @@
 
 #include "queues/acq_queue.h"
 #include "queues/select_queue.h"
+#include "queues/frame_window.h"
 
 #include <semaphore.h>
 
+typedef enum {
+	// integer vote counter,
+	// corrects drift by whole frames
+	// (needs >= 3 frames per tick):
+	TICK_ESTIMATOR_VOTE,
+	// 2nd order PLL over measured tick times,
+	// tracks phase and period continuously
+	// (needs >= 2 frames per tick):
+	TICK_ESTIMATOR_PLL,
+} tick_estimator_t;
+
 ret_t select_run(
 		const USEC deadline_us,
 		const img_format_t src_format,
 		const float acq_interval,
 		const float clock_tick_interval,
 		const float tick_threshold,
+		const tick_estimator_t tick_estimator,
 		const int max_frames, // -1 means no limit
 		acq_queue_t* input_queue,
 		select_queue_t* output_queue,
-		dump_frame_func_t dump_frame
+		frame_window_t* frame_window // needs >= `select_get_frame_acc_count` entries
 );
 
 // how many frames will be accumulated
@@ -22,5 +35,10 @@ ret_t select_run(
 ret_t select_get_frame_acc_count(
 		const float acq_interval,
 		const float clock_tick_interval,
+		const tick_estimator_t tick_estimator,
 		uint* frame_acc_count
 );
+
+const char* select_tick_estimator_str(
+		const tick_estimator_t tick_estimator
+);
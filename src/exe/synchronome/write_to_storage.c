@@ -4,15 +4,24 @@
 #include "lib/image.h"
 #include "lib/output.h"
 #include "lib/global.h"
-#include "lib/semaphore.h"
 #include "lib/time.h"
-#include "lib/thread.h"
 
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
 
 
 #define SERVICE_NAME "write_to_storage"
 
+#define RING_FILE_NAME "frames.ring"
+
+// (no shard selected yet)
+#define NO_SHARD UINT64_MAX
+
 #define LOG_ERROR(fmt,...) log_error( "%-20s: " fmt, SERVICE_NAME , ## __VA_ARGS__ )
 #define LOG_VERBOSE(fmt,...) log_verbose( "%-20s: " fmt, SERVICE_NAME, ## __VA_ARGS__ )
 #define LOG_ERROR_STD_LIB(FUNC) LOG_ERROR("'" #FUNC "': %d - %s\n", errno, strerror(errno) )
@@ -26,79 +35,417 @@
 	} \
 }
 
-ret_t write_to_storage_run(
-		rgb_queue_t* rgb_queue,
-		rgb_consumers_queue_t* rgb_consumers_queue,
-		sem_t* other_services_done,
-		const frame_size_t frame_size,
-		const char* output_dir
+// build the path and header templates:
+ret_t write_to_storage_init_templates(
+		write_to_storage_t* storage
+);
+
+ret_t write_to_storage_save_file(
+		write_to_storage_t* storage,
+		const rgb_entry_t* entry
+);
+
+// open the output directory (and check O_TMPFILE):
+ret_t write_to_storage_open_dir(
+		write_to_storage_t* storage
+);
+
+void write_to_storage_close_dirs(
+		write_to_storage_t* storage
+);
+
+// switch dir_fd to the shard of the current frame,
+// creating it if necessary:
+ret_t write_to_storage_select_shard(
+		write_to_storage_t* storage
+);
+
+// write the buffers into a new file
+// in dir_fd (without stdio):
+ret_t write_to_storage_write_file(
+		write_to_storage_t* storage,
+		const char* name,
+		const struct iovec* iov,
+		const uint iov_count
+);
+
+// link an O_TMPFILE file as 'name',
+// replacing an existing file:
+ret_t write_to_storage_link_file(
+		write_to_storage_t* storage,
+		const int fd,
+		const char* name
+);
+
+const char* write_to_storage_file_ext(
+		const output_format_t format
+);
+
+ret_t write_to_storage_init(
+		write_to_storage_t* storage,
+		const write_to_storage_args_t args
 )
 {
-	thread_info( SERVICE_NAME );
-	char output_path[STR_BUFFER_SIZE];
-	char timestamp_str[STR_BUFFER_SIZE];
-	int counter = 0;
-	timeval_t current_time;
-	while( true ) {
-		rgb_queue_read_start( rgb_queue );
-		if(
-				rgb_queue_get_should_stop( rgb_queue )
-				&& rgb_queue_get_count( rgb_queue ) == 0
-		) {
-			LOG_VERBOSE( "stopping\n" );
-			break;
-		}
-		current_time = time_measure_current_time();
-		timeval_t start_time = current_time;
-		LOG_TIME( "START\n" );
-		snprintf(output_path, STR_BUFFER_SIZE, "%s/image%04u.ppm",
-				output_dir,
-				counter
+	storage->args = args;
+	storage->counter = 0;
+	if( args.mode == STORAGE_RING_FILE ) {
+		char path[STR_BUFFER_SIZE];
+		snprintf( path, STR_BUFFER_SIZE, "%s/%s",
+				args.output_dir,
+				RING_FILE_NAME
 		);
-		{
-			rgb_entry_t* entry = rgb_queue_read_get(rgb_queue);
-			if( other_services_done != NULL ) {
-				rgb_entry_t** consumer_entry = NULL;
-				rgb_consumers_queue_push_start( rgb_consumers_queue, &consumer_entry );
-				(*consumer_entry) = entry;
-				rgb_consumers_queue_push_end( rgb_consumers_queue );
-			}
-			snprintf(timestamp_str, STR_BUFFER_SIZE, "%lu.%lu",
-					entry->time.tv_sec,
-					entry->time.tv_nsec / 1000 / 1000
-			);
-			log_info( "[Frame Count: %4u] [Image Capture Start Time: %4lu.%03lu second]\n",
-					counter,
-					entry->time.tv_sec,
-					entry->time.tv_nsec / 1000 / 1000
-			);
-			// TODO: fix error handling:
-			API_RUN( image_save_ppm(
-				output_path,
-				timestamp_str,
-				entry->frame.data,
-				entry->frame.size,
-				frame_size.width,
-				frame_size.height
-			) );
-		}
-		if( other_services_done != NULL ) {
-			API_RUN( sem_wait_nointr( other_services_done ) );
+		API_RUN( ring_file_init(
+				&storage->ring_file,
+				path,
+				args.format,
+				args.frame_size.width,
+				args.frame_size.height,
+				args.ring_file_slots
+		) );
+	}
+	else if( args.mode == STORAGE_CONTAINER ) {
+		API_RUN( container_init(
+				&storage->container,
+				args.output_dir,
+				args.format,
+				args.frame_size.width,
+				args.frame_size.height,
+				args.container_max_size,
+				args.container_max_frames
+		) );
+	}
+	else {
+		if( args.shard_frames > 0 && args.shard_hourly ) {
+			LOG_ERROR( "shard by frames or by hour, not both\n" );
+			return RET_FAILURE;
 		}
-		rgb_queue_read_stop_dump(rgb_queue);
-		counter++;
-		// log timing info:
-		current_time = time_measure_current_time();
-		timeval_t end_time = current_time;
-		LOG_TIME( "END\n" );
+		API_RUN( write_to_storage_init_templates( storage ) );
+		API_RUN( write_to_storage_open_dir( storage ) );
+	}
+	return RET_SUCCESS;
+}
+
+ret_t write_to_storage_exit(
+		write_to_storage_t* storage
+)
+{
+	if( storage->args.mode == STORAGE_RING_FILE ) {
+		API_RUN( ring_file_exit( &storage->ring_file ) );
+	}
+	else if( storage->args.mode == STORAGE_CONTAINER ) {
+		API_RUN( container_exit( &storage->container ) );
+	}
+	else {
+		write_to_storage_close_dirs( storage );
+	}
+	return RET_SUCCESS;
+}
+
+ret_t write_to_storage_frame(
+		write_to_storage_t* storage,
+		const rgb_entry_t* entry
+)
+{
+	timeval_t current_time = time_measure_current_time();
+	timeval_t start_time = current_time;
+	LOG_TIME( "START\n" );
+	LOG_VERBOSE( "[Frame Count: %4lu] [Image Capture Start Time: %4lu.%03lu second]\n",
+			storage->counter,
+			entry->time.tv_sec,
+			entry->time.tv_nsec / 1000 / 1000
+	);
+	if( storage->args.mode == STORAGE_RING_FILE ) {
+		API_RUN( ring_file_write_frame(
+				&storage->ring_file,
+				storage->counter,
+				&entry->time,
+				entry->frame.data,
+				entry->frame.size
+		) );
+	}
+	else if( storage->args.mode == STORAGE_CONTAINER ) {
+		API_RUN( container_write_frame(
+				&storage->container,
+				storage->counter,
+				&entry->time,
+				entry->frame.data,
+				entry->frame.size
+		) );
+	}
+	else {
+		API_RUN( write_to_storage_save_file(
+				storage,
+				entry
+		) );
+	}
+	storage->counter++;
+	// log timing info:
+	current_time = time_measure_current_time();
+	timeval_t end_time = current_time;
+	LOG_TIME( "END\n" );
+	{
+		timeval_t runtime;
+		time_delta( &end_time, &start_time, &runtime );
+		LOG_TIME( "RUNTIME: %04lu.%06lu\n",
+				runtime.tv_sec,
+				runtime.tv_nsec / 1000
+		);
+	}
+	return RET_SUCCESS;
+}
+
+ret_t write_to_storage_init_templates(
+		write_to_storage_t* storage
+)
+{
+	const write_to_storage_args_t* args = &storage->args;
+	// (relative to dir_fd)
+	name_template_init( &storage->path );
+	name_template_append( &storage->path, "image" );
+	storage->path_counter = name_template_append_field( &storage->path, 8 );
+	name_template_append( &storage->path, "." );
+	name_template_append( &storage->path, write_to_storage_file_ext( args->format ) );
+	name_template_init( &storage->shard_name );
+	name_template_append_field( &storage->shard_name, 6 );
+	name_template_init( &storage->fd_path );
+	name_template_append( &storage->fd_path, "/proc/self/fd/" );
+	name_template_append_field( &storage->fd_path, 1 );
+	name_template_init( &storage->header );
+	storage->frame_size = 0;
+	if( args->format == OUTPUT_FORMAT_JPEG ) {
+		storage->header_time = name_template_append_time( &storage->header );
+	}
+	else {
+		char prefix[STR_BUFFER_SIZE];
+		char suffix[STR_BUFFER_SIZE];
+		API_RUN( image_file_header(
+				args->format,
+				args->frame_size.width,
+				args->frame_size.height,
+				prefix, sizeof(prefix),
+				suffix, sizeof(suffix)
+		) );
+		name_template_append( &storage->header, prefix );
+		storage->header_time = name_template_append_time( &storage->header );
+		name_template_append( &storage->header, suffix );
+		storage->frame_size = image_output_size(
+				args->format,
+				args->frame_size.width,
+				args->frame_size.height
+		);
+	}
+	if(
+			!name_template_is_valid( &storage->path )
+			|| !name_template_is_valid( &storage->header )
+	) {
+		LOG_ERROR( "output path too long\n" );
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
+ret_t write_to_storage_save_file(
+		write_to_storage_t* storage,
+		const rgb_entry_t* entry
+)
+{
+	if( RET_SUCCESS != write_to_storage_select_shard( storage ) ) {
+		return RET_FAILURE;
+	}
+	name_template_set( &storage->path, storage->path_counter, storage->counter );
+	name_template_set_time( &storage->header, storage->header_time, &entry->time );
+	if( storage->args.format == OUTPUT_FORMAT_JPEG ) {
+		byte_t header[IMAGE_JPEG_HEADER_MAX_SIZE];
+		size_t header_size = 0;
+		API_RUN( image_jpeg_header(
+				entry->frame.data, entry->frame.size,
+				name_template_str( &storage->header ),
+				header, sizeof(header),
+				&header_size
+		) );
+		// (the header replaces the SOI marker)
+		const struct iovec iov[] = {
+			{ .iov_base = header, .iov_len = header_size },
+			{ .iov_base = (byte_t* )entry->frame.data + 2, .iov_len = entry->frame.size - 2 },
+		};
+		return write_to_storage_write_file( storage, name_template_str( &storage->path ), iov, 2 );
+	}
+	if( entry->frame.size < storage->frame_size ) {
+		LOG_ERROR( "buffer size too small!\n" );
+		return RET_FAILURE;
+	}
+	const struct iovec iov[] = {
 		{
-			timeval_t runtime;
-			time_delta( &end_time, &start_time, &runtime );
-			LOG_TIME( "RUNTIME: %04lu.%06lu\n",
-					runtime.tv_sec,
-					runtime.tv_nsec / 1000
-			);
+			.iov_base = (char* )name_template_str( &storage->header ),
+			.iov_len = name_template_length( &storage->header )
+		},
+		{ .iov_base = entry->frame.data, .iov_len = storage->frame_size },
+	};
+	return write_to_storage_write_file( storage, name_template_str( &storage->path ), iov, 2 );
+}
+
+ret_t write_to_storage_open_dir(
+		write_to_storage_t* storage
+)
+{
+	const write_to_storage_args_t* args = &storage->args;
+	storage->shard = NO_SHARD;
+	storage->dir_fd = -1;
+	storage->output_dir_fd = open( args->output_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+	if( storage->output_dir_fd == -1 ) {
+		LOG_ERROR( "'%s': %s\n", args->output_dir, strerror(errno) );
+		return RET_FAILURE;
+	}
+	if( args->atomic_files ) {
+		const int fd = openat( storage->output_dir_fd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, 0644 );
+		if( fd == -1 ) {
+			LOG_ERROR( "'%s': O_TMPFILE not supported: %s\n", args->output_dir, strerror(errno) );
+			write_to_storage_close_dirs( storage );
+			return RET_FAILURE;
 		}
+		close( fd );
 	}
 	return RET_SUCCESS;
 }
+
+void write_to_storage_close_dirs(
+		write_to_storage_t* storage
+)
+{
+	if( storage->dir_fd != -1 && storage->dir_fd != storage->output_dir_fd ) {
+		close( storage->dir_fd );
+	}
+	storage->dir_fd = -1;
+	if( storage->output_dir_fd != -1 ) {
+		close( storage->output_dir_fd );
+		storage->output_dir_fd = -1;
+	}
+}
+
+ret_t write_to_storage_select_shard(
+		write_to_storage_t* storage
+)
+{
+	const write_to_storage_args_t* args = &storage->args;
+	if( args->shard_frames == 0 && !args->shard_hourly ) {
+		storage->dir_fd = storage->output_dir_fd;
+		return RET_SUCCESS;
+	}
+	// hourly: by wall clock, frame times are monotonic:
+	struct timespec now = { 0 };
+	if( args->shard_hourly ) {
+		clock_gettime( CLOCK_REALTIME, &now );
+	}
+	const uint64_t shard = args->shard_hourly
+		? (uint64_t )now.tv_sec / 3600
+		: storage->counter / args->shard_frames;
+	if( shard == storage->shard ) {
+		return RET_SUCCESS;
+	}
+	// (once per shard)
+	char hour_name[32];
+	const char* name = hour_name;
+	if( args->shard_hourly ) {
+		struct tm tm;
+		gmtime_r( &now.tv_sec, &tm );
+		strftime( hour_name, sizeof(hour_name), "%Y%m%d_%H", &tm );
+	}
+	else {
+		name_template_set( &storage->shard_name, 0, shard );
+		name = name_template_str( &storage->shard_name );
+	}
+	if( mkdirat( storage->output_dir_fd, name, 0755 ) == -1 && errno != EEXIST ) {
+		LOG_ERROR( "'%s/%s': %s\n", args->output_dir, name, strerror(errno) );
+		return RET_FAILURE;
+	}
+	const int dir_fd = openat( storage->output_dir_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+	if( dir_fd == -1 ) {
+		LOG_ERROR( "'%s/%s': %s\n", args->output_dir, name, strerror(errno) );
+		return RET_FAILURE;
+	}
+	if( storage->dir_fd != -1 && storage->dir_fd != storage->output_dir_fd ) {
+		close( storage->dir_fd );
+	}
+	storage->dir_fd = dir_fd;
+	storage->shard = shard;
+	LOG_VERBOSE( "new directory: %s/%s\n", args->output_dir, name );
+	return RET_SUCCESS;
+}
+
+ret_t write_to_storage_write_file(
+		write_to_storage_t* storage,
+		const char* name,
+		const struct iovec* iov,
+		const uint iov_count
+)
+{
+	const bool atomic = storage->args.atomic_files;
+	const int fd = atomic
+		? openat( storage->dir_fd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, 0644 )
+		: openat( storage->dir_fd, name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+	if( fd == -1 ) {
+		LOG_ERROR( "'%s': %s\n", name, strerror(errno) );
+		return RET_FAILURE;
+	}
+	size_t size = 0;
+	for( uint i=0; i<iov_count; i++ ) {
+		size += iov[i].iov_len;
+	}
+	// (regular files: short writes only if the disk is full)
+	const ssize_t ret = writev( fd, iov, iov_count );
+	if( ret == -1 || (size_t )ret != size ) {
+		LOG_ERROR( "'%s': %s\n", name, (ret == -1) ? strerror(errno) : "short write" );
+		close( fd );
+		return RET_FAILURE;
+	}
+	if( atomic && RET_SUCCESS != write_to_storage_link_file( storage, fd, name ) ) {
+		close( fd );
+		return RET_FAILURE;
+	}
+	if( close( fd ) == -1 ) {
+		LOG_ERROR( "'%s': %s\n", name, strerror(errno) );
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
+ret_t write_to_storage_link_file(
+		write_to_storage_t* storage,
+		const int fd,
+		const char* name
+)
+{
+	// (linkat with AT_EMPTY_PATH needs CAP_DAC_READ_SEARCH)
+	name_template_set( &storage->fd_path, 0, fd );
+	const char* fd_path = name_template_str( &storage->fd_path );
+	if( 0 == linkat( AT_FDCWD, fd_path, storage->dir_fd, name, AT_SYMLINK_FOLLOW ) ) {
+		return RET_SUCCESS;
+	}
+	// e.g. from a previous run:
+	if(
+			errno == EEXIST
+			&& 0 == unlinkat( storage->dir_fd, name, 0 )
+			&& 0 == linkat( AT_FDCWD, fd_path, storage->dir_fd, name, AT_SYMLINK_FOLLOW )
+	) {
+		return RET_SUCCESS;
+	}
+	LOG_ERROR( "'%s': 'linkat': %s\n", name, strerror(errno) );
+	return RET_FAILURE;
+}
+
+const char* write_to_storage_file_ext(
+		const output_format_t format
+)
+{
+	switch( format ) {
+		case OUTPUT_FORMAT_YUV420:
+			return "y4m";
+		case OUTPUT_FORMAT_JPEG:
+			return "jpg";
+		case OUTPUT_FORMAT_GRAY:
+			return "pgm";
+		case OUTPUT_FORMAT_RGB:
+			return "ppm";
+	}
+	return "raw";
+}
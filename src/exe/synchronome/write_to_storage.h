@@ -1,13 +1,81 @@
 #pragma once
 
 #include "queues/rgb_queue.h"
+#include "lib/image.h"
+#include "lib/container.h"
+#include "lib/ring_file.h"
+#include "lib/name_template.h"
 
-#include <semaphore.h>
+typedef enum {
+	// one image file per frame:
+	STORAGE_FILE_PER_FRAME,
+	// append frames to container files
+	// (see "lib/container.h"):
+	STORAGE_CONTAINER,
+	// circular log in a memory mapped file
+	// (see "lib/ring_file.h"):
+	STORAGE_RING_FILE,
+} storage_mode_t;
 
-ret_t write_to_storage_run(
-		rgb_queue_t* rgb_queue,
-		rgb_consumers_queue_t* rgb_consumers_queue,
-		sem_t* other_services_done,
-		const frame_size_t frame_size,
-		const char* output_dir
+typedef struct {
+	storage_mode_t mode;
+	frame_size_t frame_size;
+	output_format_t format;
+	const char* output_dir;
+	// STORAGE_CONTAINER only:
+	size_t container_max_size; // 0 means no limit
+	uint container_max_frames; // 0 means no limit
+	// STORAGE_RING_FILE only:
+	uint ring_file_slots;
+	// STORAGE_FILE_PER_FRAME only.
+	// start a new subdirectory every shard_frames frames
+	// ("OUTPUT_DIR/NNNNNN", 0: no sharding):
+	uint shard_frames;
+	// start a new subdirectory every hour
+	// ("OUTPUT_DIR/YYYYMMDD_HH", UTC):
+	bool shard_hourly;
+	// write into an unnamed file (O_TMPFILE),
+	// which is linked into the directory when complete:
+	bool atomic_files;
+} write_to_storage_args_t;
+
+typedef struct {
+	write_to_storage_args_t args;
+	uint64_t counter;
+	container_t container;
+	ring_file_t ring_file;
+	// STORAGE_FILE_PER_FRAME only,
+	// prepared once (see "lib/name_template.h"):
+	name_template_t path;
+	uint path_counter; // field index
+	// file header (JPEG: the comment):
+	name_template_t header;
+	uint header_time; // field index
+	size_t frame_size; // 0: variable (JPEG)
+	// files are created relative to dir_fd,
+	// the current shard (or output_dir_fd):
+	int output_dir_fd;
+	int dir_fd;
+	uint64_t shard;
+	name_template_t shard_name;
+	// to link O_TMPFILE files:
+	name_template_t fd_path;
+} write_to_storage_t;
+
+// open the container / ring file:
+ret_t write_to_storage_init(
+		write_to_storage_t* storage,
+		const write_to_storage_args_t args
+);
+
+ret_t write_to_storage_exit(
+		write_to_storage_t* storage
+);
+
+// store one frame.
+// not thread safe, frames are
+// stored in the order of the calls
+ret_t write_to_storage_frame(
+		write_to_storage_t* storage,
+		const rgb_entry_t* entry
 );
@@ -13,6 +13,7 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <assert.h>
 
 
@@ -29,7 +30,8 @@
 	} \
 }
 
-static char error_str[STR_BUFFER_SIZE] = "";
+// per thread, cameras may be used from different threads:
+static _Thread_local char error_str[STR_BUFFER_SIZE] = "";
 
 int ioctl_helper(int fh, unsigned int request, void *arg);
 
@@ -40,6 +42,72 @@ ret_t negotiate_caps(
 		camera_t* camera
 );
 
+// single- and multi-planar API:
+
+bool is_mplane(
+		const camera_t* camera
+);
+
+// 'plane' is used by the multi-planar API:
+void buffer_descr_init(
+		const camera_t* camera,
+		struct v4l2_buffer* descr,
+		struct v4l2_plane* plane
+);
+
+void format_get(
+		const struct v4l2_format* format,
+		img_format_t* pix,
+		uint* plane_count
+);
+
+void format_set(
+		struct v4l2_format* format,
+		const img_format_t* pix
+);
+
+// mode cache file:
+
+#define MODE_CACHE_MAGIC "CAMMODE1"
+
+typedef struct {
+	char magic[8];
+	// the layout of the entries:
+	__u32 descr_size;
+	// the device:
+	char driver[16];
+	char card[32];
+	char bus_info[32];
+	__u32 driver_version;
+	__u32 count;
+} mode_cache_header_t;
+
+// RET_FAILURE if the device can't be identified:
+ret_t mode_cache_filename(
+		const camera_t* camera,
+		const char* cache_dir,
+		char* filename
+);
+
+void mode_cache_header_init(
+		const camera_t* camera,
+		mode_cache_header_t* header,
+		const uint count
+);
+
+// RET_FAILURE if missing or outdated:
+ret_t mode_cache_read(
+		const camera_t* camera,
+		const char* filename,
+		camera_mode_descrs_t* modes
+);
+
+ret_t mode_cache_write(
+		const camera_t* camera,
+		const char* filename,
+		const camera_mode_descrs_t* modes
+);
+
 ret_t reset_cropping(
 		camera_t* camera
 );
@@ -67,10 +135,16 @@ void camera_zero( camera_t* camera )
 			.buffers = NULL,
 			.count = 0
 		},
+		.driver = "",
+		.card = "",
+		.bus_info = "",
+		.driver_version = 0,
+		.buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
 		.format = {
 			.width = 0,
 			.height = 0,
 		},
+		.plane_count = 1,
 		.currently_owned_frames = 0,
 	};
 }
@@ -184,7 +258,7 @@ ret_t camera_list_formats(
 	for( ; i<BUFFER_SIZE; i++ ) {
 		struct v4l2_fmtdesc format_descr;
 		memset( &format_descr, 0, sizeof(format_descr) );
-		format_descr.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		format_descr.type = camera->buf_type;
 		format_descr.index = i;
 		if (-1 == ioctl_helper(camera->dev_file, VIDIOC_ENUM_FMT, &format_descr)) {
 			if( errno == EINVAL ) {
@@ -347,6 +421,40 @@ ret_t camera_list_modes(
 	return RET_SUCCESS;
 }
 
+ret_t camera_list_modes_cached(
+		camera_t* camera,
+		const char* cache_dir,
+		camera_mode_descrs_t* modes,
+		bool* from_cache
+)
+{
+	assert( camera != NULL );
+	if( camera->dev_file == -1 ) {
+		DEV_ERROR(
+			"'camera_list_modes_cached': camera is uninitialized\n"
+		);
+		return RET_FAILURE;
+	}
+	if( from_cache != NULL ) {
+		(*from_cache) = false;
+	}
+	char filename[STR_BUFFER_SIZE];
+	const bool cachable = (RET_SUCCESS == mode_cache_filename( camera, cache_dir, filename ));
+	if( cachable && RET_SUCCESS == mode_cache_read( camera, filename, modes ) ) {
+		if( from_cache != NULL ) {
+			(*from_cache) = true;
+		}
+		return RET_SUCCESS;
+	}
+	if( RET_SUCCESS != camera_list_modes( camera, modes ) ) {
+		return RET_FAILURE;
+	}
+	if( cachable && RET_SUCCESS != mode_cache_write( camera, filename, modes ) ) {
+		log_warning( "'%s': failed writing mode cache: %s\n", filename, strerror(errno) );
+	}
+	return RET_SUCCESS;
+}
+
 ret_t camera_set_mode(
 		camera_t* camera,
 		const pixel_format_t requested_format,
@@ -413,9 +521,15 @@ ret_t camera_init_buffer(
 		return RET_FAILURE;
 	}
 	// request buffers:
+	if( camera->plane_count != 1 ) {
+		DEV_ERROR( "buffer layouts with %u planes are not supported\n",
+				camera->plane_count
+		);
+		return RET_FAILURE;
+	}
 	struct v4l2_requestbuffers reqbuf;
 	memset(&reqbuf, 0, sizeof(reqbuf));
-	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	reqbuf.type = camera->buf_type;
 	reqbuf.memory = V4L2_MEMORY_MMAP;
 	reqbuf.count = buffer_count;
 
@@ -451,9 +565,8 @@ ret_t camera_init_buffer(
 	// acquire buffers:
 	for(unsigned int i = 0; i < reqbuf.count; i++ ) {
 		struct v4l2_buffer buffer;
-		memset(&buffer, 0, sizeof(buffer));
-		buffer.type = reqbuf.type;
-		buffer.memory = V4L2_MEMORY_MMAP;
+		struct v4l2_plane plane;
+		buffer_descr_init( camera, &buffer, &plane );
 		buffer.index = i;
 
 		if (-1 == ioctl_helper(camera->dev_file, VIDIOC_QUERYBUF, &buffer)) {
@@ -463,14 +576,15 @@ ret_t camera_init_buffer(
 			);
 			return RET_FAILURE;
 		}
-		camera->buffer_container.buffers[i].size = buffer.length;
+		const size_t length = is_mplane( camera ) ? plane.length : buffer.length;
+		camera->buffer_container.buffers[i].size = length;
 		camera->buffer_container.buffers[i].data = mmap(
 				NULL,
-				buffer.length,
+				length,
 				PROT_READ | PROT_WRITE, /* recommended */
 				MAP_SHARED,             /* recommended */
 				camera->dev_file,
-				buffer.m.offset
+				is_mplane( camera ) ? plane.m.mem_offset : buffer.m.offset
 		);
 
 		if (MAP_FAILED == camera->buffer_container.buffers[i].data) {
@@ -509,10 +623,8 @@ ret_t camera_stream_start(
 	for (unsigned int i = 0; i < camera->buffer_container.count; ++i)
 	{
 		struct v4l2_buffer buffer;
-
-		memset(&buffer, 0, sizeof( buffer ));
-		buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		buffer.memory = V4L2_MEMORY_MMAP;
+		struct v4l2_plane plane;
+		buffer_descr_init( camera, &buffer, &plane );
 		buffer.index = i;
 
 		if (-1 == ioctl_helper(camera->dev_file, VIDIOC_QBUF, &buffer)) {
@@ -526,7 +638,7 @@ ret_t camera_stream_start(
 	}
 	// start streaming:
 	enum v4l2_buf_type type;
-	type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	type = camera->buf_type;
 	if (-1 == ioctl_helper(camera->dev_file, VIDIOC_STREAMON, &type)) {
 		DEV_ERROR(
 				"VIDIOC_STREAMON error: %d, %s\n",
@@ -556,7 +668,7 @@ ret_t camera_stream_stop(
 		return RET_FAILURE;
 	}
 	enum v4l2_buf_type type;
-	type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	type = camera->buf_type;
 	if (-1 == ioctl_helper(camera->dev_file, VIDIOC_STREAMOFF, &type)) {
 		DEV_ERROR(
 				"VIDIOC_STREAMOFF error: %d, %s\n",
@@ -568,6 +680,51 @@ ret_t camera_stream_stop(
 	return RET_SUCCESS;
 }
 
+ret_t camera_wait_frame(
+		camera_t* camera,
+		const int timeout_ms
+)
+{
+	assert( camera != NULL );
+	if( camera->dev_file == -1 ) {
+		DEV_ERROR(
+			"'camera_wait_frame': camera is uninitialized\n"
+		);
+		return RET_FAILURE;
+	}
+	if( camera->buffer_container.buffers == NULL ) {
+		DEV_ERROR(
+			"'camera_wait_frame': camera is not ready\n"
+		);
+		return RET_FAILURE;
+	}
+	struct pollfd fd = {
+		.fd = camera->dev_file,
+		.events = POLLIN,
+	};
+	int ret;
+	do {
+		ret = poll( &fd, 1, timeout_ms );
+	} while( ret == -1 && errno == EINTR );
+	if( ret == -1 ) {
+		DEV_ERROR(
+				"poll error: %d, %s\n",
+				errno,
+				strerror(errno)
+		);
+		return RET_FAILURE;
+	}
+	if( ret == 0 ) {
+		DEV_ERROR(
+				"'%s': no frame within %dms\n",
+				camera->dev_name,
+				timeout_ms
+		);
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
 ret_t camera_get_frame(
 		camera_t* camera,
 		frame_buffer_t* buffer
@@ -604,9 +761,8 @@ ret_t camera_get_frame(
 	}
 	// request 1 frame:
 	struct v4l2_buffer buffer_descr;
-	memset(&buffer_descr, 0, sizeof(buffer_descr) );
-	buffer_descr.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	buffer_descr.memory = V4L2_MEMORY_MMAP;
+	struct v4l2_plane plane;
+	buffer_descr_init( camera, &buffer_descr, &plane );
 	if (-1 == ioctl_helper(camera->dev_file, VIDIOC_DQBUF, &buffer_descr)) {
 		DEV_ERROR(
 				"VIDIOC_DQBUF error: %d, %s\n",
@@ -617,7 +773,7 @@ ret_t camera_get_frame(
 	}
 	assert(buffer_descr.index < camera->buffer_container.count);
 	buffer->data = camera->buffer_container.buffers[buffer_descr.index].data;
-	buffer->size = buffer_descr.bytesused;
+	buffer->size = is_mplane( camera ) ? plane.bytesused : buffer_descr.bytesused;
 	buffer->index = buffer_descr.index;
 	camera->currently_owned_frames--;
 	// log_info( "camera_get_frame: %u\n", camera->currently_owned_frames );
@@ -630,9 +786,8 @@ ret_t camera_return_frame(
 )
 {
 	struct v4l2_buffer buffer_descr;
-	memset(&buffer_descr, 0, sizeof(buffer_descr) );
-	buffer_descr.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	buffer_descr.memory = V4L2_MEMORY_MMAP;
+	struct v4l2_plane plane;
+	buffer_descr_init( camera, &buffer_descr, &plane );
 	buffer_descr.index = buffer->index;
 	if (-1 == ioctl_helper(camera->dev_file, VIDIOC_QBUF, &buffer_descr)) {
 		DEV_ERROR(
@@ -744,7 +899,14 @@ ret_t negotiate_caps(
 			return RET_FAILURE;
 		}
 	}
-	if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
+	if( cap.capabilities & V4L2_CAP_VIDEO_CAPTURE ) {
+		camera->buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	}
+	// (e.g. ISPs on SoCs):
+	else if( cap.capabilities & V4L2_CAP_VIDEO_CAPTURE_MPLANE ) {
+		camera->buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	}
+	else {
 		DEV_ERROR( "%s: is no video capture device\n",
 				camera->dev_name
 		);
@@ -756,16 +918,128 @@ ret_t negotiate_caps(
 		);
 		return RET_FAILURE;
 	}
+	snprintf( camera->driver, sizeof(camera->driver), "%s", (const char* )cap.driver );
+	snprintf( camera->card, sizeof(camera->card), "%s", (const char* )cap.card );
+	snprintf( camera->bus_info, sizeof(camera->bus_info), "%s", (const char* )cap.bus_info );
+	camera->driver_version = cap.version;
+	return RET_SUCCESS;
+}
+
+ret_t mode_cache_filename(
+		const camera_t* camera,
+		const char* cache_dir,
+		char* filename
+)
+{
+	if( camera->bus_info[0] == '\0' ) {
+		return RET_FAILURE;
+	}
+	char name[sizeof(camera->bus_info)];
+	for( uint i=0; i<sizeof(name); i++ ) {
+		const char c = camera->bus_info[i];
+		name[i] = (c == '/' || c == ' ') ? '_' : c;
+	}
+	const int ret = snprintf( filename, STR_BUFFER_SIZE, "%s/%s.modes",
+			cache_dir,
+			name
+	);
+	if( ret >= STR_BUFFER_SIZE ) {
+		return RET_FAILURE;
+	}
 	return RET_SUCCESS;
 }
 
+void mode_cache_header_init(
+		const camera_t* camera,
+		mode_cache_header_t* header,
+		const uint count
+)
+{
+	memset( header, 0, sizeof(*header) );
+	memcpy( header->magic, MODE_CACHE_MAGIC, sizeof(header->magic) );
+	header->descr_size = sizeof(camera_mode_descr_t);
+	memcpy( header->driver, camera->driver, sizeof(header->driver) );
+	memcpy( header->card, camera->card, sizeof(header->card) );
+	memcpy( header->bus_info, camera->bus_info, sizeof(header->bus_info) );
+	header->driver_version = camera->driver_version;
+	header->count = count;
+}
+
+ret_t mode_cache_read(
+		const camera_t* camera,
+		const char* filename,
+		camera_mode_descrs_t* modes
+)
+{
+	FILE* file = fopen( filename, "rb" );
+	if( file == NULL ) {
+		return RET_FAILURE;
+	}
+	mode_cache_header_t expected;
+	mode_cache_header_init( camera, &expected, 0 );
+	mode_cache_header_t header;
+	ret_t ret = RET_FAILURE;
+	if(
+			1 == fread( &header, sizeof(header), 1, file )
+			&& header.count <= BUFFER_SIZE
+	) {
+		expected.count = header.count;
+		if(
+				!memcmp( &header, &expected, sizeof(header) )
+				&& header.count == fread( modes->mode_descrs, sizeof(camera_mode_descr_t), header.count, file )
+		) {
+			modes->count = header.count;
+			ret = RET_SUCCESS;
+		}
+	}
+	fclose( file );
+	return ret;
+}
+
+ret_t mode_cache_write(
+		const camera_t* camera,
+		const char* filename,
+		const camera_mode_descrs_t* modes
+)
+{
+	// write a temporary file and rename it,
+	// so readers never see a partial file:
+	char tmp_filename[STR_BUFFER_SIZE+4];
+	snprintf( tmp_filename, sizeof(tmp_filename), "%s.tmp", filename );
+	FILE* file = fopen( tmp_filename, "wb" );
+	if( file == NULL ) {
+		return RET_FAILURE;
+	}
+	mode_cache_header_t header;
+	mode_cache_header_init( camera, &header, modes->count );
+	ret_t ret = RET_SUCCESS;
+	if(
+			1 != fwrite( &header, sizeof(header), 1, file )
+			|| modes->count != fwrite( modes->mode_descrs, sizeof(camera_mode_descr_t), modes->count, file )
+	) {
+		ret = RET_FAILURE;
+	}
+	if( 0 != fclose( file ) ) {
+		ret = RET_FAILURE;
+	}
+	if( ret == RET_SUCCESS && -1 == rename( tmp_filename, filename ) ) {
+		ret = RET_FAILURE;
+	}
+	if( ret != RET_SUCCESS ) {
+		const int err = errno;
+		unlink( tmp_filename );
+		errno = err;
+	}
+	return ret;
+}
+
 ret_t reset_cropping(
 		camera_t* camera
 )
 {
 	struct v4l2_cropcap cropcap;
 	memset( &cropcap, 0, sizeof(cropcap) );
-	cropcap.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	cropcap.type = camera->buf_type;
 	{
 		int ret = ioctl_helper( camera->dev_file, VIDIOC_CROPCAP, &cropcap );
 		// cropping is not supported:
@@ -782,7 +1056,7 @@ ret_t reset_cropping(
 	}
 	struct v4l2_crop crop;
 	memset( &crop, 0, sizeof(crop) );
-	crop.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	crop.type = camera->buf_type;
 	crop.c = cropcap.defrect;
 
 	// try to reset cropping to default:
@@ -804,7 +1078,7 @@ ret_t negotiate_format(
 {
 	struct v4l2_format format;
 	memset(&format, 0, sizeof(format));
-	format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	format.type = camera->buf_type;
 	// Query current format:
 	{
 		if( -1 == ioctl_helper( camera->dev_file, VIDIOC_G_FMT, &format ) ) {
@@ -815,10 +1089,13 @@ ret_t negotiate_format(
 			return RET_FAILURE;
 		}
 	}
+	img_format_t pix;
+	uint plane_count;
+	format_get( &format, &pix, &plane_count );
 	// Query frame_interval:
 	struct v4l2_streamparm streamparm;
 	memset(&streamparm, 0, sizeof(streamparm));
-	streamparm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	streamparm.type = camera->buf_type;
 	{
 		if( -1 == ioctl_helper(camera->dev_file, VIDIOC_G_PARM, &streamparm) )
 		{
@@ -831,9 +1108,9 @@ ret_t negotiate_format(
 	}
 	// Check format
 	if(
-			(format_constraint == FORMAT_ANY || format.fmt.pix.pixelformat == requested_format)
+			(format_constraint == FORMAT_ANY || pix.pixelformat == requested_format)
 			&& (frame_size_constraint == FRAME_SIZE_ANY
-				|| (format.fmt.pix.width == frame_size.width && format.fmt.pix.height == frame_size.height)
+				|| (pix.width == frame_size.width && pix.height == frame_size.height)
 			)
 			&& (
 				frame_interval_constraint == FRAME_INTERVAL_ANY
@@ -844,7 +1121,8 @@ ret_t negotiate_format(
 			)
 	) {
 		// format fulfills requirements:
-		camera->format = format.fmt.pix;
+		camera->format = pix;
+		camera->plane_count = plane_count;
 		camera->frame_interval = streamparm.parm.capture.timeperframe;
 		return RET_SUCCESS;
 	}
@@ -853,12 +1131,13 @@ ret_t negotiate_format(
 		if(
 				format_constraint != FORMAT_ANY
 		) {
-			format.fmt.pix.pixelformat = requested_format;
+			pix.pixelformat = requested_format;
 		}
 		if( frame_size_constraint != FRAME_SIZE_ANY ) {
-			format.fmt.pix.width = frame_size.width;
-			format.fmt.pix.height = frame_size.height;
+			pix.width = frame_size.width;
+			pix.height = frame_size.height;
 		}
+		format_set( &format, &pix );
 		if( -1 == ioctl_helper( camera->dev_file, VIDIOC_S_FMT, &format ) ) {
 			DEV_ERROR( "'VIDIOC_S_FMT' error %d, %s\n",
 					errno,
@@ -866,6 +1145,7 @@ ret_t negotiate_format(
 			)
 			return RET_FAILURE;
 		}
+		format_get( &format, &pix, &plane_count );
 		// set framerate:
 		if(
 				frame_interval_constraint != FRAME_INTERVAL_ANY
@@ -882,17 +1162,18 @@ ret_t negotiate_format(
 			}
 		}
 	}
-	camera->format = format.fmt.pix;
+	camera->format = pix;
+	camera->plane_count = plane_count;
 	camera->frame_interval = streamparm.parm.capture.timeperframe;
 	// fail, if we didn't succeed negotiating
 	// the requirements
 	if(
 			format_constraint == FORMAT_EXACT
-			&& format.fmt.pix.pixelformat != requested_format
+			&& pix.pixelformat != requested_format
 	) {
 		DEV_ERROR(
 				"device does not support required format: required: %d, supported: %d",
-				format.fmt.pix.pixelformat,
+				pix.pixelformat,
 				requested_format
 		);
 		return RET_FAILURE;
@@ -900,14 +1181,14 @@ ret_t negotiate_format(
 	if(
 			frame_size_constraint == FRAME_SIZE_EXACT
 			&& (
-				format.fmt.pix.width != frame_size.width
-				|| format.fmt.pix.height != frame_size.height
+				pix.width != frame_size.width
+				|| pix.height != frame_size.height
 			)
 	) {
 		DEV_ERROR(
 				"device does not support required size: required: %dx%d, supported: %dx%d",
 				frame_size.width, frame_size.height,
-				format.fmt.pix.width, format.fmt.pix.height
+				pix.width, pix.height
 		);
 		return RET_FAILURE;
 	}
@@ -937,3 +1218,68 @@ int ioctl_helper(int fh, unsigned int request, void *arg) {
 	while(-1 == r && (errno == EINTR || errno == EAGAIN) );
 	return r;
 }
+
+bool is_mplane(
+		const camera_t* camera
+)
+{
+	return camera->buf_type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+}
+
+void buffer_descr_init(
+		const camera_t* camera,
+		struct v4l2_buffer* descr,
+		struct v4l2_plane* plane
+)
+{
+	memset( descr, 0, sizeof(*descr) );
+	memset( plane, 0, sizeof(*plane) );
+	descr->type = camera->buf_type;
+	descr->memory = V4L2_MEMORY_MMAP;
+	if( is_mplane( camera ) ) {
+		descr->m.planes = plane;
+		descr->length = 1;
+	}
+}
+
+void format_get(
+		const struct v4l2_format* format,
+		img_format_t* pix,
+		uint* plane_count
+)
+{
+	if( format->type != V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE ) {
+		(*pix) = format->fmt.pix;
+		(*plane_count) = 1;
+		return;
+	}
+	const struct v4l2_pix_format_mplane* pix_mp = &format->fmt.pix_mp;
+	(*pix) = (img_format_t){
+		.width = pix_mp->width,
+		.height = pix_mp->height,
+		.pixelformat = pix_mp->pixelformat,
+		.field = pix_mp->field,
+		.bytesperline = pix_mp->plane_fmt[0].bytesperline,
+		.sizeimage = pix_mp->plane_fmt[0].sizeimage,
+		.colorspace = pix_mp->colorspace,
+		.ycbcr_enc = pix_mp->ycbcr_enc,
+		.quantization = pix_mp->quantization,
+		.xfer_func = pix_mp->xfer_func,
+	};
+	(*plane_count) = pix_mp->num_planes;
+}
+
+void format_set(
+		struct v4l2_format* format,
+		const img_format_t* pix
+)
+{
+	if( format->type != V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE ) {
+		format->fmt.pix = (*pix);
+		return;
+	}
+	// (the driver fills in the plane layout)
+	format->fmt.pix_mp.width = pix->width;
+	format->fmt.pix_mp.height = pix->height;
+	format->fmt.pix_mp.pixelformat = pix->pixelformat;
+}
@@ -118,8 +118,20 @@ typedef struct
 typedef struct {
 	char dev_name[STR_BUFFER_SIZE];
 	int dev_file;
+	// identify the device (see 'camera_list_modes_cached'):
+	char driver[16];
+	char card[32];
+	char bus_info[32];
+	__u32 driver_version;
+	// V4L2_BUF_TYPE_VIDEO_CAPTURE or
+	// V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE:
+	enum v4l2_buf_type buf_type;
 	buffer_container_t buffer_container;
+	// (multi-planar API: the first plane)
 	img_format_t format;
+	// only single plane layouts
+	// (e.g. NV12, not NV12M) can be captured:
+	uint plane_count;
 	frame_interval_t frame_interval;
 	// keep track of owned frames
 	// (useful for debugging)
@@ -170,6 +182,21 @@ ret_t camera_list_modes(
 		camera_mode_descrs_t* modes
 );
 
+// like 'camera_list_modes', but read the modes from
+// "CACHE_DIR/<bus info>.modes" if that file has been
+// written for the same device (bus info, card, driver
+// and driver version). Otherwise the modes are enumerated
+// and the file is (re)written.
+// Errors reading or writing the cache are not fatal.
+// from_cache (may be NULL): the modes were read from the cache
+// precondition: camera must be in state "initialized" or better
+ret_t camera_list_modes_cached(
+		camera_t* camera,
+		const char* cache_dir,
+		camera_mode_descrs_t* modes,
+		bool* from_cache
+);
+
 // precondition: camera must be in state "initialized"
 ret_t camera_set_mode(
 		camera_t* camera,
@@ -203,6 +230,15 @@ ret_t camera_stream_stop(
 		camera_t* camera
 );
 
+// wait until a frame can be dequeued
+// (without dequeuing it).
+// RET_FAILURE on timeout
+// precondition: camera must be in state "capturing"
+ret_t camera_wait_frame(
+		camera_t* camera,
+		const int timeout_ms
+);
+
 // precondition: camera must be in state "capturing"
 ret_t camera_get_frame(
 		camera_t* camera,
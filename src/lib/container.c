@@ -0,0 +1,318 @@
+#include "container.h"
+
+#include "output.h"
+
+#include <string.h>
+#include <errno.h>
+
+
+// frames are collected in the stdio buffer
+// and written in big chunks:
+#define WRITE_BUFFER_SIZE (1024*1024)
+
+/************************
+ * private utils decl
+*************************/
+
+ret_t container_open_next(
+		container_t* container
+);
+
+ret_t container_close_current(
+		container_t* container
+);
+
+// a standalone JPEG, with the
+// timestamp in a COM segment:
+ret_t container_write_jpeg(
+		container_t* container,
+		const uint64_t frame_number,
+		const timeval_t* time,
+		const void* buffer,
+		const size_t buffer_size
+);
+
+ret_t container_write_index(
+		container_t* container,
+		const uint64_t frame_number,
+		const timeval_t* time,
+		const size_t offset,
+		const size_t size
+);
+
+const char* container_file_ext(
+		const output_format_t format
+);
+
+/************************
+ * API implementation
+*************************/
+
+ret_t container_init(
+		container_t* container,
+		const char* output_dir,
+		const output_format_t format,
+		const uint width,
+		const uint height,
+		const size_t max_file_size,
+		const uint max_frame_count
+)
+{
+	(*container) = (container_t){
+		.format = format,
+		.width = width,
+		.height = height,
+		.max_file_size = max_file_size,
+		.max_frame_count = max_frame_count,
+		.file = NULL,
+		.index_file = NULL,
+		.file_buffer = NULL,
+		.file_counter = 0,
+		.frame_count = 0,
+		.file_size = 0,
+	};
+	strncpy( container->output_dir, output_dir, STR_BUFFER_SIZE-1 );
+	CALLOC( container->file_buffer, WRITE_BUFFER_SIZE, 1 );
+	return RET_SUCCESS;
+}
+
+ret_t container_exit(
+		container_t* container
+)
+{
+	ret_t ret = container_close_current( container );
+	FREE( container->file_buffer );
+	return ret;
+}
+
+ret_t container_write_frame(
+		container_t* container,
+		const uint64_t frame_number,
+		const timeval_t* time,
+		const void* buffer,
+		const size_t buffer_size
+)
+{
+	const size_t frame_size = (container->format == OUTPUT_FORMAT_JPEG)
+		? buffer_size
+		: image_output_size(
+			container->format,
+			container->width,
+			container->height
+		);
+	if( buffer_size < frame_size ) {
+		log_error( "container: buffer size too small!\n" );
+		return RET_FAILURE;
+	}
+	// rotate:
+	if(
+			container->file != NULL
+			&& (
+				(container->max_file_size > 0
+				 && container->file_size + frame_size > container->max_file_size)
+				|| (container->max_frame_count > 0
+				 && container->frame_count >= container->max_frame_count)
+			)
+	) {
+		if( RET_SUCCESS != container_close_current( container ) ) {
+			return RET_FAILURE;
+		}
+	}
+	if( container->file == NULL ) {
+		if( RET_SUCCESS != container_open_next( container ) ) {
+			return RET_FAILURE;
+		}
+	}
+	if( container->format == OUTPUT_FORMAT_JPEG ) {
+		return container_write_jpeg( container, frame_number, time, buffer, buffer_size );
+	}
+	// frame header:
+	int header_size = 0;
+	if( container->format == OUTPUT_FORMAT_YUV420 ) {
+		header_size = fprintf( container->file, "FRAME Xts=%lu.%06lu\n",
+				time->tv_sec,
+				time->tv_nsec / 1000
+		);
+	}
+	else {
+		header_size = fprintf( container->file, "%s\n#%lu.%06lu\n%u %u 255\n",
+				(container->format == OUTPUT_FORMAT_GRAY) ? "P5" : "P6",
+				time->tv_sec,
+				time->tv_nsec / 1000,
+				container->width,
+				container->height
+		);
+	}
+	if( header_size < 0 ) {
+		log_error( "container: writing frame header failed: %s\n", strerror(errno) );
+		return RET_FAILURE;
+	}
+	container->file_size += header_size;
+	const size_t data_offset = container->file_size;
+	if( frame_size != fwrite( buffer, 1, frame_size, container->file ) ) {
+		log_error( "container: writing frame failed: %s\n", strerror(errno) );
+		return RET_FAILURE;
+	}
+	container->file_size += frame_size;
+	container->frame_count++;
+	return container_write_index( container, frame_number, time, data_offset, frame_size );
+}
+
+/************************
+ * private utils impl
+*************************/
+
+ret_t container_open_next(
+		container_t* container
+)
+{
+	char path[STR_BUFFER_SIZE];
+	int path_size = snprintf( path, STR_BUFFER_SIZE, "%s/video%04u.%s",
+			container->output_dir,
+			container->file_counter,
+			container_file_ext( container->format )
+	);
+	if( path_size < 0 || path_size >= STR_BUFFER_SIZE ) {
+		log_error("'%s': path too long\n", container->output_dir);
+		return RET_FAILURE;
+	}
+	container->file = fopen( path, "w" );
+	if( container->file == NULL ) {
+		log_error("'%s': %s\n", path, strerror(errno));
+		return RET_FAILURE;
+	}
+	if( 0 != setvbuf( container->file, container->file_buffer, _IOFBF, WRITE_BUFFER_SIZE ) ) {
+		log_error("'%s': 'setvbuf' failed\n", path);
+	}
+	path_size = snprintf( path, STR_BUFFER_SIZE, "%s/video%04u.idx",
+			container->output_dir,
+			container->file_counter
+	);
+	if( path_size < 0 || path_size >= STR_BUFFER_SIZE ) {
+		log_error("'%s': path too long\n", container->output_dir);
+		fclose( container->file );
+		container->file = NULL;
+		return RET_FAILURE;
+	}
+	container->index_file = fopen( path, "w" );
+	if( container->index_file == NULL ) {
+		log_error("'%s': %s\n", path, strerror(errno));
+		fclose( container->file );
+		container->file = NULL;
+		return RET_FAILURE;
+	}
+	container->file_counter++;
+	container->frame_count = 0;
+	container->file_size = 0;
+	// stream header:
+	if( container->format == OUTPUT_FORMAT_YUV420 ) {
+		int header_size = fprintf( container->file, "YUV4MPEG2 W%u H%u F1:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n",
+				container->width,
+				container->height
+		);
+		if( header_size < 0 ) {
+			log_error( "container: writing header failed: %s\n", strerror(errno) );
+			return RET_FAILURE;
+		}
+		container->file_size += header_size;
+	}
+	return RET_SUCCESS;
+}
+
+ret_t container_close_current(
+		container_t* container
+)
+{
+	ret_t ret = RET_SUCCESS;
+	if( container->file != NULL ) {
+		if( fclose( container->file ) ) {
+			log_error( "container: 'fclose': %s\n", strerror(errno) );
+			ret = RET_FAILURE;
+		}
+		container->file = NULL;
+	}
+	if( container->index_file != NULL ) {
+		if( fclose( container->index_file ) ) {
+			log_error( "container: 'fclose': %s\n", strerror(errno) );
+			ret = RET_FAILURE;
+		}
+		container->index_file = NULL;
+	}
+	return ret;
+}
+
+ret_t container_write_jpeg(
+		container_t* container,
+		const uint64_t frame_number,
+		const timeval_t* time,
+		const void* buffer,
+		const size_t buffer_size
+)
+{
+	char comment[STR_BUFFER_SIZE];
+	snprintf( comment, STR_BUFFER_SIZE, "%lu.%06lu",
+			time->tv_sec,
+			time->tv_nsec / 1000
+	);
+	byte_t header[IMAGE_JPEG_HEADER_MAX_SIZE];
+	size_t header_size = 0;
+	if( RET_SUCCESS != image_jpeg_header(
+			buffer, buffer_size,
+			comment,
+			header, sizeof(header),
+			&header_size
+	) ) {
+		return RET_FAILURE;
+	}
+	// (the header replaces the SOI marker)
+	const size_t data_size = buffer_size - 2;
+	if(
+			header_size != fwrite( header, 1, header_size, container->file )
+			|| data_size != fwrite( (const byte_t* )buffer + 2, 1, data_size, container->file )
+	) {
+		log_error( "container: writing frame failed: %s\n", strerror(errno) );
+		return RET_FAILURE;
+	}
+	const size_t offset = container->file_size;
+	container->file_size += header_size + data_size;
+	container->frame_count++;
+	return container_write_index( container, frame_number, time, offset, header_size + data_size );
+}
+
+ret_t container_write_index(
+		container_t* container,
+		const uint64_t frame_number,
+		const timeval_t* time,
+		const size_t offset,
+		const size_t size
+)
+{
+	if( 0 > fprintf( container->index_file, "%lu %zu %zu %lu.%06lu\n",
+			frame_number,
+			offset,
+			size,
+			time->tv_sec,
+			time->tv_nsec / 1000
+	)) {
+		log_error( "container: writing index failed: %s\n", strerror(errno) );
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
+const char* container_file_ext(
+		const output_format_t format
+)
+{
+	switch( format ) {
+		case OUTPUT_FORMAT_YUV420:
+			return "y4m";
+		case OUTPUT_FORMAT_JPEG:
+			return "mjpeg";
+		case OUTPUT_FORMAT_GRAY:
+			return "pgm";
+		case OUTPUT_FORMAT_RGB:
+			return "ppm";
+	}
+	return "raw";
+}
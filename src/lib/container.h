@@ -0,0 +1,75 @@
+/****************************
+ * Video Container Files
+ *
+ * append frames to few big files
+ * instead of writing one file per frame:
+ * - YUV420: YUV4MPEG2 stream (.y4m)
+ * - RGB: concatenated binary PPMs (.ppm, netpbm multi image file)
+ * - GRAY: concatenated binary PGMs (.pgm)
+ * - JPEG: concatenated JPEG files (.mjpeg), as stored by
+ *   'image_save_jpeg' (timestamp in a COM segment)
+ *
+ * For every container file an index file (.idx)
+ * is written, one line per frame:
+ *   FRAME_NUMBER OFFSET SIZE TIMESTAMP
+ * (OFFSET/SIZE of the raw image data in bytes,
+ * JPEG: of the whole JPEG file)
+ ***************************/
+#pragma once
+
+#include "global.h"
+#include "image.h"
+#include "time.h"
+
+#include <stdint.h>
+
+
+/********************
+ * Types
+********************/
+
+typedef struct {
+	// settings:
+	char output_dir[STR_BUFFER_SIZE];
+	output_format_t format;
+	uint width;
+	uint height;
+	size_t max_file_size; // 0 means no limit
+	uint max_frame_count; // 0 means no limit
+	// current file:
+	FILE* file;
+	FILE* index_file;
+	char* file_buffer;
+	uint file_counter;
+	uint frame_count;
+	size_t file_size;
+} container_t;
+
+/********************
+ * Functions
+********************/
+
+ret_t container_init(
+		container_t* container,
+		const char* output_dir,
+		const output_format_t format,
+		const uint width,
+		const uint height,
+		const size_t max_file_size, // 0 means no limit
+		const uint max_frame_count // 0 means no limit
+);
+
+// flushes and closes the current file
+ret_t container_exit(
+		container_t* container
+);
+
+// append frame to the current file.
+// Starts a new file if limits are exceeded.
+ret_t container_write_frame(
+		container_t* container,
+		const uint64_t frame_number,
+		const timeval_t* time,
+		const void* buffer,
+		const size_t buffer_size
+);
@@ -0,0 +1,337 @@
+#include "executor.h"
+
+#include "thread.h"
+#include "semaphore.h"
+#include "output.h"
+
+#include <string.h>
+#include <sched.h>
+
+
+DEF_RING_BUFFER(executor_tasks,executor_task_t)
+
+/************************
+ * private utils decl
+*************************/
+
+// priority inheritance: tasks are submitted
+// from SCHED_FIFO threads, a preempted worker
+// holding the lock is boosted until it releases it:
+void executor_mutex_init(
+		pthread_mutex_t* mutex
+);
+
+void* executor_worker_run(
+		void* arg
+);
+
+// own deque first, then steal:
+bool executor_take(
+		executor_t* executor,
+		const uint worker_index,
+		executor_task_t* task
+);
+
+bool executor_worker_pop(
+		executor_worker_t* worker,
+		executor_task_t* task
+);
+
+void executor_task_done(
+		executor_t* executor
+);
+
+void executor_strand_run(
+		void* arg
+);
+
+// join the first 'started_count' workers
+// and free all resources:
+void executor_cleanup(
+		executor_t* executor,
+		const uint started_count
+);
+
+/************************
+ * API implementation
+*************************/
+
+ret_t executor_init(
+		executor_t* executor,
+		const char* name,
+		const int* cpus,
+		const uint worker_count,
+		const uint max_tasks_per_worker
+)
+{
+	if( worker_count == 0 || worker_count > EXECUTOR_MAX_WORKERS ) {
+		log_error( "executor: worker count must be 1..%u\n", EXECUTOR_MAX_WORKERS );
+		return RET_FAILURE;
+	}
+	executor->worker_count = worker_count;
+	executor->queued_count = 0;
+	executor->pending_count = 0;
+	executor->next_worker = 0;
+	executor->stop = false;
+	sem_init( &executor->free_slots, 0, worker_count * max_tasks_per_worker );
+	executor_mutex_init( &executor->idle_mutex );
+	pthread_cond_init( &executor->idle_cond, NULL );
+	for( uint i=0; i<worker_count; i++ ) {
+		executor_worker_t* worker = &executor->workers[i];
+		worker->executor = executor;
+		worker->index = i;
+		worker->ret = RET_SUCCESS;
+		worker->tasks.entries = NULL;
+		executor_tasks_init( &worker->tasks, max_tasks_per_worker );
+		executor_mutex_init( &worker->mutex );
+	}
+	for( uint i=0; i<worker_count; i++ ) {
+		char thread_name[16];
+		snprintf( thread_name, sizeof(thread_name), "%s%u", name, i );
+		if( RET_SUCCESS != thread_create(
+				thread_name,
+				&executor->workers[i].td,
+				executor_worker_run,
+				&executor->workers[i],
+				SCHED_OTHER,
+				-1,
+				cpus[i]
+		) ) {
+			log_error( "executor: failed to start worker %u\n", i );
+			executor_cleanup( executor, i );
+			return RET_FAILURE;
+		}
+	}
+	return RET_SUCCESS;
+}
+
+ret_t executor_exit(
+		executor_t* executor
+)
+{
+	ret_t ret = RET_SUCCESS;
+	pthread_mutex_lock( &executor->idle_mutex );
+	executor->stop = true;
+	pthread_cond_broadcast( &executor->idle_cond );
+	pthread_mutex_unlock( &executor->idle_mutex );
+	for( uint i=0; i<executor->worker_count; i++ ) {
+		if( RET_SUCCESS != thread_join_ret( executor->workers[i].td ) ) {
+			ret = RET_FAILURE;
+		}
+	}
+	executor_cleanup( executor, 0 );
+	return ret;
+}
+
+void executor_submit(
+		executor_t* executor,
+		executor_func_t func,
+		void* arg
+)
+{
+	sem_wait_nointr( &executor->free_slots );
+	executor->pending_count++;
+	// round robin, skip full deques
+	// (at least one has a free slot):
+	const uint start = executor->next_worker++;
+	for( uint i=0; i<executor->worker_count; i++ ) {
+		executor_worker_t* worker = &executor->workers[(start + i) % executor->worker_count];
+		pthread_mutex_lock( &worker->mutex );
+		if(
+				executor_tasks_get_count( &worker->tasks )
+				< executor_tasks_get_max_count( &worker->tasks )
+		) {
+			executor_task_t* task = NULL;
+			executor_tasks_push_start( &worker->tasks, &task );
+			(*task) = (executor_task_t){ .func = func, .arg = arg };
+			executor_tasks_push_end( &worker->tasks );
+			// (only once the task can be taken)
+			executor->queued_count++;
+			pthread_mutex_unlock( &worker->mutex );
+			break;
+		}
+		pthread_mutex_unlock( &worker->mutex );
+	}
+	pthread_mutex_lock( &executor->idle_mutex );
+	pthread_cond_signal( &executor->idle_cond );
+	pthread_mutex_unlock( &executor->idle_mutex );
+}
+
+void executor_strand_init(
+		executor_strand_t* strand,
+		executor_t* executor,
+		const uint max_tasks
+)
+{
+	strand->executor = executor;
+	strand->tasks.entries = NULL;
+	executor_tasks_init( &strand->tasks, max_tasks );
+	sem_init( &strand->free_slots, 0, max_tasks );
+	executor_mutex_init( &strand->mutex );
+	strand->scheduled = false;
+}
+
+void executor_strand_exit(
+		executor_strand_t* strand
+)
+{
+	assert( !strand->scheduled );
+	pthread_mutex_destroy( &strand->mutex );
+	sem_destroy( &strand->free_slots );
+	executor_tasks_exit( &strand->tasks );
+}
+
+void executor_strand_post(
+		executor_strand_t* strand,
+		executor_func_t func,
+		void* arg
+)
+{
+	sem_wait_nointr( &strand->free_slots );
+	pthread_mutex_lock( &strand->mutex );
+	executor_task_t* task = NULL;
+	executor_tasks_push_start( &strand->tasks, &task );
+	(*task) = (executor_task_t){ .func = func, .arg = arg };
+	executor_tasks_push_end( &strand->tasks );
+	const bool schedule = !strand->scheduled;
+	strand->scheduled = true;
+	pthread_mutex_unlock( &strand->mutex );
+	if( schedule ) {
+		executor_submit( strand->executor, executor_strand_run, strand );
+	}
+}
+
+/************************
+ * private utils impl
+*************************/
+
+void executor_mutex_init(
+		pthread_mutex_t* mutex
+)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init( &attr );
+	pthread_mutexattr_setprotocol( &attr, PTHREAD_PRIO_INHERIT );
+	pthread_mutex_init( mutex, &attr );
+	pthread_mutexattr_destroy( &attr );
+}
+
+void* executor_worker_run(
+		void* arg
+)
+{
+	executor_worker_t* worker = arg;
+	executor_t* executor = worker->executor;
+	while( true ) {
+		executor_task_t task;
+		if( executor_take( executor, worker->index, &task ) ) {
+			task.func( task.arg );
+			executor_task_done( executor );
+			continue;
+		}
+		pthread_mutex_lock( &executor->idle_mutex );
+		while(
+				executor->queued_count == 0
+				&& !(executor->stop && executor->pending_count == 0)
+		) {
+			pthread_cond_wait( &executor->idle_cond, &executor->idle_mutex );
+		}
+		const bool done = (
+				executor->stop
+				&& executor->pending_count == 0
+		);
+		pthread_mutex_unlock( &executor->idle_mutex );
+		if( done ) {
+			break;
+		}
+	}
+	return &worker->ret;
+}
+
+bool executor_take(
+		executor_t* executor,
+		const uint worker_index,
+		executor_task_t* task
+)
+{
+	for( uint i=0; i<executor->worker_count; i++ ) {
+		executor_worker_t* victim = &executor->workers[(worker_index + i) % executor->worker_count];
+		if( executor_worker_pop( victim, task ) ) {
+			sem_post( &executor->free_slots );
+			return true;
+		}
+	}
+	return false;
+}
+
+bool executor_worker_pop(
+		executor_worker_t* worker,
+		executor_task_t* task
+)
+{
+	bool ret = false;
+	pthread_mutex_lock( &worker->mutex );
+	if( executor_tasks_get_count( &worker->tasks ) > 0 ) {
+		(*task) = *executor_tasks_get( &worker->tasks );
+		executor_tasks_pop( &worker->tasks );
+		worker->executor->queued_count--;
+		ret = true;
+	}
+	pthread_mutex_unlock( &worker->mutex );
+	return ret;
+}
+
+void executor_task_done(
+		executor_t* executor
+)
+{
+	if( --executor->pending_count == 0 ) {
+		// wake workers waiting for the executor to drain:
+		pthread_mutex_lock( &executor->idle_mutex );
+		pthread_cond_broadcast( &executor->idle_cond );
+		pthread_mutex_unlock( &executor->idle_mutex );
+	}
+}
+
+void executor_strand_run(
+		void* arg
+)
+{
+	executor_strand_t* strand = arg;
+	while( true ) {
+		pthread_mutex_lock( &strand->mutex );
+		if( executor_tasks_get_count( &strand->tasks ) == 0 ) {
+			strand->scheduled = false;
+			pthread_mutex_unlock( &strand->mutex );
+			return;
+		}
+		executor_task_t task = *executor_tasks_get( &strand->tasks );
+		executor_tasks_pop( &strand->tasks );
+		pthread_mutex_unlock( &strand->mutex );
+		sem_post( &strand->free_slots );
+		task.func( task.arg );
+	}
+}
+
+void executor_cleanup(
+		executor_t* executor,
+		const uint started_count
+)
+{
+	if( started_count > 0 ) {
+		pthread_mutex_lock( &executor->idle_mutex );
+		executor->stop = true;
+		pthread_cond_broadcast( &executor->idle_cond );
+		pthread_mutex_unlock( &executor->idle_mutex );
+		for( uint i=0; i<started_count; i++ ) {
+			thread_join_ret( executor->workers[i].td );
+		}
+	}
+	for( uint i=0; i<executor->worker_count; i++ ) {
+		pthread_mutex_destroy( &executor->workers[i].mutex );
+		executor_tasks_exit( &executor->workers[i].tasks );
+	}
+	pthread_cond_destroy( &executor->idle_cond );
+	pthread_mutex_destroy( &executor->idle_mutex );
+	sem_destroy( &executor->free_slots );
+}
@@ -0,0 +1,137 @@
+/****************************
+ * Work Stealing Executor
+ *
+ * a pool of worker threads for best effort
+ * (SCHED_OTHER) work, e.g. storage and compression.
+ * Every worker owns a task deque:
+ * - tasks submitted from outside the pool are
+ *   distributed round robin over the workers
+ * - a worker runs its own tasks (oldest first) and
+ *   steals the oldest task of another worker
+ *   if it has none left
+ * The deques are protected by one mutex each,
+ * contention is low as long as tasks are coarse
+ * (one frame per task). All mutexes use priority
+ * inheritance, so real time threads may submit
+ * and post tasks.
+ *
+ * Strands:
+ * tasks posted to the same strand run one after
+ * the other in the order they have been posted
+ * (e.g. one strand per output file), tasks of
+ * different strands run in parallel.
+ * A strand occupies at most one executor task
+ * at a time, so the executor must have more
+ * task slots than strands, if tasks post to strands.
+ ***************************/
+#pragma once
+
+#include "global.h"
+#include "ring_buffer.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+
+#define EXECUTOR_MAX_WORKERS 16
+
+/********************
+ * Types
+********************/
+
+typedef void (*executor_func_t)(void* arg);
+
+typedef struct {
+	executor_func_t func;
+	void* arg;
+} executor_task_t;
+
+DECL_RING_BUFFER(executor_tasks,executor_task_t)
+
+struct executor;
+
+typedef struct {
+	struct executor* executor;
+	pthread_t td;
+	ret_t ret;
+	uint index;
+	// own tasks (oldest first):
+	executor_tasks_t tasks;
+	pthread_mutex_t mutex;
+} executor_worker_t;
+
+typedef struct executor {
+	executor_worker_t workers[EXECUTOR_MAX_WORKERS];
+	uint worker_count;
+	// free task slots over all workers
+	// (submitting blocks if there are none):
+	sem_t free_slots;
+	// idle workers sleep here:
+	pthread_mutex_t idle_mutex;
+	pthread_cond_t idle_cond;
+	// tasks in the deques
+	// (changed under the deque's mutex):
+	_Atomic uint queued_count;
+	// queued or running:
+	_Atomic uint pending_count;
+	_Atomic uint next_worker;
+	bool stop;
+} executor_t;
+
+typedef struct {
+	executor_t* executor;
+	executor_tasks_t tasks;
+	sem_t free_slots;
+	pthread_mutex_t mutex;
+	// a task draining the strand is
+	// submitted to the executor:
+	bool scheduled;
+} executor_strand_t;
+
+/********************
+ * Functions
+********************/
+
+// start one worker per entry of 'cpus'
+// (-1: no cpu affinity)
+ret_t executor_init(
+		executor_t* executor,
+		const char* name,
+		const int* cpus,
+		const uint worker_count,
+		const uint max_tasks_per_worker
+);
+
+// runs all remaining tasks,
+// then stops the workers:
+ret_t executor_exit(
+		executor_t* executor
+);
+
+// thread safe.
+// blocks while the executor is full
+void executor_submit(
+		executor_t* executor,
+		executor_func_t func,
+		void* arg
+);
+
+void executor_strand_init(
+		executor_strand_t* strand,
+		executor_t* executor,
+		const uint max_tasks
+);
+
+// all tasks of the strand must have run
+void executor_strand_exit(
+		executor_strand_t* strand
+);
+
+// thread safe.
+// blocks while the strand is full
+void executor_strand_post(
+		executor_strand_t* strand,
+		executor_func_t func,
+		void* arg
+);
@@ -0,0 +1,51 @@
+#include "histogram.h"
+
+#include "output.h"
+
+
+uint64_t histogram_percentile(
+		const histogram_t* histogram,
+		const float p
+)
+{
+	const uint64_t rank = (uint64_t )(p / 100 * histogram->count);
+	uint64_t acc = 0;
+	for( uint i=0; i<HISTOGRAM_BUCKET_COUNT; i++ ) {
+		acc += histogram->buckets[i];
+		if( acc >= rank && acc > 0 ) {
+			return MIN( (2ULL << i) - 1, histogram->max );
+		}
+	}
+	return histogram->max;
+}
+
+void histogram_print(
+		const histogram_t* histogram,
+		const char* name,
+		const char* unit
+)
+{
+	if( histogram->count == 0 ) {
+		log_info( "%s: no samples\n", name );
+		return;
+	}
+	log_info( "%s: count: %lu, mean: %lu%s, p50: <= %lu%s, p99: <= %lu%s, max: %lu%s\n",
+			name,
+			(unsigned long )histogram->count,
+			(unsigned long )(histogram->sum / histogram->count), unit,
+			(unsigned long )histogram_percentile( histogram, 50 ), unit,
+			(unsigned long )histogram_percentile( histogram, 99 ), unit,
+			(unsigned long )histogram->max, unit
+	);
+	for( uint i=0; i<HISTOGRAM_BUCKET_COUNT; i++ ) {
+		if( histogram->buckets[i] > 0 ) {
+			log_verbose( "%s: [%lu, %lu)%s: %lu\n",
+					name,
+					(unsigned long )((i == 0) ? 0 : (1ULL << i)),
+					(unsigned long )(2ULL << i),
+					unit,
+					(unsigned long )histogram->buckets[i]
+			);
+		}
+	}
+}
@@ -0,0 +1,65 @@
+/****************************
+ * Latency Histogram
+ *
+ * log2 buckets: bucket i counts values
+ * in [2^i, 2^(i+1)), bucket 0 also counts 0.
+ * Cheap enough to be updated on every frame,
+ * not thread safe (one writer, read when done).
+ ***************************/
+#pragma once
+
+#include "global.h"
+
+#include <stdint.h>
+
+
+#define HISTOGRAM_BUCKET_COUNT 40
+
+/********************
+ * Types
+********************/
+
+typedef struct {
+	uint64_t buckets[HISTOGRAM_BUCKET_COUNT];
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+} histogram_t;
+
+/********************
+ * Functions
+********************/
+
+static inline void histogram_init(
+		histogram_t* histogram
+)
+{
+	(*histogram) = (histogram_t){ 0 };
+}
+
+static inline void histogram_add(
+		histogram_t* histogram,
+		const uint64_t value
+)
+{
+	uint bucket = (value == 0) ? 0 : 63 - __builtin_clzll( value );
+	bucket = MIN( bucket, HISTOGRAM_BUCKET_COUNT-1 );
+	histogram->buckets[bucket]++;
+	histogram->count++;
+	histogram->sum += value;
+	histogram->max = MAX( histogram->max, value );
+}
+
+// upper bound of the bucket containing
+// the p'th percentile (0 < p <= 100):
+uint64_t histogram_percentile(
+		const histogram_t* histogram,
+		const float p
+);
+
+// summary as info, buckets as verbose output:
+void histogram_print(
+		const histogram_t* histogram,
+		const char* name,
+		const char* unit
+);
@@ -7,6 +7,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#include <pthread.h>
 
 
 #define CAST_TO_BYTE_PTR(VOID_P) \
@@ -273,6 +277,16 @@
 
 #define YUYV_SIZE 2
 
+/*****************
+ * GREY, planar (YU12) and
+ * semi-planar (NV12) YUV 4:2:0
+ * (bytes per pixel in the luma plane)
+ *****************/
+
+#define GREY_SIZE 1
+#define NV12_SIZE 1
+#define YUV420_SIZE 1
+
 /*****************
  * Utils
  *****************/
@@ -313,6 +327,86 @@
 	} \
 }
 
+/*****************
+ * Lookup tables
+ *
+ * formats with 1 or 2 bytes per pixel
+ * are converted by table lookup:
+ * the pixel value (bytes as little endian word)
+ * is mapped to its RGB triple.
+ * The tables are filled by 'image_converter_init'
+ * (not by the kernel, which may run on a real time
+ * thread) with the same macros as used in CONVERT_PIXEL.
+ *****************/
+
+#define DEF_RGB_LUT(FORMAT) \
+byte_t CAT(rgb_lut_,FORMAT)[1 << (8*GET_SIZE(FORMAT))][3]; \
+pthread_once_t CAT(rgb_lut_once_,FORMAT) = PTHREAD_ONCE_INIT; \
+void CAT(rgb_lut_init_,FORMAT)( void ) \
+{ \
+	for( uint value=0; value<(1u << (8*GET_SIZE(FORMAT))); value++ ) { \
+		const byte_t current_pixel[2] = { value & 0xff, value >> 8 }; \
+		CAT(rgb_lut_,FORMAT)[value][0] = GET_RED(FORMAT,current_pixel); \
+		CAT(rgb_lut_,FORMAT)[value][1] = GET_GREEN(FORMAT,current_pixel); \
+		CAT(rgb_lut_,FORMAT)[value][2] = GET_BLUE(FORMAT,current_pixel); \
+	} \
+} \
+void CAT(rgb_lut_prepare_,FORMAT)( void ) \
+{ \
+	pthread_once( &CAT(rgb_lut_once_,FORMAT), CAT(rgb_lut_init_,FORMAT) ); \
+} \
+DEF_RGB_KERNEL(FORMAT,CONVERT_PIXEL_LUT)
+
+// precondition: 'rgb_lut_prepare_FORMAT' has been called
+#define CONVERT_PIXEL_LUT(FORMAT,SRC_BUFFER,DST_BUFFER,format) { \
+	for( uint y=0; y<format.height; y++ ) { \
+		const byte_t* src_row = &SRC_BUFFER[y*format.bytesperline]; \
+		byte_t* dst_row = &DST_BUFFER[y*format.width*3]; \
+		for( uint x=0; x<format.width; x++ ) { \
+			const uint value = (GET_SIZE(FORMAT) == 1) \
+				? src_row[x] \
+				: (uint )src_row[x*2] | ((uint )src_row[x*2+1] << 8); \
+			memcpy( &dst_row[x*3], CAT(rgb_lut_,FORMAT)[value], 3 ); \
+		} \
+	} \
+}
+
+/*****************
+ * RGB kernels
+ *
+ * 'convert_rgb_FORMAT' converts one format
+ * to RGB, the pixel size and layout are
+ * compile time constants.
+ *****************/
+
+#define DEF_RGB_KERNEL(FORMAT,CONVERT) \
+ret_t CAT(convert_rgb_,FORMAT)( \
+		const image_converter_t* converter, \
+		const byte_t* src, \
+		const size_t src_size, \
+		byte_t* dst, \
+		const size_t dst_size \
+) \
+{ \
+	(void )src_size; \
+	(void )dst_size; \
+	const img_format_t format = converter->src_format; \
+	CONVERT(FORMAT,src,dst,format) \
+	return RET_SUCCESS; \
+}
+
+DEF_RGB_LUT(RGB332)
+DEF_RGB_LUT(XRGB444)
+DEF_RGB_LUT(XRGB555)
+DEF_RGB_LUT(RGB565)
+DEF_RGB_LUT(XRGB555X)
+DEF_RGB_LUT(RGB565X)
+DEF_RGB_KERNEL(BGR24,CONVERT_PIXEL)
+DEF_RGB_KERNEL(RGB24,CONVERT_PIXEL)
+DEF_RGB_KERNEL(BGR666,CONVERT_PIXEL)
+DEF_RGB_KERNEL(XBGR32,CONVERT_PIXEL)
+DEF_RGB_KERNEL(XRGB32,CONVERT_PIXEL)
+
 /************************
  * private utils decl
 *************************/
@@ -322,6 +416,267 @@ ret_t check_format(
 		const img_format_t format
 );
 
+// luma and chroma planes of a frame:
+typedef struct {
+	const byte_t* y;
+	const byte_t* u; // NULL for GREY
+	const byte_t* v;
+	uint y_stride;
+	uint uv_stride;
+	// distance between chroma samples
+	// (2: interleaved, as in NV12):
+	uint uv_step;
+} yuv_planes_t;
+
+// GREY, NV12 or YU12:
+bool format_is_planar(
+		const img_format_t format
+);
+
+// precondition: 'format_is_planar'
+void yuv_planes_init(
+		const img_format_t format,
+		const void* buffer,
+		yuv_planes_t* planes
+);
+
+// bytes of a frame, including all planes:
+size_t format_image_size(
+		const img_format_t format
+);
+
+/*****************
+ * Conversion kernels
+ *
+ * one function per (source format, output format),
+ * selected once by 'image_converter_init'.
+ * The source format has been checked
+ * and the output buffer is large enough.
+ *****************/
+
+ret_t planar_to_rgb(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+ret_t planar_to_yuv420(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+// luma plane only:
+ret_t planar_to_gray(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+ret_t yuyv_to_rgb(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+ret_t yuyv_to_yuv420(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+// Y samples only:
+ret_t yuyv_to_gray(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+// MJPEG to RGB, YUV420 or GRAY:
+ret_t jpeg_to_raw(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+// MJPEG to JPEG (pass the bitstream on):
+ret_t jpeg_copy(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+// sum of absolute differences.
+// simple loops over contiguous rows,
+// so that the compiler vectorizes them:
+uint diff_row(
+		const byte_t* restrict row_1,
+		const byte_t* restrict row_2,
+		const uint count
+);
+
+// luma of pixel i at byte 2*i:
+uint diff_row_yuyv(
+		const byte_t* restrict row_1,
+		const byte_t* restrict row_2,
+		const uint count
+);
+
+// one plane of interleaved 8 bit samples
+// (channels per pixel), rows without padding:
+void resize_plane(
+		const byte_t* src,
+		const uint src_width,
+		const uint src_height,
+		const uint channels,
+		byte_t* dst,
+		const uint dst_width,
+		const uint dst_height
+);
+
+// dst = average of FACTOR x FACTOR source pixels,
+// with the loop bounds known at compile time:
+void box_plane_2(
+		const byte_t* restrict src,
+		const uint src_width,
+		const uint channels,
+		byte_t* restrict dst,
+		const uint dst_width,
+		const uint dst_height
+);
+
+void box_plane_4(
+		const byte_t* restrict src,
+		const uint src_width,
+		const uint channels,
+		byte_t* restrict dst,
+		const uint dst_width,
+		const uint dst_height
+);
+
+void bilinear_plane(
+		const byte_t* src,
+		const uint src_width,
+		const uint src_height,
+		const uint channels,
+		byte_t* dst,
+		const uint dst_width,
+		const uint dst_height
+);
+
+// libjpeg reports errors by calling 'error_exit',
+// which must not return:
+typedef struct {
+	struct jpeg_error_mgr mgr;
+	jmp_buf jump;
+} jpeg_error_t;
+
+void jpeg_error_exit(
+		j_common_ptr cinfo
+);
+
+// read the header, set up the decoder
+// (1/scale_denom resolution) and start decompressing:
+ret_t jpeg_start(
+		struct jpeg_decompress_struct* cinfo,
+		const void* src_buffer,
+		const size_t src_size,
+		const J_COLOR_SPACE color_space,
+		const uint scale_denom
+);
+
+// out_color_space for an output format:
+J_COLOR_SPACE jpeg_color_space(
+		const output_format_t format
+);
+
+// (called from 'image_jpeg_decode' after 'setjmp')
+// RGB or grayscale, rows as decoded:
+ret_t jpeg_decode_rgb(
+		struct jpeg_decompress_struct* cinfo,
+		byte_t* dst
+);
+
+ret_t jpeg_decode_yuv420(
+		struct jpeg_decompress_struct* cinfo,
+		byte_t* dst
+);
+
+// scan the markers up to SOS for a DHT segment:
+ret_t jpeg_has_huffman_tables(
+		const byte_t* buffer,
+		const size_t buffer_size,
+		bool* result
+);
+
+// one DHT segment with the tables
+// libjpeg uses by default (ITU T.81, K.3):
+ret_t jpeg_std_huffman_tables(
+		byte_t* dst,
+		const size_t dst_max_size,
+		size_t* size
+);
+
+typedef struct {
+	__u32 pixelformat;
+	output_format_t dst_format;
+	image_convert_func_t convert;
+	// prepares the kernel (e.g. its lookup table),
+	// may be NULL:
+	void (*prepare)( void );
+} convert_kernel_t;
+
+const convert_kernel_t convert_kernels[] = {
+	{ V4L2_PIX_FMT_RGB332, OUTPUT_FORMAT_RGB, convert_rgb_RGB332, rgb_lut_prepare_RGB332 },
+	{ V4L2_PIX_FMT_ARGB444, OUTPUT_FORMAT_RGB, convert_rgb_XRGB444, rgb_lut_prepare_XRGB444 },
+	{ V4L2_PIX_FMT_XRGB444, OUTPUT_FORMAT_RGB, convert_rgb_XRGB444, rgb_lut_prepare_XRGB444 },
+	{ V4L2_PIX_FMT_ARGB555, OUTPUT_FORMAT_RGB, convert_rgb_XRGB555, rgb_lut_prepare_XRGB555 },
+	{ V4L2_PIX_FMT_XRGB555, OUTPUT_FORMAT_RGB, convert_rgb_XRGB555, rgb_lut_prepare_XRGB555 },
+	{ V4L2_PIX_FMT_RGB565, OUTPUT_FORMAT_RGB, convert_rgb_RGB565, rgb_lut_prepare_RGB565 },
+	{ V4L2_PIX_FMT_ARGB555X, OUTPUT_FORMAT_RGB, convert_rgb_XRGB555X, rgb_lut_prepare_XRGB555X },
+	{ V4L2_PIX_FMT_XRGB555X, OUTPUT_FORMAT_RGB, convert_rgb_XRGB555X, rgb_lut_prepare_XRGB555X },
+	{ V4L2_PIX_FMT_RGB565X, OUTPUT_FORMAT_RGB, convert_rgb_RGB565X, rgb_lut_prepare_RGB565X },
+	{ V4L2_PIX_FMT_BGR24, OUTPUT_FORMAT_RGB, convert_rgb_BGR24, NULL },
+	{ V4L2_PIX_FMT_RGB24, OUTPUT_FORMAT_RGB, convert_rgb_RGB24, NULL },
+	{ V4L2_PIX_FMT_BGR666, OUTPUT_FORMAT_RGB, convert_rgb_BGR666, NULL },
+	{ V4L2_PIX_FMT_ABGR32, OUTPUT_FORMAT_RGB, convert_rgb_XBGR32, NULL },
+	{ V4L2_PIX_FMT_XBGR32, OUTPUT_FORMAT_RGB, convert_rgb_XBGR32, NULL },
+	{ V4L2_PIX_FMT_ARGB32, OUTPUT_FORMAT_RGB, convert_rgb_XRGB32, NULL },
+	{ V4L2_PIX_FMT_XRGB32, OUTPUT_FORMAT_RGB, convert_rgb_XRGB32, NULL },
+	{ V4L2_PIX_FMT_YUYV, OUTPUT_FORMAT_RGB, yuyv_to_rgb, NULL },
+	{ V4L2_PIX_FMT_YUYV, OUTPUT_FORMAT_YUV420, yuyv_to_yuv420, NULL },
+	{ V4L2_PIX_FMT_YUYV, OUTPUT_FORMAT_GRAY, yuyv_to_gray, NULL },
+	{ V4L2_PIX_FMT_GREY, OUTPUT_FORMAT_RGB, planar_to_rgb, NULL },
+	{ V4L2_PIX_FMT_GREY, OUTPUT_FORMAT_YUV420, planar_to_yuv420, NULL },
+	{ V4L2_PIX_FMT_GREY, OUTPUT_FORMAT_GRAY, planar_to_gray, NULL },
+	{ V4L2_PIX_FMT_NV12, OUTPUT_FORMAT_RGB, planar_to_rgb, NULL },
+	{ V4L2_PIX_FMT_NV12, OUTPUT_FORMAT_YUV420, planar_to_yuv420, NULL },
+	{ V4L2_PIX_FMT_NV12, OUTPUT_FORMAT_GRAY, planar_to_gray, NULL },
+	{ V4L2_PIX_FMT_YUV420, OUTPUT_FORMAT_RGB, planar_to_rgb, NULL },
+	{ V4L2_PIX_FMT_YUV420, OUTPUT_FORMAT_YUV420, planar_to_yuv420, NULL },
+	{ V4L2_PIX_FMT_YUV420, OUTPUT_FORMAT_GRAY, planar_to_gray, NULL },
+	{ V4L2_PIX_FMT_MJPEG, OUTPUT_FORMAT_RGB, jpeg_to_raw, NULL },
+	{ V4L2_PIX_FMT_MJPEG, OUTPUT_FORMAT_YUV420, jpeg_to_raw, NULL },
+	{ V4L2_PIX_FMT_MJPEG, OUTPUT_FORMAT_GRAY, jpeg_to_raw, NULL },
+	{ V4L2_PIX_FMT_MJPEG, OUTPUT_FORMAT_JPEG, jpeg_copy, NULL },
+};
+
 /************************
  * API implementation
 *************************/
@@ -392,258 +747,1577 @@ ret_t image_save_ppm_to_ram(
 	return RET_SUCCESS;
 }
 
-ret_t image_convert_to_rgb(
-		const img_format_t src_format,
-		const void* src_buffer,
-		const void* dst_buffer,
-		const size_t dst_size
+ret_t image_save_pgm(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		const uint width,
+		const uint height
 )
 {
-	if( RET_SUCCESS != check_format( src_format ) ) {
+	FILE* fd = fopen( filename, "w+" );
+	if( fd == NULL ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
 		return RET_FAILURE;
 	}
-	// check if dst size is sufficient:
-	if( dst_size < image_rgb_size( src_format.width, src_format.height ) ) {
-		log_error( "buffer size does not correspond to format size\n" );
+	if( RET_SUCCESS != image_save_pgm_to_ram(
+				filename,
+				comment,
+				buffer,
+				buffer_size,
+				width, height,
+				fd
+	)) {
+		fclose( fd );
 		return RET_FAILURE;
 	}
-	const byte_t* input_buffer = CAST_TO_BYTE_PTR( src_buffer );
-	byte_t* output_buffer = CAST_TO_BYTE_PTR( dst_buffer );
-	if( src_format.pixelformat == V4L2_PIX_FMT_RGB332 ) {
-		CONVERT_PIXEL(RGB332,input_buffer,output_buffer,src_format)
-	}
-	else if(
-			src_format.pixelformat == V4L2_PIX_FMT_ARGB444
-			|| src_format.pixelformat == V4L2_PIX_FMT_XRGB444
-	) {
-		CONVERT_PIXEL(XRGB444,input_buffer,output_buffer,src_format)
-	}
-	else if(
-			src_format.pixelformat == V4L2_PIX_FMT_ARGB555
-			|| src_format.pixelformat == V4L2_PIX_FMT_XRGB555
-	) {
-		CONVERT_PIXEL(XRGB555,input_buffer,output_buffer,src_format)
-	}
-	else if( src_format.pixelformat == V4L2_PIX_FMT_RGB565
-	) {
-		CONVERT_PIXEL(RGB565,input_buffer,output_buffer,src_format)
-	}
-	else if(
-			src_format.pixelformat == V4L2_PIX_FMT_ARGB555X
-			|| src_format.pixelformat == V4L2_PIX_FMT_XRGB555X
-	) {
-		CONVERT_PIXEL(XRGB555X,input_buffer,output_buffer,src_format)
-	}
-	else if( src_format.pixelformat == V4L2_PIX_FMT_RGB565X
-	) {
-		CONVERT_PIXEL(RGB565X,input_buffer,output_buffer,src_format)
-	}
-	else if( src_format.pixelformat == V4L2_PIX_FMT_BGR24 ) {
-		CONVERT_PIXEL(BGR24,input_buffer,output_buffer,src_format)
-	}
-	else if( src_format.pixelformat == V4L2_PIX_FMT_RGB24 ) {
-		CONVERT_PIXEL(RGB24,input_buffer,output_buffer,src_format)
-	}
-	else if( src_format.pixelformat == V4L2_PIX_FMT_BGR666 ) {
-		CONVERT_PIXEL(BGR666,input_buffer,output_buffer,src_format)
-	}
-	else if(
-			src_format.pixelformat == V4L2_PIX_FMT_ABGR32
-			|| src_format.pixelformat == V4L2_PIX_FMT_XBGR32
-	) {
-		CONVERT_PIXEL(XBGR32,input_buffer,output_buffer,src_format)
-	}
-	else if(
-			src_format.pixelformat == V4L2_PIX_FMT_ARGB32
-			|| src_format.pixelformat == V4L2_PIX_FMT_XRGB32
-	) {
-		CONVERT_PIXEL(XRGB32,input_buffer,output_buffer,src_format)
-	}
-	else if(
-			/* 16 YUV 4:2:2*/
-			src_format.pixelformat == V4L2_PIX_FMT_YUYV
-	) {
-		// 4 bytes is 2 pixels (side by side):
-		// with same U,V
-		// but Y0/Y1 for left/right pixel
-		//
-		// | Y0 | U | Y1 | U |
-		//
-		// =>
-		//
-		// |Pixel 0|Pixel 1|
-		// |Y0,U,V |Y1,U,V |
-		for( uint y_pos=0; y_pos<src_format.height; y_pos++ ) {
-		for( uint x_pos=0; x_pos<src_format.width/2; x_pos++ ) {
-			const byte_t* read_pos = &input_buffer[
-				y_pos*src_format.bytesperline
-				+ x_pos*4
-			];
-			const uint write_pos = (
-				(y_pos*src_format.width + x_pos*2) * 3
-				);
-			// transform:
-			float y0 = read_pos[0];
-			float u = read_pos[1];
-			float y1 = read_pos[2];
-			float v = read_pos[3];
-			u -= 128;
-			v -= 128;
-			/*
-			y0 -= 16;
-			y1 -= 16;
-			*/
-			// left pixel:
-			const float left_r = 1*y0 + 0*u + 1.402*v;
-			const float left_g = 1*y0 - 0.344136*u - 0.714136*v;
-			const float left_b = 1*y0 + 1.772*u + 0*v;
-			// right pixel:
-			const float right_r = 1*y1 + 0*u + 1.402*v;
-			const float right_g = 1*y1 - 0.344136*u - 0.714136*v;
-			const float right_b = 1*y1 + 1.772*u + 0*v;
-			// write:
-			output_buffer[write_pos+0] = clamp( left_r, 0,255.0 );
-			output_buffer[write_pos+1] = clamp( left_g, 0,255.0 );
-			output_buffer[write_pos+2] = clamp( left_b, 0,255.0 );
-			output_buffer[write_pos+3] = clamp( right_r, 0,255.0 );
-			output_buffer[write_pos+4] = clamp( right_g, 0,255.0 );
-			output_buffer[write_pos+5] = clamp( right_b, 0,255.0 );
-		}
-		}
+	if( -1 ==fclose( fd ) ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
+		return RET_FAILURE;
 	}
 	return RET_SUCCESS;
 }
 
-ret_t image_diff(
-		const img_format_t src_format,
-		const void* src_buffer_1,
-		const void* src_buffer_2,
-		float* result
+ret_t image_save_pgm_to_ram(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		const uint width,
+		const uint height,
+		FILE* file
 )
 {
-	if( src_format.pixelformat != V4L2_PIX_FMT_YUYV ) {
-		log_error( "format not supported\n" );
+	const size_t frame_size = image_output_size( OUTPUT_FORMAT_GRAY, width, height );
+	if( !(buffer_size >= frame_size) ) {
+		log_error( "buffer size too small!\n" );
+		return RET_FAILURE;
+	}
+	fprintf( file, "P5\n" );
+	if( comment != NULL ) {
+		fprintf( file, "#%s\n", comment );
+	}
+	fprintf( file, "%u %u 255\n",
+			width,
+			height
+	);
+	if( frame_size != fwrite( buffer, 1, frame_size, file ) ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
 		return RET_FAILURE;
 	}
-	(*result) = 0;
-	for( uint x_pos=0; x_pos<src_format.width; ++x_pos ) {
-	for( uint y_pos=0; y_pos<src_format.height; ++y_pos ) {
-		const byte_t* read_pos_1 = &CAST_TO_BYTE_PTR(src_buffer_1)[
-			y_pos*src_format.bytesperline
-				+ x_pos*4
-		];
-		const byte_t* read_pos_2 = &CAST_TO_BYTE_PTR(src_buffer_2)[
-			y_pos*src_format.bytesperline
-				+ x_pos*4
-		];
-		// transform:
-		const byte_t y0_1 = read_pos_1[0];
-		// const byte_t u_1 = read_pos_1[1];
-		const byte_t y1_1 = read_pos_1[2];
-		// const byte_t v_1 = read_pos_1[3];
-
-		const byte_t y0_2 = read_pos_2[0];
-		// const byte_t u_2 = read_pos_2[1];
-		const byte_t y1_2 = read_pos_2[2];
-		// const byte_t v_2 = read_pos_2[3];
-
-		// simply use brightness information only:
-		(*result) += ((
-				abs(y0_1 - y0_2)
-		) / 256.0 / (src_format.width*src_format.height));
-		(*result) += ((
-				abs(y1_1 - y1_2)
-		) / 256.0 / (src_format.width*src_format.height));
-	}}
 	return RET_SUCCESS;
 }
 
-size_t image_rgb_size(
+ret_t image_save_y4m(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
 		const uint width,
 		const uint height
 )
 {
-	return width * height * 3;
-}
-
-/************************
- * private utils impl
-*************************/
-
-uint format_pixel_size(img_format_t format) {
-	if( format.pixelformat == V4L2_PIX_FMT_RGB332 )
-		return GET_SIZE( RGB332 );
-	else if( format.pixelformat == V4L2_PIX_FMT_ARGB444 || format.pixelformat == V4L2_PIX_FMT_XRGB444 )
-		return GET_SIZE( XRGB444 );
-	else if( format.pixelformat == V4L2_PIX_FMT_ARGB555 || format.pixelformat == V4L2_PIX_FMT_XRGB555 )
-		return GET_SIZE( XRGB555 );
-	else if( format.pixelformat == V4L2_PIX_FMT_RGB565 )
-		return GET_SIZE( RGB565 );
-	else if( format.pixelformat == V4L2_PIX_FMT_ARGB555X || format.pixelformat == V4L2_PIX_FMT_XRGB555X )
-		return GET_SIZE( XRGB555X );
-	else if( format.pixelformat == V4L2_PIX_FMT_RGB565X )
-		return GET_SIZE( RGB565X );
-	else if( format.pixelformat == V4L2_PIX_FMT_BGR24 )
-		return GET_SIZE( BGR24 );
-	else if( format.pixelformat == V4L2_PIX_FMT_RGB24 )
-		return GET_SIZE( RGB24 );
-	else if( format.pixelformat == V4L2_PIX_FMT_BGR666 )
-		return GET_SIZE( BGR666 );
-	else if( format.pixelformat == V4L2_PIX_FMT_ABGR32 || format.pixelformat == V4L2_PIX_FMT_XBGR32 )
-		return GET_SIZE( XBGR32 );
-	else if( format.pixelformat == V4L2_PIX_FMT_ARGB32 || format.pixelformat == V4L2_PIX_FMT_XRGB32 )
-		return GET_SIZE( XRGB32 );
-	else if( format.pixelformat == V4L2_PIX_FMT_YUYV )
-		return GET_SIZE( YUYV );
-	return 0;
-}
-
-ret_t check_format(
-		const img_format_t format
-) {
-	if( !(
-			format.pixelformat == V4L2_PIX_FMT_RGB332
-			|| format.pixelformat == V4L2_PIX_FMT_ARGB444 || format.pixelformat == V4L2_PIX_FMT_XRGB444
-			|| format.pixelformat == V4L2_PIX_FMT_ARGB555 || format.pixelformat == V4L2_PIX_FMT_XRGB555
-			|| format.pixelformat == V4L2_PIX_FMT_RGB565
-			|| format.pixelformat == V4L2_PIX_FMT_ARGB555X || format.pixelformat == V4L2_PIX_FMT_XRGB555X
-			|| format.pixelformat == V4L2_PIX_FMT_RGB565X
-			|| format.pixelformat == V4L2_PIX_FMT_BGR24
-			|| format.pixelformat == V4L2_PIX_FMT_RGB24
-			|| format.pixelformat == V4L2_PIX_FMT_BGR666
-			|| format.pixelformat == V4L2_PIX_FMT_ABGR32 || format.pixelformat == V4L2_PIX_FMT_XBGR32
-			|| format.pixelformat == V4L2_PIX_FMT_ARGB32 || format.pixelformat == V4L2_PIX_FMT_XRGB32
-			|| format.pixelformat == V4L2_PIX_FMT_YUYV
-	) ) {
-		log_error( "format not supported\n" );
+	if( !(buffer_size >= image_yuv420_size(width,height)) ) {
+		log_error( "buffer size too small!\n" );
 		return RET_FAILURE;
 	}
-	if(
-			!( format.bytesperline * format.height <= format.sizeimage )
-	) {
-		log_error( "condition not fulfilled: (format.bytesperline * format.height <= format.sizeimage)\n" );
+	FILE* fd = fopen( filename, "w+" );
+	if( fd == NULL ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
 		return RET_FAILURE;
 	}
-	if(
-			!( format.width*format_pixel_size(format) <= format.bytesperline )
-	) {
-		log_error( "condition not fulfilled: (format.width*format_pixel_size(format) <= format.bytesperline)\n" );
+	if( RET_SUCCESS != image_save_y4m_to_ram(
+				filename,
+				comment,
+				buffer,
+				buffer_size,
+				width, height,
+				fd
+	)) {
+		fclose( fd );
 		return RET_FAILURE;
 	}
-	/*
-	if( format.xfer_func != V4L2_XFER_FUNC_DEFAULT ) {
-		log_error( "xfer_func: non-standard color transfer functions not supported\n" );
+	if( -1 ==fclose( fd ) ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
 		return RET_FAILURE;
 	}
-	if( format.ycbcr_enc != V4L2_YCBCR_ENC_DEFAULT ) {
-		log_error( "ycbcr_enc: non-standard color encodings not supported\n" );
+	return RET_SUCCESS;
+}
+
+ret_t image_save_y4m_to_ram(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		const uint width,
+		const uint height,
+		FILE* file
+)
+{
+	const size_t frame_size = image_yuv420_size( width, height );
+	if( !(buffer_size >= frame_size) ) {
+		log_error( "buffer size too small!\n" );
 		return RET_FAILURE;
 	}
-	if( format.quantization != V4L2_QUANTIZATION_DEFAULT ) {
-		log_error( "quantization: non-standard color quantizations not supported\n" );
+	// samples are interpreted as full range
+	// (as in `image_convert_to_rgb`),
+	// so mark the stream accordingly:
+	fprintf( file, "YUV4MPEG2 W%u H%u F1:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL",
+			width,
+			height
+	);
+	if( comment != NULL ) {
+		fprintf( file, " XCOMMENT=%s", comment );
+	}
+	fprintf( file, "\nFRAME\n" );
+	if( frame_size != fwrite( buffer, 1, frame_size, file ) ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
 		return RET_FAILURE;
 	}
-	*/
 	return RET_SUCCESS;
 }
 
+ret_t image_file_header(
+		const output_format_t format,
+		const uint width,
+		const uint height,
+		char* prefix,
+		const size_t prefix_max_size,
+		char* suffix,
+		const size_t suffix_max_size
+)
+{
+	int prefix_size = -1;
+	int suffix_size = -1;
+	switch( format ) {
+		case OUTPUT_FORMAT_RGB:
+		case OUTPUT_FORMAT_GRAY:
+			prefix_size = snprintf( prefix, prefix_max_size, "%s\n#",
+					(format == OUTPUT_FORMAT_GRAY) ? "P5" : "P6"
+			);
+			suffix_size = snprintf( suffix, suffix_max_size, "\n%u %u 255\n",
+					width,
+					height
+			);
+		break;
+		case OUTPUT_FORMAT_YUV420:
+			prefix_size = snprintf( prefix, prefix_max_size, "YUV4MPEG2 W%u H%u F1:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL XCOMMENT=",
+					width,
+					height
+			);
+			suffix_size = snprintf( suffix, suffix_max_size, "\nFRAME\n" );
+		break;
+		case OUTPUT_FORMAT_JPEG:
+			log_error( "jpeg: header depends on the frame\n" );
+			return RET_FAILURE;
+	}
+	if(
+			prefix_size < 0 || (size_t )prefix_size >= prefix_max_size
+			|| suffix_size < 0 || (size_t )suffix_size >= suffix_max_size
+	) {
+		log_error( "header buffer too small!\n" );
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
+ret_t image_save_jpeg(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size
+)
+{
+	FILE* fd = fopen( filename, "w+" );
+	if( fd == NULL ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
+		return RET_FAILURE;
+	}
+	if( RET_SUCCESS != image_save_jpeg_to_ram(
+				filename,
+				comment,
+				buffer,
+				buffer_size,
+				fd
+	)) {
+		fclose( fd );
+		return RET_FAILURE;
+	}
+	if( -1 ==fclose( fd ) ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
+ret_t image_save_jpeg_to_ram(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		FILE* file
+)
+{
+	byte_t header[IMAGE_JPEG_HEADER_MAX_SIZE];
+	size_t header_size = 0;
+	if( RET_SUCCESS != image_jpeg_header(
+				buffer, buffer_size,
+				comment,
+				header, sizeof(header),
+				&header_size
+	) ) {
+		return RET_FAILURE;
+	}
+	const size_t data_size = buffer_size - 2;
+	if(
+			header_size != fwrite( header, 1, header_size, file )
+			|| data_size != fwrite( CAST_TO_BYTE_PTR(buffer) + 2, 1, data_size, file )
+	) {
+		log_error("'%s': %s\n", filename, strerror(errno));
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
+
+ret_t image_jpeg_header(
+		const void* buffer,
+		const size_t buffer_size,
+		const char* comment,
+		byte_t* header,
+		const size_t header_max_size,
+		size_t* header_size
+)
+{
+	const byte_t* src = CAST_TO_BYTE_PTR( buffer );
+	if( buffer_size < 4 || src[0] != 0xff || src[1] != 0xd8 ) {
+		log_error( "jpeg: missing SOI marker\n" );
+		return RET_FAILURE;
+	}
+	bool has_huffman_tables = false;
+	if( RET_SUCCESS != jpeg_has_huffman_tables( src, buffer_size, &has_huffman_tables ) ) {
+		return RET_FAILURE;
+	}
+	const size_t comment_size = (comment != NULL) ? strlen( comment ) : 0;
+	if( 2 + (comment != NULL ? 4 + comment_size : 0) > header_max_size ) {
+		log_error( "jpeg: header buffer too small\n" );
+		return RET_FAILURE;
+	}
+	size_t pos = 0;
+	header[pos++] = 0xff;
+	header[pos++] = 0xd8;
+	if( comment != NULL ) {
+		// (the length includes itself)
+		const size_t length = 2 + comment_size;
+		header[pos++] = 0xff;
+		header[pos++] = 0xfe;
+		header[pos++] = length >> 8;
+		header[pos++] = length & 0xff;
+		memcpy( &header[pos], comment, comment_size );
+		pos += comment_size;
+	}
+	if( !has_huffman_tables ) {
+		size_t tables_size = 0;
+		if( RET_SUCCESS != jpeg_std_huffman_tables(
+					&header[pos], header_max_size - pos,
+					&tables_size
+		) ) {
+			return RET_FAILURE;
+		}
+		pos += tables_size;
+	}
+	(*header_size) = pos;
+	return RET_SUCCESS;
+}
+
+ret_t image_convert(
+		const img_format_t src_format,
+		const output_format_t dst_format,
+		const void* src_buffer,
+		const size_t src_size,
+		const void* dst_buffer,
+		const size_t dst_size
+)
+{
+	image_converter_t converter;
+	if( RET_SUCCESS != image_converter_init( &converter, src_format, dst_format ) ) {
+		return RET_FAILURE;
+	}
+	return image_converter_run( &converter, src_buffer, src_size, dst_buffer, dst_size );
+}
+
+size_t image_converted_size(
+		const img_format_t src_format,
+		const output_format_t dst_format,
+		const size_t src_size
+)
+{
+	if( dst_format == OUTPUT_FORMAT_JPEG ) {
+		return src_size;
+	}
+	return image_output_size( dst_format, src_format.width, src_format.height );
+}
+
+ret_t image_converter_init(
+		image_converter_t* converter,
+		const img_format_t src_format,
+		const output_format_t dst_format
+)
+{
+	(*converter) = (image_converter_t){
+		.src_format = src_format,
+		.dst_format = dst_format,
+		.dst_width = src_format.width,
+		.dst_height = src_format.height,
+		// (jpeg frames have variable size):
+		.dst_size = (dst_format == OUTPUT_FORMAT_JPEG)
+			? 0
+			: image_output_size( dst_format, src_format.width, src_format.height ),
+		.convert = NULL,
+		.scratch = NULL,
+		.scratch_size = 0,
+	};
+	// (compressed frames have no fixed layout)
+	if(
+			src_format.pixelformat != V4L2_PIX_FMT_MJPEG
+			&& RET_SUCCESS != check_format( src_format )
+	) {
+		return RET_FAILURE;
+	}
+	for( uint i=0; i<sizeof(convert_kernels)/sizeof(convert_kernels[0]); i++ ) {
+		if(
+				convert_kernels[i].pixelformat == src_format.pixelformat
+				&& convert_kernels[i].dst_format == dst_format
+		) {
+			converter->convert = convert_kernels[i].convert;
+			if( convert_kernels[i].prepare != NULL ) {
+				convert_kernels[i].prepare();
+			}
+			return RET_SUCCESS;
+		}
+	}
+	if( dst_format == OUTPUT_FORMAT_JPEG ) {
+		log_error( "jpeg output requires MJPEG input\n" );
+	}
+	else {
+		log_error( "format not supported\n" );
+	}
+	return RET_FAILURE;
+}
+
+ret_t image_converter_run(
+		const image_converter_t* converter,
+		const void* src_buffer,
+		const size_t src_size,
+		const void* dst_buffer,
+		const size_t dst_size
+)
+{
+	if( dst_size < converter->dst_size ) {
+		log_error( "buffer size does not correspond to format size\n" );
+		return RET_FAILURE;
+	}
+	if( converter->scratch == NULL ) {
+		return converter->convert(
+				converter,
+				CAST_TO_BYTE_PTR( src_buffer ), src_size,
+				CAST_TO_BYTE_PTR( dst_buffer ), dst_size
+		);
+	}
+	if( RET_SUCCESS != converter->convert(
+			converter,
+			CAST_TO_BYTE_PTR( src_buffer ), src_size,
+			converter->scratch, converter->scratch_size
+	) ) {
+		return RET_FAILURE;
+	}
+	return image_resize(
+			converter->dst_format,
+			converter->src_format.width, converter->src_format.height,
+			converter->scratch, converter->scratch_size,
+			converter->dst_width, converter->dst_height,
+			dst_buffer, dst_size
+	);
+}
+
+ret_t image_converter_set_output_size(
+		image_converter_t* converter,
+		const uint width,
+		const uint height
+)
+{
+	const img_format_t* src_format = &converter->src_format;
+	if( width == src_format->width && height == src_format->height ) {
+		return RET_SUCCESS;
+	}
+	if(
+			width == 0 || height == 0
+			|| width > src_format->width || height > src_format->height
+	) {
+		log_error( "resize: %ux%u is not a downscaling of %ux%u\n",
+				width, height,
+				src_format->width, src_format->height
+		);
+		return RET_FAILURE;
+	}
+	if( converter->dst_format == OUTPUT_FORMAT_JPEG ) {
+		log_error( "resize: jpeg frames are not decoded\n" );
+		return RET_FAILURE;
+	}
+	FREE( converter->scratch );
+	converter->scratch_size = converter->dst_size;
+	CALLOC( converter->scratch, converter->scratch_size, 1 );
+	converter->dst_width = width;
+	converter->dst_height = height;
+	converter->dst_size = image_output_size( converter->dst_format, width, height );
+	return RET_SUCCESS;
+}
+
+void image_converter_exit(
+		image_converter_t* converter
+)
+{
+	FREE( converter->scratch );
+	converter->scratch_size = 0;
+}
+
+ret_t image_resize(
+		const output_format_t format,
+		const uint src_width,
+		const uint src_height,
+		const void* src_buffer,
+		const size_t src_size,
+		const uint dst_width,
+		const uint dst_height,
+		const void* dst_buffer,
+		const size_t dst_size
+)
+{
+	if(
+			src_size < image_output_size( format, src_width, src_height )
+			|| dst_size < image_output_size( format, dst_width, dst_height )
+	) {
+		log_error( "buffer size does not correspond to format size\n" );
+		return RET_FAILURE;
+	}
+	const byte_t* src = CAST_TO_BYTE_PTR( src_buffer );
+	byte_t* dst = CAST_TO_BYTE_PTR( dst_buffer );
+	switch( format ) {
+		case OUTPUT_FORMAT_RGB:
+			resize_plane( src, src_width, src_height, 3, dst, dst_width, dst_height );
+			return RET_SUCCESS;
+		case OUTPUT_FORMAT_GRAY:
+			resize_plane( src, src_width, src_height, 1, dst, dst_width, dst_height );
+			return RET_SUCCESS;
+		case OUTPUT_FORMAT_YUV420:
+		{
+			const uint src_chroma_width = (src_width+1)/2;
+			const uint src_chroma_height = (src_height+1)/2;
+			const uint dst_chroma_width = (dst_width+1)/2;
+			const uint dst_chroma_height = (dst_height+1)/2;
+			const size_t src_chroma_size = src_chroma_width * src_chroma_height;
+			const size_t dst_chroma_size = dst_chroma_width * dst_chroma_height;
+			resize_plane( src, src_width, src_height, 1, dst, dst_width, dst_height );
+			src += src_width * src_height;
+			dst += dst_width * dst_height;
+			for( uint plane=0; plane<2; plane++ ) {
+				resize_plane(
+						&src[plane * src_chroma_size], src_chroma_width, src_chroma_height, 1,
+						&dst[plane * dst_chroma_size], dst_chroma_width, dst_chroma_height
+				);
+			}
+			return RET_SUCCESS;
+		}
+		case OUTPUT_FORMAT_JPEG:
+		break;
+	}
+	log_error( "resize: format not supported\n" );
+	return RET_FAILURE;
+}
+
+ret_t image_convert_to_rgb(
+		const img_format_t src_format,
+		const void* src_buffer,
+		const void* dst_buffer,
+		const size_t dst_size
+)
+{
+	return image_convert(
+			src_format,
+			OUTPUT_FORMAT_RGB,
+			src_buffer, src_format.sizeimage,
+			dst_buffer, dst_size
+	);
+}
+
+ret_t image_convert_to_yuv420(
+		const img_format_t src_format,
+		const void* src_buffer,
+		const void* dst_buffer,
+		const size_t dst_size
+)
+{
+	return image_convert(
+			src_format,
+			OUTPUT_FORMAT_YUV420,
+			src_buffer, src_format.sizeimage,
+			dst_buffer, dst_size
+	);
+}
+
+ret_t image_yuv420_to_rgb(
+		const uint width,
+		const uint height,
+		const void* src_buffer,
+		const size_t src_size,
+		const void* dst_buffer,
+		const size_t dst_size
+)
+{
+	if( src_size < image_yuv420_size( width, height ) ) {
+		log_error( "buffer size does not correspond to format size\n" );
+		return RET_FAILURE;
+	}
+	if( dst_size < image_rgb_size( width, height ) ) {
+		log_error( "buffer size does not correspond to format size\n" );
+		return RET_FAILURE;
+	}
+	const byte_t* input_y = CAST_TO_BYTE_PTR( src_buffer );
+	const uint chroma_width = (width+1)/2;
+	const uint chroma_height = (height+1)/2;
+	const byte_t* input_u = &input_y[width * height];
+	const byte_t* input_v = &input_u[chroma_width * chroma_height];
+	byte_t* output_buffer = CAST_TO_BYTE_PTR( dst_buffer );
+	// same transformation as for YUYV:
+	for( uint y_pos=0; y_pos<height; y_pos++ ) {
+	for( uint x_pos=0; x_pos<width; x_pos++ ) {
+		const float y = input_y[y_pos*width + x_pos];
+		const float u = (float )input_u[(y_pos/2)*chroma_width + x_pos/2] - 128;
+		const float v = (float )input_v[(y_pos/2)*chroma_width + x_pos/2] - 128;
+		const uint write_pos = (y_pos*width + x_pos) * 3;
+		output_buffer[write_pos+0] = clamp( 1*y + 0*u + 1.402*v, 0, 255.0 );
+		output_buffer[write_pos+1] = clamp( 1*y - 0.344136*u - 0.714136*v, 0, 255.0 );
+		output_buffer[write_pos+2] = clamp( 1*y + 1.772*u + 0*v, 0, 255.0 );
+	}
+	}
+	return RET_SUCCESS;
+}
+
+ret_t image_jpeg_decode(
+		const img_format_t src_format,
+		const output_format_t dst_format,
+		const void* src_buffer,
+		const size_t src_size,
+		const void* dst_buffer,
+		const size_t dst_size
+)
+{
+	if( dst_size < image_output_size( dst_format, src_format.width, src_format.height ) ) {
+		log_error( "buffer size does not correspond to format size\n" );
+		return RET_FAILURE;
+	}
+	struct jpeg_decompress_struct cinfo;
+	jpeg_error_t error;
+	cinfo.err = jpeg_std_error( &error.mgr );
+	error.mgr.error_exit = jpeg_error_exit;
+	if( setjmp( error.jump ) ) {
+		jpeg_destroy_decompress( &cinfo );
+		return RET_FAILURE;
+	}
+	jpeg_create_decompress( &cinfo );
+	if( RET_SUCCESS != jpeg_start(
+				&cinfo,
+				src_buffer, src_size,
+				jpeg_color_space( dst_format ),
+				1
+	) ) {
+		jpeg_destroy_decompress( &cinfo );
+		return RET_FAILURE;
+	}
+	if(
+			cinfo.output_width != src_format.width
+			|| cinfo.output_height != src_format.height
+	) {
+		log_error( "jpeg: frame size %ux%u, expected %ux%u\n",
+				cinfo.output_width, cinfo.output_height,
+				src_format.width, src_format.height
+		);
+		jpeg_destroy_decompress( &cinfo );
+		return RET_FAILURE;
+	}
+	ret_t ret = RET_FAILURE;
+	switch( dst_format ) {
+		case OUTPUT_FORMAT_RGB:
+		case OUTPUT_FORMAT_GRAY:
+			ret = jpeg_decode_rgb( &cinfo, CAST_TO_BYTE_PTR( dst_buffer ) );
+		break;
+		case OUTPUT_FORMAT_YUV420:
+			ret = jpeg_decode_yuv420( &cinfo, CAST_TO_BYTE_PTR( dst_buffer ) );
+		break;
+		case OUTPUT_FORMAT_JPEG:
+			log_error( "output format not supported\n" );
+		break;
+	}
+	if( ret == RET_SUCCESS ) {
+		jpeg_finish_decompress( &cinfo );
+	}
+	jpeg_destroy_decompress( &cinfo );
+	return ret;
+}
+
+ret_t image_diff(
+		const img_format_t src_format,
+		const void* src_buffer_1,
+		const void* src_buffer_2,
+		float* result
+)
+{
+	// simply use brightness information only:
+	uint64_t sum = 0;
+	if( src_format.pixelformat == V4L2_PIX_FMT_YUYV ) {
+		for( uint y_pos=0; y_pos<src_format.height; ++y_pos ) {
+			sum += diff_row_yuyv(
+					&CAST_TO_BYTE_PTR(src_buffer_1)[y_pos*src_format.bytesperline],
+					&CAST_TO_BYTE_PTR(src_buffer_2)[y_pos*src_format.bytesperline],
+					src_format.width
+			);
+		}
+	}
+	else if( format_is_planar( src_format ) ) {
+		// (the luma plane comes first)
+		for( uint y_pos=0; y_pos<src_format.height; ++y_pos ) {
+			sum += diff_row(
+					&CAST_TO_BYTE_PTR(src_buffer_1)[y_pos*src_format.bytesperline],
+					&CAST_TO_BYTE_PTR(src_buffer_2)[y_pos*src_format.bytesperline],
+					src_format.width
+			);
+		}
+	}
+	else {
+		log_error( "format not supported\n" );
+		return RET_FAILURE;
+	}
+	(*result) = sum / 256.0 / (src_format.width*src_format.height);
+	return RET_SUCCESS;
+}
+
+void image_luma_init(
+		image_luma_t* luma,
+		const uint width,
+		const uint height
+)
+{
+	luma->width = 0;
+	luma->height = 0;
+	luma->max_size = ((width+7)/8) * ((height+7)/8);
+	luma->data = NULL;
+	CALLOC( luma->data, luma->max_size, sizeof(byte_t) );
+}
+
+void image_luma_exit(
+		image_luma_t* luma
+)
+{
+	FREE( luma->data );
+	luma->max_size = 0;
+}
+
+ret_t image_jpeg_luma(
+		const void* src_buffer,
+		const size_t src_size,
+		image_luma_t* luma
+)
+{
+	struct jpeg_decompress_struct cinfo;
+	jpeg_error_t error;
+	cinfo.err = jpeg_std_error( &error.mgr );
+	error.mgr.error_exit = jpeg_error_exit;
+	if( setjmp( error.jump ) ) {
+		jpeg_destroy_decompress( &cinfo );
+		return RET_FAILURE;
+	}
+	jpeg_create_decompress( &cinfo );
+	// at 1/8 scale every 8x8 block is
+	// one pixel: its DC coefficient
+	if( RET_SUCCESS != jpeg_start(
+				&cinfo,
+				src_buffer, src_size,
+				JCS_GRAYSCALE,
+				8
+	) ) {
+		jpeg_destroy_decompress( &cinfo );
+		return RET_FAILURE;
+	}
+	if( (size_t )cinfo.output_width * cinfo.output_height > luma->max_size ) {
+		log_error( "jpeg: frame larger than expected\n" );
+		jpeg_destroy_decompress( &cinfo );
+		return RET_FAILURE;
+	}
+	luma->width = cinfo.output_width;
+	luma->height = cinfo.output_height;
+	while( cinfo.output_scanline < cinfo.output_height ) {
+		JSAMPROW row = &luma->data[cinfo.output_scanline * luma->width];
+		jpeg_read_scanlines( &cinfo, &row, 1 );
+	}
+	jpeg_finish_decompress( &cinfo );
+	jpeg_destroy_decompress( &cinfo );
+	return RET_SUCCESS;
+}
+
+ret_t image_luma_diff(
+		const image_luma_t* luma_1,
+		const image_luma_t* luma_2,
+		float* result
+)
+{
+	if(
+			luma_1->width != luma_2->width
+			|| luma_1->height != luma_2->height
+	) {
+		log_error( "luma: frame sizes differ\n" );
+		return RET_FAILURE;
+	}
+	const size_t size = (size_t )luma_1->width * luma_1->height;
+	uint64_t sum = 0;
+	for( size_t i=0; i<size; i++ ) {
+		sum += abs( luma_1->data[i] - luma_2->data[i] );
+	}
+	(*result) = (size > 0) ? (sum / 256.0 / size) : 0;
+	return RET_SUCCESS;
+}
+
+size_t image_rgb_size(
+		const uint width,
+		const uint height
+)
+{
+	return width * height * 3;
+}
+
+size_t image_yuv420_size(
+		const uint width,
+		const uint height
+)
+{
+	return width * height
+		+ 2 * ((width+1)/2) * ((height+1)/2);
+}
+
+size_t image_output_size(
+		const output_format_t format,
+		const uint width,
+		const uint height
+)
+{
+	switch( format ) {
+		case OUTPUT_FORMAT_RGB:
+			return image_rgb_size( width, height );
+		case OUTPUT_FORMAT_YUV420:
+			return image_yuv420_size( width, height );
+		case OUTPUT_FORMAT_JPEG:
+			// (compressed frames should be much smaller)
+			return image_rgb_size( width, height );
+		case OUTPUT_FORMAT_GRAY:
+			return width * height;
+	}
+	return 0;
+}
+
+const char* image_output_format_str(
+		const output_format_t format
+)
+{
+	switch( format ) {
+		case OUTPUT_FORMAT_RGB:
+			return "rgb";
+		case OUTPUT_FORMAT_YUV420:
+			return "yuv420";
+		case OUTPUT_FORMAT_JPEG:
+			return "jpeg";
+		case OUTPUT_FORMAT_GRAY:
+			return "gray";
+	}
+	return "???";
+}
+
+const char* image_pixel_format_str(
+		const __u32 pixel_format
+)
+{
+	switch( pixel_format ) {
+		case V4L2_PIX_FMT_YUYV:
+			return "yuyv";
+		case V4L2_PIX_FMT_MJPEG:
+			return "mjpeg";
+		case V4L2_PIX_FMT_NV12:
+			return "nv12";
+		case V4L2_PIX_FMT_YUV420:
+			return "yu12";
+		case V4L2_PIX_FMT_GREY:
+			return "grey";
+	}
+	return "???";
+}
+
+__u32 image_pixel_format_from_str(
+		const char* str
+)
+{
+	if( !strcmp( "yuyv", str ) ) {
+		return V4L2_PIX_FMT_YUYV;
+	}
+	if( !strcmp( "mjpeg", str ) ) {
+		return V4L2_PIX_FMT_MJPEG;
+	}
+	if( !strcmp( "nv12", str ) ) {
+		return V4L2_PIX_FMT_NV12;
+	}
+	if( !strcmp( "yu12", str ) ) {
+		return V4L2_PIX_FMT_YUV420;
+	}
+	if( !strcmp( "grey", str ) ) {
+		return V4L2_PIX_FMT_GREY;
+	}
+	return 0;
+}
+
+/************************
+ * private utils impl
+*************************/
+
+void jpeg_error_exit(
+		j_common_ptr cinfo
+)
+{
+	jpeg_error_t* error = (jpeg_error_t* )cinfo->err;
+	char msg[JMSG_LENGTH_MAX];
+	(*cinfo->err->format_message)( cinfo, msg );
+	log_error( "jpeg: %s\n", msg );
+	longjmp( error->jump, 1 );
+}
+
+ret_t jpeg_start(
+		struct jpeg_decompress_struct* cinfo,
+		const void* src_buffer,
+		const size_t src_size,
+		const J_COLOR_SPACE color_space,
+		const uint scale_denom
+)
+{
+	jpeg_mem_src( cinfo, (const unsigned char* )src_buffer, src_size );
+	if( JPEG_HEADER_OK != jpeg_read_header( cinfo, TRUE ) ) {
+		log_error( "jpeg: invalid header\n" );
+		return RET_FAILURE;
+	}
+	cinfo->out_color_space = color_space;
+	cinfo->scale_num = 1;
+	cinfo->scale_denom = scale_denom;
+	cinfo->dct_method = JDCT_ISLOW;
+	jpeg_start_decompress( cinfo );
+	return RET_SUCCESS;
+}
+
+J_COLOR_SPACE jpeg_color_space(
+		const output_format_t format
+)
+{
+	switch( format ) {
+		case OUTPUT_FORMAT_RGB:
+			return JCS_RGB;
+		case OUTPUT_FORMAT_GRAY:
+			return JCS_GRAYSCALE;
+		case OUTPUT_FORMAT_YUV420:
+		case OUTPUT_FORMAT_JPEG:
+		break;
+	}
+	return JCS_YCbCr;
+}
+
+ret_t jpeg_decode_rgb(
+		struct jpeg_decompress_struct* cinfo,
+		byte_t* dst
+)
+{
+	const uint stride = cinfo->output_width * cinfo->output_components;
+	while( cinfo->output_scanline < cinfo->output_height ) {
+		JSAMPROW row = &dst[cinfo->output_scanline * stride];
+		jpeg_read_scanlines( cinfo, &row, 1 );
+	}
+	return RET_SUCCESS;
+}
+
+ret_t jpeg_decode_yuv420(
+		struct jpeg_decompress_struct* cinfo,
+		byte_t* dst
+)
+{
+	const uint width = cinfo->output_width;
+	const uint height = cinfo->output_height;
+	const uint chroma_width = (width+1)/2;
+	const uint chroma_height = (height+1)/2;
+	byte_t* output_y = dst;
+	byte_t* output_u = &output_y[width * height];
+	byte_t* output_v = &output_u[chroma_width * chroma_height];
+	// two lines of interleaved Y, Cb, Cr
+	// (freed by 'jpeg_destroy_decompress'):
+	JSAMPARRAY lines = (*cinfo->mem->alloc_sarray)(
+			(j_common_ptr )cinfo, JPOOL_IMAGE,
+			width * 3, 2
+	);
+	// luma is copied, chroma of
+	// 2x2 neighbouring pixels is averaged:
+	for( uint y_pos=0; y_pos<height; y_pos+=2 ) {
+		jpeg_read_scanlines( cinfo, &lines[0], 1 );
+		// odd height: use last line twice
+		const byte_t* line_0 = lines[0];
+		const byte_t* line_1 = line_0;
+		if( y_pos+1 < height ) {
+			jpeg_read_scanlines( cinfo, &lines[1], 1 );
+			line_1 = lines[1];
+		}
+		byte_t* dst_y_0 = &output_y[y_pos*width];
+		byte_t* dst_y_1 = &output_y[(y_pos+1)*width];
+		byte_t* dst_u = &output_u[(y_pos/2)*chroma_width];
+		byte_t* dst_v = &output_v[(y_pos/2)*chroma_width];
+		for( uint x_pos=0; x_pos<width; x_pos++ ) {
+			dst_y_0[x_pos] = line_0[x_pos*3+0];
+			if( line_1 != line_0 ) {
+				dst_y_1[x_pos] = line_1[x_pos*3+0];
+			}
+		}
+		for( uint x_pos=0; x_pos<chroma_width; x_pos++ ) {
+			// odd width: use last column twice
+			const uint x_0 = x_pos*2;
+			const uint x_1 = (x_0+1 < width) ? x_0+1 : x_0;
+			dst_u[x_pos] = (
+					line_0[x_0*3+1] + line_0[x_1*3+1]
+					+ line_1[x_0*3+1] + line_1[x_1*3+1]
+					+ 2
+			) / 4;
+			dst_v[x_pos] = (
+					line_0[x_0*3+2] + line_0[x_1*3+2]
+					+ line_1[x_0*3+2] + line_1[x_1*3+2]
+					+ 2
+			) / 4;
+		}
+	}
+	return RET_SUCCESS;
+}
+
+ret_t jpeg_has_huffman_tables(
+		const byte_t* buffer,
+		const size_t buffer_size,
+		bool* result
+)
+{
+	// segments: 0xff, marker, 16 bit length (including itself).
+	// any number of 0xff may precede a marker:
+	size_t pos = 2;
+	while( true ) {
+		while( pos+1 < buffer_size && buffer[pos] == 0xff && buffer[pos+1] == 0xff ) {
+			pos++;
+		}
+		if( pos + 4 > buffer_size || buffer[pos] != 0xff ) {
+			log_error( "jpeg: invalid marker at offset %zu\n", pos );
+			return RET_FAILURE;
+		}
+		const byte_t marker = buffer[pos+1];
+		if( marker == 0xc4 ) { // DHT
+			(*result) = true;
+			return RET_SUCCESS;
+		}
+		if( marker == 0xda ) { // SOS
+			(*result) = false;
+			return RET_SUCCESS;
+		}
+		pos += 2 + ((buffer[pos+2] << 8) | buffer[pos+3]);
+	}
+}
+
+ret_t jpeg_std_huffman_tables(
+		byte_t* dst,
+		const size_t dst_max_size,
+		size_t* size
+)
+{
+	if( dst_max_size < 4 ) {
+		log_error( "jpeg: header buffer too small\n" );
+		return RET_FAILURE;
+	}
+	// let libjpeg fill in its default tables:
+	struct jpeg_compress_struct cinfo;
+	jpeg_error_t error;
+	cinfo.err = jpeg_std_error( &error.mgr );
+	error.mgr.error_exit = jpeg_error_exit;
+	if( setjmp( error.jump ) ) {
+		jpeg_destroy_compress( &cinfo );
+		return RET_FAILURE;
+	}
+	jpeg_create_compress( &cinfo );
+	cinfo.in_color_space = JCS_YCbCr;
+	cinfo.input_components = 3;
+	jpeg_set_defaults( &cinfo );
+	// luma DC, luma AC, chroma DC, chroma AC:
+	const JHUFF_TBL* tables[4] = {
+		cinfo.dc_huff_tbl_ptrs[0], cinfo.ac_huff_tbl_ptrs[0],
+		cinfo.dc_huff_tbl_ptrs[1], cinfo.ac_huff_tbl_ptrs[1],
+	};
+	const byte_t table_ids[4] = { 0x00, 0x10, 0x01, 0x11 };
+	size_t pos = 4;
+	for( uint i=0; i<4; i++ ) {
+		uint value_count = 0;
+		for( uint length=1; length<=16; length++ ) {
+			value_count += tables[i]->bits[length];
+		}
+		if( pos + 17 + value_count > dst_max_size ) {
+			log_error( "jpeg: header buffer too small\n" );
+			jpeg_destroy_compress( &cinfo );
+			return RET_FAILURE;
+		}
+		dst[pos++] = table_ids[i];
+		memcpy( &dst[pos], &tables[i]->bits[1], 16 );
+		pos += 16;
+		memcpy( &dst[pos], tables[i]->huffval, value_count );
+		pos += value_count;
+	}
+	jpeg_destroy_compress( &cinfo );
+	dst[0] = 0xff;
+	dst[1] = 0xc4;
+	dst[2] = (pos - 2) >> 8;
+	dst[3] = (pos - 2) & 0xff;
+	(*size) = pos;
+	return RET_SUCCESS;
+}
+
+uint format_pixel_size(img_format_t format) {
+	if( format.pixelformat == V4L2_PIX_FMT_RGB332 )
+		return GET_SIZE( RGB332 );
+	else if( format.pixelformat == V4L2_PIX_FMT_ARGB444 || format.pixelformat == V4L2_PIX_FMT_XRGB444 )
+		return GET_SIZE( XRGB444 );
+	else if( format.pixelformat == V4L2_PIX_FMT_ARGB555 || format.pixelformat == V4L2_PIX_FMT_XRGB555 )
+		return GET_SIZE( XRGB555 );
+	else if( format.pixelformat == V4L2_PIX_FMT_RGB565 )
+		return GET_SIZE( RGB565 );
+	else if( format.pixelformat == V4L2_PIX_FMT_ARGB555X || format.pixelformat == V4L2_PIX_FMT_XRGB555X )
+		return GET_SIZE( XRGB555X );
+	else if( format.pixelformat == V4L2_PIX_FMT_RGB565X )
+		return GET_SIZE( RGB565X );
+	else if( format.pixelformat == V4L2_PIX_FMT_BGR24 )
+		return GET_SIZE( BGR24 );
+	else if( format.pixelformat == V4L2_PIX_FMT_RGB24 )
+		return GET_SIZE( RGB24 );
+	else if( format.pixelformat == V4L2_PIX_FMT_BGR666 )
+		return GET_SIZE( BGR666 );
+	else if( format.pixelformat == V4L2_PIX_FMT_ABGR32 || format.pixelformat == V4L2_PIX_FMT_XBGR32 )
+		return GET_SIZE( XBGR32 );
+	else if( format.pixelformat == V4L2_PIX_FMT_ARGB32 || format.pixelformat == V4L2_PIX_FMT_XRGB32 )
+		return GET_SIZE( XRGB32 );
+	else if( format.pixelformat == V4L2_PIX_FMT_YUYV )
+		return GET_SIZE( YUYV );
+	else if( format.pixelformat == V4L2_PIX_FMT_GREY )
+		return GET_SIZE( GREY );
+	else if( format.pixelformat == V4L2_PIX_FMT_NV12 )
+		return GET_SIZE( NV12 );
+	else if( format.pixelformat == V4L2_PIX_FMT_YUV420 )
+		return GET_SIZE( YUV420 );
+	return 0;
+}
+
+ret_t check_format(
+		const img_format_t format
+) {
+	if( !(
+			format.pixelformat == V4L2_PIX_FMT_RGB332
+			|| format.pixelformat == V4L2_PIX_FMT_ARGB444 || format.pixelformat == V4L2_PIX_FMT_XRGB444
+			|| format.pixelformat == V4L2_PIX_FMT_ARGB555 || format.pixelformat == V4L2_PIX_FMT_XRGB555
+			|| format.pixelformat == V4L2_PIX_FMT_RGB565
+			|| format.pixelformat == V4L2_PIX_FMT_ARGB555X || format.pixelformat == V4L2_PIX_FMT_XRGB555X
+			|| format.pixelformat == V4L2_PIX_FMT_RGB565X
+			|| format.pixelformat == V4L2_PIX_FMT_BGR24
+			|| format.pixelformat == V4L2_PIX_FMT_RGB24
+			|| format.pixelformat == V4L2_PIX_FMT_BGR666
+			|| format.pixelformat == V4L2_PIX_FMT_ABGR32 || format.pixelformat == V4L2_PIX_FMT_XBGR32
+			|| format.pixelformat == V4L2_PIX_FMT_ARGB32 || format.pixelformat == V4L2_PIX_FMT_XRGB32
+			|| format.pixelformat == V4L2_PIX_FMT_YUYV
+			|| format_is_planar( format )
+	) ) {
+		log_error( "format not supported\n" );
+		return RET_FAILURE;
+	}
+	if(
+			!( format_image_size( format ) <= format.sizeimage )
+	) {
+		log_error( "condition not fulfilled: (format_image_size( format ) <= format.sizeimage)\n" );
+		return RET_FAILURE;
+	}
+	if(
+			!( format.width*format_pixel_size(format) <= format.bytesperline )
+	) {
+		log_error( "condition not fulfilled: (format.width*format_pixel_size(format) <= format.bytesperline)\n" );
+		return RET_FAILURE;
+	}
+	/*
+	if( format.xfer_func != V4L2_XFER_FUNC_DEFAULT ) {
+		log_error( "xfer_func: non-standard color transfer functions not supported\n" );
+		return RET_FAILURE;
+	}
+	if( format.ycbcr_enc != V4L2_YCBCR_ENC_DEFAULT ) {
+		log_error( "ycbcr_enc: non-standard color encodings not supported\n" );
+		return RET_FAILURE;
+	}
+	if( format.quantization != V4L2_QUANTIZATION_DEFAULT ) {
+		log_error( "quantization: non-standard color quantizations not supported\n" );
+		return RET_FAILURE;
+	}
+	*/
+	return RET_SUCCESS;
+}
+
+bool format_is_planar(
+		const img_format_t format
+)
+{
+	return (
+			format.pixelformat == V4L2_PIX_FMT_GREY
+			|| format.pixelformat == V4L2_PIX_FMT_NV12
+			|| format.pixelformat == V4L2_PIX_FMT_YUV420
+	);
+}
+
+void yuv_planes_init(
+		const img_format_t format,
+		const void* buffer,
+		yuv_planes_t* planes
+)
+{
+	const byte_t* y_plane = CAST_TO_BYTE_PTR( buffer );
+	const byte_t* chroma = &y_plane[format.bytesperline * format.height];
+	(*planes) = (yuv_planes_t){
+		.y = y_plane,
+		.u = NULL,
+		.v = NULL,
+		.y_stride = format.bytesperline,
+		.uv_stride = 0,
+		.uv_step = 1,
+	};
+	if( format.pixelformat == V4L2_PIX_FMT_NV12 ) {
+		// | Y plane | U0 V0 U1 V1 ... |
+		planes->u = chroma;
+		planes->v = &chroma[1];
+		planes->uv_stride = format.bytesperline;
+		planes->uv_step = 2;
+	}
+	else if( format.pixelformat == V4L2_PIX_FMT_YUV420 ) {
+		// | Y plane | U plane | V plane |
+		// (chroma lines are half as long)
+		planes->uv_stride = format.bytesperline / 2;
+		planes->u = chroma;
+		planes->v = &chroma[planes->uv_stride * ((format.height+1)/2)];
+	}
+}
+
+size_t format_image_size(
+		const img_format_t format
+)
+{
+	const size_t luma_size = format.bytesperline * format.height;
+	if(
+			format.pixelformat == V4L2_PIX_FMT_NV12
+			|| format.pixelformat == V4L2_PIX_FMT_YUV420
+	) {
+		// both have 2 chroma bytes per 2x2 pixels:
+		return luma_size + format.bytesperline * ((format.height+1)/2);
+	}
+	return luma_size;
+}
+
+ret_t planar_to_rgb(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+)
+{
+	(void )src_size;
+	(void )dst_size;
+	const img_format_t src_format = converter->src_format;
+	yuv_planes_t planes;
+	yuv_planes_init( src_format, src, &planes );
+	for( uint y_pos=0; y_pos<src_format.height; y_pos++ ) {
+		const byte_t* y_row = &planes.y[y_pos * planes.y_stride];
+		byte_t* dst_row = &dst[y_pos * src_format.width * 3];
+		if( planes.u == NULL ) {
+			for( uint x_pos=0; x_pos<src_format.width; x_pos++ ) {
+				dst_row[x_pos*3+0] = y_row[x_pos];
+				dst_row[x_pos*3+1] = y_row[x_pos];
+				dst_row[x_pos*3+2] = y_row[x_pos];
+			}
+			continue;
+		}
+		const byte_t* u_row = &planes.u[(y_pos/2) * planes.uv_stride];
+		const byte_t* v_row = &planes.v[(y_pos/2) * planes.uv_stride];
+		// same transformation as for YUYV:
+		for( uint x_pos=0; x_pos<src_format.width; x_pos++ ) {
+			const float y = y_row[x_pos];
+			const float u = (float )u_row[(x_pos/2) * planes.uv_step] - 128;
+			const float v = (float )v_row[(x_pos/2) * planes.uv_step] - 128;
+			dst_row[x_pos*3+0] = clamp( 1*y + 0*u + 1.402*v, 0, 255.0 );
+			dst_row[x_pos*3+1] = clamp( 1*y - 0.344136*u - 0.714136*v, 0, 255.0 );
+			dst_row[x_pos*3+2] = clamp( 1*y + 1.772*u + 0*v, 0, 255.0 );
+		}
+	}
+	return RET_SUCCESS;
+}
+
+ret_t planar_to_yuv420(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+)
+{
+	(void )src_size;
+	(void )dst_size;
+	const img_format_t src_format = converter->src_format;
+	yuv_planes_t planes;
+	yuv_planes_init( src_format, src, &planes );
+	const uint width = src_format.width;
+	const uint chroma_width = (width+1)/2;
+	const uint chroma_height = (src_format.height+1)/2;
+	byte_t* output_y = dst;
+	byte_t* output_u = &output_y[width * src_format.height];
+	byte_t* output_v = &output_u[chroma_width * chroma_height];
+	for( uint y_pos=0; y_pos<src_format.height; y_pos++ ) {
+		memcpy( &output_y[y_pos * width], &planes.y[y_pos * planes.y_stride], width );
+	}
+	if( planes.u == NULL ) {
+		memset( output_u, 128, 2 * chroma_width * chroma_height );
+		return RET_SUCCESS;
+	}
+	for( uint y_pos=0; y_pos<chroma_height; y_pos++ ) {
+		const byte_t* u_row = &planes.u[y_pos * planes.uv_stride];
+		const byte_t* v_row = &planes.v[y_pos * planes.uv_stride];
+		byte_t* dst_u = &output_u[y_pos * chroma_width];
+		byte_t* dst_v = &output_v[y_pos * chroma_width];
+		if( planes.uv_step == 1 ) {
+			memcpy( dst_u, u_row, chroma_width );
+			memcpy( dst_v, v_row, chroma_width );
+			continue;
+		}
+		// deinterleave:
+		for( uint x_pos=0; x_pos<chroma_width; x_pos++ ) {
+			dst_u[x_pos] = u_row[x_pos*2];
+			dst_v[x_pos] = v_row[x_pos*2];
+		}
+	}
+	return RET_SUCCESS;
+}
+
+ret_t planar_to_gray(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+)
+{
+	(void )src_size;
+	(void )dst_size;
+	const img_format_t src_format = converter->src_format;
+	yuv_planes_t planes;
+	yuv_planes_init( src_format, src, &planes );
+	for( uint y_pos=0; y_pos<src_format.height; y_pos++ ) {
+		memcpy( &dst[y_pos * src_format.width], &planes.y[y_pos * planes.y_stride], src_format.width );
+	}
+	return RET_SUCCESS;
+}
+
+uint diff_row(
+		const byte_t* restrict row_1,
+		const byte_t* restrict row_2,
+		const uint count
+)
+{
+	uint sum = 0;
+	for( uint i=0; i<count; i++ ) {
+		sum += abs( (int )row_1[i] - (int )row_2[i] );
+	}
+	return sum;
+}
+
+uint diff_row_yuyv(
+		const byte_t* restrict row_1,
+		const byte_t* restrict row_2,
+		const uint count
+)
+{
+	uint sum = 0;
+	for( uint i=0; i<count; i++ ) {
+		sum += abs( (int )row_1[i*2] - (int )row_2[i*2] );
+	}
+	return sum;
+}
+
+void resize_plane(
+		const byte_t* src,
+		const uint src_width,
+		const uint src_height,
+		const uint channels,
+		byte_t* dst,
+		const uint dst_width,
+		const uint dst_height
+)
+{
+	if( src_width == dst_width*2 && src_height == dst_height*2 ) {
+		box_plane_2( src, src_width, channels, dst, dst_width, dst_height );
+	}
+	else if( src_width == dst_width*4 && src_height == dst_height*4 ) {
+		box_plane_4( src, src_width, channels, dst, dst_width, dst_height );
+	}
+	else if( src_width == dst_width && src_height == dst_height ) {
+		memcpy( dst, src, (size_t )src_width * src_height * channels );
+	}
+	else {
+		bilinear_plane( src, src_width, src_height, channels, dst, dst_width, dst_height );
+	}
+}
+
+// the source rows of one output row are summed up
+// first (contiguous, so the loop vectorizes),
+// then neighbouring samples of the same channel:
+#define DEF_BOX_PLANE(FACTOR) \
+void CAT(box_plane_,FACTOR)( \
+		const byte_t* restrict src, \
+		const uint src_width, \
+		const uint channels, \
+		byte_t* restrict dst, \
+		const uint dst_width, \
+		const uint dst_height \
+) \
+{ \
+	const uint src_stride = src_width * channels; \
+	uint16_t sums[src_stride]; \
+	for( uint y=0; y<dst_height; y++ ) { \
+		const byte_t* src_row = &src[y*FACTOR * src_stride]; \
+		for( uint i=0; i<src_stride; i++ ) { \
+			sums[i] = src_row[i]; \
+		} \
+		for( uint row=1; row<FACTOR; row++ ) { \
+			src_row += src_stride; \
+			for( uint i=0; i<src_stride; i++ ) { \
+				sums[i] += src_row[i]; \
+			} \
+		} \
+		byte_t* dst_row = &dst[y * dst_width * channels]; \
+		for( uint x=0; x<dst_width; x++ ) { \
+		for( uint c=0; c<channels; c++ ) { \
+			uint sum = FACTOR*FACTOR/2; \
+			for( uint i=0; i<FACTOR; i++ ) { \
+				sum += sums[(x*FACTOR + i) * channels + c]; \
+			} \
+			dst_row[x*channels + c] = sum / (FACTOR*FACTOR); \
+		} \
+		} \
+	} \
+}
+
+DEF_BOX_PLANE(2)
+DEF_BOX_PLANE(4)
+
+void bilinear_plane(
+		const byte_t* src,
+		const uint src_width,
+		const uint src_height,
+		const uint channels,
+		byte_t* dst,
+		const uint dst_width,
+		const uint dst_height
+)
+{
+	// pixel centers are aligned, positions
+	// in 16.16 fixed point, weights in 8 bit:
+	const uint64_t x_step = ((uint64_t )src_width << 16) / dst_width;
+	const uint64_t y_step = ((uint64_t )src_height << 16) / dst_height;
+	for( uint y=0; y<dst_height; y++ ) {
+		const int64_t src_y = (int64_t )((2*y+1) * y_step / 2) - (1 << 15);
+		const uint y0 = (src_y < 0) ? 0 : (src_y >> 16);
+		const uint y1 = MIN( y0+1, src_height-1 );
+		const uint fy = (src_y < 0) ? 0 : ((src_y >> 8) & 0xff);
+		const byte_t* row_0 = &src[y0 * src_width * channels];
+		const byte_t* row_1 = &src[y1 * src_width * channels];
+		byte_t* dst_row = &dst[y * dst_width * channels];
+		for( uint x=0; x<dst_width; x++ ) {
+			const int64_t src_x = (int64_t )((2*x+1) * x_step / 2) - (1 << 15);
+			const uint x0 = (src_x < 0) ? 0 : (src_x >> 16);
+			const uint x1 = MIN( x0+1, src_width-1 );
+			const uint fx = (src_x < 0) ? 0 : ((src_x >> 8) & 0xff);
+			for( uint c=0; c<channels; c++ ) {
+				const uint top = row_0[x0*channels+c] * (256-fx) + row_0[x1*channels+c] * fx;
+				const uint bottom = row_1[x0*channels+c] * (256-fx) + row_1[x1*channels+c] * fx;
+				dst_row[x*channels+c] = (top * (256-fy) + bottom * fy + (1 << 15)) >> 16;
+			}
+		}
+	}
+}
+
+ret_t yuyv_to_rgb(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+)
+{
+	(void )src_size;
+	(void )dst_size;
+	const img_format_t* format = &converter->src_format;
+	// 4 bytes is 2 pixels (side by side):
+	// with same U,V
+	// but Y0/Y1 for left/right pixel
+	//
+	// | Y0 | U | Y1 | U |
+	//
+	// =>
+	//
+	// |Pixel 0|Pixel 1|
+	// |Y0,U,V |Y1,U,V |
+	for( uint y_pos=0; y_pos<format->height; y_pos++ ) {
+	for( uint x_pos=0; x_pos<format->width/2; x_pos++ ) {
+		const byte_t* read_pos = &src[
+			y_pos*format->bytesperline
+			+ x_pos*4
+		];
+		const uint write_pos = (
+			(y_pos*format->width + x_pos*2) * 3
+			);
+		// transform:
+		float y0 = read_pos[0];
+		float u = read_pos[1];
+		float y1 = read_pos[2];
+		float v = read_pos[3];
+		u -= 128;
+		v -= 128;
+		/*
+		y0 -= 16;
+		y1 -= 16;
+		*/
+		// left pixel:
+		const float left_r = 1*y0 + 0*u + 1.402*v;
+		const float left_g = 1*y0 - 0.344136*u - 0.714136*v;
+		const float left_b = 1*y0 + 1.772*u + 0*v;
+		// right pixel:
+		const float right_r = 1*y1 + 0*u + 1.402*v;
+		const float right_g = 1*y1 - 0.344136*u - 0.714136*v;
+		const float right_b = 1*y1 + 1.772*u + 0*v;
+		// write:
+		dst[write_pos+0] = clamp( left_r, 0,255.0 );
+		dst[write_pos+1] = clamp( left_g, 0,255.0 );
+		dst[write_pos+2] = clamp( left_b, 0,255.0 );
+		dst[write_pos+3] = clamp( right_r, 0,255.0 );
+		dst[write_pos+4] = clamp( right_g, 0,255.0 );
+		dst[write_pos+5] = clamp( right_b, 0,255.0 );
+	}
+	}
+	return RET_SUCCESS;
+}
+
+ret_t yuyv_to_yuv420(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+)
+{
+	(void )src_size;
+	(void )dst_size;
+	const img_format_t* format = &converter->src_format;
+	byte_t* output_y = dst;
+	const uint chroma_width = (format->width+1)/2;
+	const uint chroma_height = (format->height+1)/2;
+	byte_t* output_u = &output_y[format->width * format->height];
+	byte_t* output_v = &output_u[chroma_width * chroma_height];
+	// | Y0 | U | Y1 | V |
+	//
+	// luma is copied,
+	// chroma of 2 neighbouring lines is averaged:
+	for( uint y_pos=0; y_pos<format->height; y_pos+=2 ) {
+		const byte_t* line_0 = &src[y_pos*format->bytesperline];
+		// odd height: use last line twice
+		const byte_t* line_1 = (y_pos+1 < format->height)
+			? &src[(y_pos+1)*format->bytesperline]
+			: line_0;
+		byte_t* dst_y_0 = &output_y[y_pos*format->width];
+		byte_t* dst_y_1 = &output_y[(y_pos+1)*format->width];
+		byte_t* dst_u = &output_u[(y_pos/2)*chroma_width];
+		byte_t* dst_v = &output_v[(y_pos/2)*chroma_width];
+		for( uint x_pos=0; x_pos<format->width/2; x_pos++ ) {
+			dst_y_0[x_pos*2+0] = line_0[x_pos*4+0];
+			dst_y_0[x_pos*2+1] = line_0[x_pos*4+2];
+			if( line_1 != line_0 ) {
+				dst_y_1[x_pos*2+0] = line_1[x_pos*4+0];
+				dst_y_1[x_pos*2+1] = line_1[x_pos*4+2];
+			}
+			dst_u[x_pos] = (line_0[x_pos*4+1] + line_1[x_pos*4+1] + 1) / 2;
+			dst_v[x_pos] = (line_0[x_pos*4+3] + line_1[x_pos*4+3] + 1) / 2;
+		}
+	}
+	return RET_SUCCESS;
+}
+
+ret_t yuyv_to_gray(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+)
+{
+	(void )src_size;
+	(void )dst_size;
+	const img_format_t format = converter->src_format;
+	// | Y0 | U | Y1 | V |
+	for( uint y_pos=0; y_pos<format.height; y_pos++ ) {
+		const byte_t* src_row = &src[y_pos*format.bytesperline];
+		byte_t* dst_row = &dst[y_pos*format.width];
+		for( uint x_pos=0; x_pos<format.width; x_pos++ ) {
+			dst_row[x_pos] = src_row[x_pos*2];
+		}
+	}
+	return RET_SUCCESS;
+}
+
+ret_t jpeg_to_raw(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+)
+{
+	return image_jpeg_decode(
+			converter->src_format,
+			converter->dst_format,
+			src, src_size,
+			dst, dst_size
+	);
+}
+
+ret_t jpeg_copy(
+		const image_converter_t* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+)
+{
+	(void )converter;
+	if( src_size > dst_size ) {
+		log_error( "jpeg: frame size %zu exceeds buffer size %zu\n", src_size, dst_size );
+		return RET_FAILURE;
+	}
+	memcpy( dst, src, src_size );
+	return RET_SUCCESS;
+}
@@ -17,12 +17,69 @@
 #include <linux/videodev2.h>
 
 
+// SOI, COM, huffman tables
+// (see 'image_jpeg_header'):
+#define IMAGE_JPEG_HEADER_MAX_SIZE 2048
+
 /********************
  * Types
 ********************/
 
 typedef struct v4l2_pix_format img_format_t;
 
+// format of converted frames
+// (as passed on to storage):
+typedef enum {
+	OUTPUT_FORMAT_RGB,
+	// planar Y, U, V
+	// with 2x2 chroma subsampling:
+	OUTPUT_FORMAT_YUV420,
+	// the camera's MJPEG bitstream, not decoded
+	// (variable size, requires MJPEG capture):
+	OUTPUT_FORMAT_JPEG,
+	// luma only, 1 byte per pixel:
+	OUTPUT_FORMAT_GRAY,
+} output_format_t;
+
+struct image_converter;
+
+// src: src_size bytes, dst: dst_size bytes
+// (at least the converter's dst_size):
+typedef ret_t (*image_convert_func_t)(
+		const struct image_converter* converter,
+		const byte_t* src,
+		const size_t src_size,
+		byte_t* dst,
+		const size_t dst_size
+);
+
+// conversion of one source format, selected once
+// (see 'image_converter_init'):
+typedef struct image_converter {
+	img_format_t src_format;
+	output_format_t dst_format;
+	// output frame size
+	// (see 'image_converter_set_output_size'):
+	uint dst_width;
+	uint dst_height;
+	// minimum size of the output buffer:
+	size_t dst_size;
+	image_convert_func_t convert;
+	// full size frame before resizing
+	// (NULL: no resizing):
+	byte_t* scratch;
+	size_t scratch_size;
+} image_converter_t;
+
+// luma of a frame at 1/8 resolution,
+// cheap to compare (see 'image_luma_diff'):
+typedef struct {
+	uint width;
+	uint height;
+	byte_t* data;
+	size_t max_size;
+} image_luma_t;
+
 /********************
  * Functions
 ********************/
@@ -46,6 +103,157 @@ ret_t image_save_ppm_to_ram(
 		FILE* file
 );
 
+ret_t image_save_y4m(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		const uint width,
+		const uint height
+);
+
+ret_t image_save_pgm(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		const uint width,
+		const uint height
+);
+
+// write a single OUTPUT_FORMAT_GRAY frame
+// as binary PGM:
+ret_t image_save_pgm_to_ram(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		const uint width,
+		const uint height,
+		FILE* file
+);
+
+// write a single YUV420 frame
+// as YUV4MPEG2 stream:
+ret_t image_save_y4m_to_ram(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		const uint width,
+		const uint height,
+		FILE* file
+);
+
+// header of the files written by 'image_save_ppm',
+// 'image_save_pgm' and 'image_save_y4m'
+// (not OUTPUT_FORMAT_JPEG), split around the comment.
+// The file is: prefix, comment, suffix, frame data:
+ret_t image_file_header(
+		const output_format_t format,
+		const uint width,
+		const uint height,
+		char* prefix,
+		const size_t prefix_max_size,
+		char* suffix,
+		const size_t suffix_max_size
+);
+
+// write an MJPEG frame as standalone .jpg file
+// (see 'image_jpeg_header'):
+ret_t image_save_jpeg(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size
+);
+
+ret_t image_save_jpeg_to_ram(
+		const char* filename,
+		const char* comment,
+		const void* buffer,
+		const uint buffer_size,
+		FILE* file
+);
+
+// MJPEG frames are stored as
+//   header, buffer[2..buffer_size)
+// The header replaces the SOI marker by
+// SOI, a COM segment containing 'comment' (if not NULL)
+// and the standard huffman tables, if the frame
+// has none (UVC cameras omit them):
+ret_t image_jpeg_header(
+		const void* buffer,
+		const size_t buffer_size,
+		const char* comment,
+		byte_t* header,
+		const size_t header_max_size,
+		size_t* header_size
+);
+
+// src_size: bytes used in src_buffer
+// (compressed formats have a variable size)
+ret_t image_convert(
+		const img_format_t src_format,
+		const output_format_t dst_format,
+		const void* src_buffer,
+		const size_t src_size,
+		const void* dst_buffer,
+		const size_t dst_size
+);
+
+// check the format and select the kernel.
+// Cheaper than 'image_convert' per frame:
+ret_t image_converter_init(
+		image_converter_t* converter,
+		const img_format_t src_format,
+		const output_format_t dst_format
+);
+
+ret_t image_converter_run(
+		const image_converter_t* converter,
+		const void* src_buffer,
+		const size_t src_size,
+		const void* dst_buffer,
+		const size_t dst_size
+);
+
+// downscale the converted frames to width x height
+// (see 'image_resize'). Allocates a full size buffer,
+// free it with 'image_converter_exit':
+ret_t image_converter_set_output_size(
+		image_converter_t* converter,
+		const uint width,
+		const uint height
+);
+
+void image_converter_exit(
+		image_converter_t* converter
+);
+
+// downscale a converted frame (RGB, YUV420 or GRAY).
+// Exact 2x or 4x: box filter (average of 2x2/4x4 pixels),
+// otherwise bilinear:
+ret_t image_resize(
+		const output_format_t format,
+		const uint src_width,
+		const uint src_height,
+		const void* src_buffer,
+		const size_t src_size,
+		const uint dst_width,
+		const uint dst_height,
+		const void* dst_buffer,
+		const size_t dst_size
+);
+
+// bytes used by a converted frame
+// (image_output_size, except for OUTPUT_FORMAT_JPEG):
+size_t image_converted_size(
+		const img_format_t src_format,
+		const output_format_t dst_format,
+		const size_t src_size
+);
+
 ret_t image_convert_to_rgb(
 		const img_format_t src_format,
 		const void* src_buffer,
@@ -53,6 +261,37 @@ ret_t image_convert_to_rgb(
 		const size_t dst_size
 );
 
+// precondition: src_format must be YUYV,
+// NV12, YU12 (V4L2_PIX_FMT_YUV420) or GREY
+ret_t image_convert_to_yuv420(
+		const img_format_t src_format,
+		const void* src_buffer,
+		const void* dst_buffer,
+		const size_t dst_size
+);
+
+ret_t image_yuv420_to_rgb(
+		const uint width,
+		const uint height,
+		const void* src_buffer,
+		const size_t src_size,
+		const void* dst_buffer,
+		const size_t dst_size
+);
+
+// full decode of an MJPEG frame:
+ret_t image_jpeg_decode(
+		const img_format_t src_format,
+		const output_format_t dst_format,
+		const void* src_buffer,
+		const size_t src_size,
+		const void* dst_buffer,
+		const size_t dst_size
+);
+
+// compares the luma only.
+// precondition: src_format must be YUYV,
+// NV12, YU12 or GREY (MJPEG: see 'image_jpeg_luma')
 ret_t image_diff(
 		const img_format_t src_format,
 		const void* src_buffer_1,
@@ -60,9 +299,63 @@ ret_t image_diff(
 		float* result
 );
 
+// allocate for frames of this size:
+void image_luma_init(
+		image_luma_t* luma,
+		const uint width,
+		const uint height
+);
+
+void image_luma_exit(
+		image_luma_t* luma
+);
+
+// luma of an MJPEG frame at 1/8 resolution.
+// Only the DC coefficients are used, chroma
+// is entropy decoded but never transformed:
+ret_t image_jpeg_luma(
+		const void* src_buffer,
+		const size_t src_size,
+		image_luma_t* luma
+);
+
+// same scale as 'image_diff':
+ret_t image_luma_diff(
+		const image_luma_t* luma_1,
+		const image_luma_t* luma_2,
+		float* result
+);
+
 size_t image_rgb_size(
 		const uint width,
 		const uint height
 );
 
+size_t image_yuv420_size(
+		const uint width,
+		const uint height
+);
+
+// OUTPUT_FORMAT_JPEG: upper bound
+size_t image_output_size(
+		const output_format_t format,
+		const uint width,
+		const uint height
+);
+
+const char* image_output_format_str(
+		const output_format_t format
+);
+
+// camera pixel formats
+// (as used in cmd line args):
+const char* image_pixel_format_str(
+		const __u32 pixel_format
+);
+
+// 0: unknown
+__u32 image_pixel_format_from_str(
+		const char* str
+);
+
 #endif
@@ -0,0 +1,166 @@
+#include "name_template.h"
+
+#include <string.h>
+
+
+/************************
+ * private utils decl
+*************************/
+
+uint name_template_digits(
+		uint64_t value
+);
+
+// move the text after 'field' so that
+// it has 'width' digits:
+void name_template_resize_field(
+		name_template_t* name_template,
+		const uint field,
+		const uint width
+);
+
+/************************
+ * API implementation
+*************************/
+
+void name_template_init(
+		name_template_t* name_template
+)
+{
+	name_template->str[0] = '\0';
+	name_template->length = 0;
+	name_template->field_count = 0;
+	name_template->overflow = false;
+}
+
+void name_template_append(
+		name_template_t* name_template,
+		const char* text
+)
+{
+	const size_t size = strlen( text );
+	if( name_template->length + size >= STR_BUFFER_SIZE ) {
+		name_template->overflow = true;
+		return;
+	}
+	memcpy( &name_template->str[name_template->length], text, size + 1 );
+	name_template->length += size;
+}
+
+uint name_template_append_field(
+		name_template_t* name_template,
+		const uint min_width
+)
+{
+	if(
+			name_template->field_count >= NAME_TEMPLATE_MAX_FIELDS
+			|| name_template->length + min_width >= STR_BUFFER_SIZE
+	) {
+		name_template->overflow = true;
+		return 0;
+	}
+	const uint field = name_template->field_count;
+	name_template->fields[field] = (name_template_field_t){
+		.offset = name_template->length,
+		.width = min_width,
+		.min_width = min_width,
+	};
+	name_template->field_count++;
+	memset( &name_template->str[name_template->length], '0', min_width );
+	name_template->length += min_width;
+	name_template->str[name_template->length] = '\0';
+	return field;
+}
+
+uint name_template_append_time(
+		name_template_t* name_template
+)
+{
+	const uint field = name_template_append_field( name_template, 1 );
+	name_template_append( name_template, "." );
+	name_template_append_field( name_template, 3 );
+	return field;
+}
+
+void name_template_set(
+		name_template_t* name_template,
+		const uint field,
+		uint64_t value
+)
+{
+	const uint width = MAX(
+			name_template_digits( value ),
+			name_template->fields[field].min_width
+	);
+	if( width != name_template->fields[field].width ) {
+		name_template_resize_field( name_template, field, width );
+	}
+	// (the resize may have failed: only fill the field)
+	const uint field_width = name_template->fields[field].width;
+	char* digits = &name_template->str[name_template->fields[field].offset];
+	for( int i=field_width-1; i>=0; i-- ) {
+		digits[i] = '0' + (value % 10);
+		value /= 10;
+	}
+}
+
+void name_template_set_time(
+		name_template_t* name_template,
+		const uint field,
+		const timeval_t* time
+)
+{
+	name_template_set( name_template, field, time->tv_sec );
+	name_template_set( name_template, field+1, time->tv_nsec / 1000 / 1000 );
+}
+
+bool name_template_is_valid(
+		const name_template_t* name_template
+)
+{
+	return !name_template->overflow;
+}
+
+/************************
+ * private utils impl
+*************************/
+
+uint name_template_digits(
+		uint64_t value
+)
+{
+	uint count = 1;
+	while( value >= 10 ) {
+		value /= 10;
+		count++;
+	}
+	return count;
+}
+
+void name_template_resize_field(
+		name_template_t* name_template,
+		const uint field,
+		const uint width
+)
+{
+	name_template_field_t* current = &name_template->fields[field];
+	const int delta = (int )width - (int )current->width;
+	if( name_template->length + delta >= STR_BUFFER_SIZE ) {
+		// (keep the old width, only the
+		// lowest digits of the value are set)
+		name_template->overflow = true;
+		return;
+	}
+	const uint tail = current->offset + current->width;
+	// (including the terminating 0)
+	memmove(
+			&name_template->str[tail + delta],
+			&name_template->str[tail],
+			name_template->length - tail + 1
+	);
+	name_template->length += delta;
+	current->width = width;
+	for( uint i=field+1; i<name_template->field_count; i++ ) {
+		name_template->fields[i].offset += delta;
+	}
+}
@@ -0,0 +1,110 @@
+/****************************
+ * Name Templates
+ *
+ * strings which only differ in a few numbers
+ * from frame to frame (file names, timestamps,
+ * file headers) are built once from text and
+ * number fields. Setting a field renders its digits
+ * in place: no formatting, no allocations.
+ *
+ * Fields are zero padded to a minimum width
+ * (as "%0Nu"). If a value needs more (or again
+ * fewer) digits, the text after the field is moved.
+ *
+ * e.g.:
+ *   name_template_append( &t, "image" );
+ *   const uint counter = name_template_append_field( &t, 4 );
+ *   name_template_append( &t, ".ppm" );
+ *   name_template_set( &t, counter, 42 ); // "image0042.ppm"
+ ***************************/
+#pragma once
+
+#include "global.h"
+#include "time.h"
+
+#include <stdint.h>
+
+
+#define NAME_TEMPLATE_MAX_FIELDS 4
+
+/********************
+ * Types
+********************/
+
+typedef struct {
+	uint offset;
+	uint width; // current
+	uint min_width;
+} name_template_field_t;
+
+typedef struct {
+	char str[STR_BUFFER_SIZE];
+	uint length;
+	name_template_field_t fields[NAME_TEMPLATE_MAX_FIELDS];
+	uint field_count;
+	// the template does not fit into 'str':
+	bool overflow;
+} name_template_t;
+
+/********************
+ * Functions
+********************/
+
+void name_template_init(
+		name_template_t* name_template
+);
+
+void name_template_append(
+		name_template_t* name_template,
+		const char* text
+);
+
+// returns the index of the field
+// (value 0 until set):
+uint name_template_append_field(
+		name_template_t* name_template,
+		const uint min_width
+);
+
+// "SECONDS.MILLISECONDS", returns the index of the
+// seconds field, milliseconds are the next one
+// (see 'name_template_set_time'):
+uint name_template_append_time(
+		name_template_t* name_template
+);
+
+// precondition: 'name_template_is_valid'.
+// If the value does not fit into 'str',
+// only its lowest digits are set and
+// the template becomes invalid:
+void name_template_set(
+		name_template_t* name_template,
+		const uint field,
+		const uint64_t value
+);
+
+void name_template_set_time(
+		name_template_t* name_template,
+		const uint field,
+		const timeval_t* time
+);
+
+// false if the template did not fit
+// (check once after building it):
+bool name_template_is_valid(
+		const name_template_t* name_template
+);
+
+static inline const char* name_template_str(
+		const name_template_t* name_template
+)
+{
+	return name_template->str;
+}
+
+static inline uint name_template_length(
+		const name_template_t* name_template
+)
+{
+	return name_template->length;
+}
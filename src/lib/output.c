@@ -4,6 +4,7 @@
 #include "lib/spsc_queue.h"
 
 #include <stdarg.h>
+#include <stdint.h>
 #include <sys/syslog.h>
 #include <syslog.h> // <- write to syslog
 #include <stdio.h>
@@ -11,19 +12,40 @@
 #include <threads.h>
 #include <time.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 
+// file sink: records are collected
+// and written once per batch:
+#define LOG_FILE_BUFFER_SIZE (64*1024)
+
 /***********************
  * Types
  ***********************/
 
 typedef struct {
 	int level;
+	uint64_t time_ns; // CLOCK_MONOTONIC
 	char msg[STR_BUFFER_SIZE];
 } log_entry_t;
 
+typedef struct {
+	int fd; // -1: log to syslog
+	const char* path;
+	size_t max_size;
+	uint max_count;
+	uint index;
+	size_t size; // written to the current file
+	byte_t buffer[LOG_FILE_BUFFER_SIZE];
+	size_t buffer_size;
+} log_file_t;
+
 
 #define LOG_QUEUE_COUNT 16384
+// messages passed to syslog per wakeup:
+#define LOG_BATCH_COUNT 256
 #define DB_LOG(fmt,...)
 #define ERR_LOG(fmt,...) { \
 	fprintf( stderr, fmt, ## __VA_ARGS__ ); \
@@ -58,16 +80,64 @@ static _Atomic bool threaded_log = false;
 static log_queue_t log_queue;
 static pthread_mutex_t queue_mutex;
 
+// protects 'g_file' (the log thread and direct
+// writers may overlap after 'log_stop'):
+static pthread_mutex_t file_mutex;
+static log_file_t g_file = { .fd = -1 };
+
+/***********************
+ * Private Declarations
+ ***********************/
+
+// pass a message to syslog, the log thread
+// or the log file:
+void log_msg(
+		const int level,
+		const char* fmt,
+		va_list args
+);
+
+uint64_t log_time_ns(
+		const clockid_t clock
+);
+
+ret_t log_file_open(
+		log_file_t* file
+);
+
+void log_file_close(
+		log_file_t* file
+);
+
+// append one record to the buffer,
+// rotate the file if it would exceed its size:
+ret_t log_file_append(
+		log_file_t* file,
+		const log_entry_t* entry
+);
+
+ret_t log_file_flush(
+		log_file_t* file
+);
+
+// the file sink failed:
+// report to stderr and fall back to syslog:
+void log_file_fail(
+		log_file_t* file,
+		const char* what
+);
+
 /***********************
  * Function Declarations
  ***********************/
 
-void log_init(
+ret_t log_init(
 		const char* prefix,
 		const log_config_t config
 )
 {
 	pthread_mutex_init( &queue_mutex, 0);
+	pthread_mutex_init( &file_mutex, 0);
 	log_queue_init( &log_queue, LOG_QUEUE_COUNT );
 	openlog(
 			prefix,
@@ -75,12 +145,35 @@ void log_init(
 			LOG_USER
 	);
 	g_config = config;
+	if( config.file_path != NULL ) {
+		g_file = (log_file_t){
+			.fd = -1,
+			.path = config.file_path,
+			.max_size = config.file_max_size,
+			.max_count = config.file_max_count,
+			.index = 0,
+			.size = 0,
+			.buffer_size = 0,
+		};
+		if( RET_SUCCESS != log_file_open( &g_file ) ) {
+			log_file_fail( &g_file, "open" );
+			return RET_FAILURE;
+		}
+	}
+	return RET_SUCCESS;
 }
 
 void log_exit(void)
 {
+	if( g_file.fd != -1 ) {
+		if( RET_SUCCESS != log_file_flush( &g_file ) ) {
+			log_file_fail( &g_file, "write" );
+		}
+		log_file_close( &g_file );
+	}
 	closelog();
 	log_queue_exit( &log_queue );
+	pthread_mutex_destroy( &file_mutex );
 	pthread_mutex_destroy( &queue_mutex );
 }
 
@@ -96,24 +189,10 @@ void log_time(
 		va_end( args );
 	}
 	if( g_config.time_enable_log ) {
-		if( !threaded_log ) {
-			va_list args;
-			va_start( args, fmt );
-			vsyslog( LOG_INFO, fmt, args );
-			va_end( args );
-		}
-		else {
-			va_list args;
-			va_start( args, fmt );
-			pthread_mutex_lock( &queue_mutex );
-			log_entry_t* entry = NULL;
-			log_queue_push_start( &log_queue, &entry );
-			vsprintf( entry->msg, fmt, args );
-			entry->level = LOG_INFO;
-			log_queue_push_end( &log_queue );
-			pthread_mutex_unlock( &queue_mutex );
-			va_end( args );
-		}
+		va_list args;
+		va_start( args, fmt );
+		log_msg( LOG_INFO, fmt, args );
+		va_end( args );
 	}
 }
 
@@ -129,24 +208,10 @@ void log_verbose(
 		va_end( args );
 	}
 	if( g_config.verbose_enable_log ) {
-		if( !threaded_log ) {
-			va_list args;
-			va_start( args, fmt );
-			vsyslog( LOG_INFO, fmt, args );
-			va_end( args );
-		}
-		else {
-			va_list args;
-			va_start( args, fmt );
-			pthread_mutex_lock( &queue_mutex );
-			log_entry_t* entry = NULL;
-			log_queue_push_start( &log_queue, &entry );
-			vsprintf( entry->msg, fmt, args );
-			entry->level = LOG_INFO;
-			log_queue_push_end( &log_queue );
-			pthread_mutex_unlock( &queue_mutex );
-			va_end( args );
-		}
+		va_list args;
+		va_start( args, fmt );
+		log_msg( LOG_INFO, fmt, args );
+		va_end( args );
 	}
 }
 
@@ -162,24 +227,10 @@ void log_info(
 		va_end( args );
 	}
 	if( g_config.info_enable_log ) {
-		if( !threaded_log ) {
-			va_list args;
-			va_start( args, fmt );
-			vsyslog( LOG_INFO, fmt, args );
-			va_end( args );
-		}
-		else {
-			va_list args;
-			va_start( args, fmt );
-			pthread_mutex_lock( &queue_mutex );
-			log_entry_t* entry = NULL;
-			log_queue_push_start( &log_queue, &entry );
-			vsprintf( entry->msg, fmt, args );
-			entry->level = LOG_INFO;
-			log_queue_push_end( &log_queue );
-			pthread_mutex_unlock( &queue_mutex );
-			va_end( args );
-		}
+		va_list args;
+		va_start( args, fmt );
+		log_msg( LOG_INFO, fmt, args );
+		va_end( args );
 	}
 }
 
@@ -196,24 +247,10 @@ void log_warning(
 		va_end( args );
 	}
 	if( g_config.warning_enable_log ) {
-		if( !threaded_log ) {
-			va_list args;
-			va_start( args, fmt );
-			vsyslog( LOG_WARNING, fmt, args );
-			va_end( args );
-		}
-		else {
-			va_list args;
-			va_start( args, fmt );
-			pthread_mutex_lock( &queue_mutex );
-			log_entry_t* entry = NULL;
-			log_queue_push_start( &log_queue, &entry );
-			vsprintf( entry->msg, fmt, args );
-			entry->level = LOG_WARNING;
-			log_queue_push_end( &log_queue );
-			pthread_mutex_unlock( &queue_mutex );
-			va_end( args );
-		}
+		va_list args;
+		va_start( args, fmt );
+		log_msg( LOG_WARNING, fmt, args );
+		va_end( args );
 	}
 }
 
@@ -230,25 +267,10 @@ void log_error(
 		va_end( args );
 	}
 	if( g_config.error_enable_log ) {
-		if( !threaded_log ) {
-			va_list args;
-			va_start( args, fmt );
-			vsyslog( LOG_ERR, fmt, args );
-			va_end( args );
-		}
-		else {
-			va_list args;
-			va_start( args, fmt );
-			pthread_mutex_lock( &queue_mutex );
-			log_entry_t* entry = NULL;
-			log_queue_push_start( &log_queue, &entry );
-			char buffer[STR_BUFFER_SIZE];
-			vsprintf( buffer, fmt, args );
-			entry->level = LOG_ERR;
-			log_queue_push_end( &log_queue );
-			pthread_mutex_unlock( &queue_mutex );
-			va_end( args );
-		}
+		va_list args;
+		va_start( args, fmt );
+		log_msg( LOG_ERR, fmt, args );
+		va_end( args );
 	}
 }
 
@@ -256,19 +278,34 @@ void log_run(void)
 {
 	threaded_log = true;
 	while(true) {
-		log_queue_read_start( &log_queue );
-		if( log_queue_get_should_stop(&log_queue) ) {
-			// before stopping the logging loop,
-			// log all pending messages:
-			for( int i=log_queue_get_count(&log_queue)-1; i>=0; i-- ) {
-				log_entry_t* entry = log_queue_read_get_index( &log_queue, i );
-				syslog(entry->level, "%s", entry->msg);
-			}
+		// after 'log_stop' all pending messages
+		// are logged before the loop returns:
+		log_entry_t* entries = NULL;
+		const uint count = log_queue_read_n_start( &log_queue, LOG_BATCH_COUNT, &entries );
+		if( count == 0 ) {
 			return;
 		}
-		log_entry_t* entry = log_queue_read_get( &log_queue );
-		syslog(entry->level, "%s", entry->msg);
-		log_queue_read_stop_dump( &log_queue );
+		pthread_mutex_lock( &file_mutex );
+		if( g_file.fd == -1 ) {
+			for( uint i=0; i<count; i++ ) {
+				syslog( entries[i].level, "%s", entries[i].msg );
+			}
+		}
+		else {
+			// one write per batch (unless the buffer is full):
+			ret_t ret = RET_SUCCESS;
+			for( uint i=0; i<count && ret == RET_SUCCESS; i++ ) {
+				ret = log_file_append( &g_file, &entries[i] );
+			}
+			if( ret == RET_SUCCESS ) {
+				ret = log_file_flush( &g_file );
+			}
+			if( ret != RET_SUCCESS ) {
+				log_file_fail( &g_file, "write" );
+			}
+		}
+		pthread_mutex_unlock( &file_mutex );
+		log_queue_read_n_stop_dump( &log_queue, count );
 	}
 }
 
@@ -278,4 +315,176 @@ void log_stop(void)
 	threaded_log = false;
 }
 
+const char* log_level_str(
+		const int level
+)
+{
+	switch( level ) {
+		case LOG_EMERG: return "emerg";
+		case LOG_ALERT: return "alert";
+		case LOG_CRIT: return "crit";
+		case LOG_ERR: return "error";
+		case LOG_WARNING: return "warning";
+		case LOG_NOTICE: return "notice";
+		case LOG_INFO: return "info";
+		case LOG_DEBUG: return "debug";
+	}
+	return "unknown";
+}
+
+/***********************
+ * Private Definitions
+ ***********************/
+
+void log_msg(
+		const int level,
+		const char* fmt,
+		va_list args
+)
+{
+	if( threaded_log ) {
+		pthread_mutex_lock( &queue_mutex );
+		log_entry_t* entry = NULL;
+		log_queue_push_start( &log_queue, &entry );
+		entry->time_ns = log_time_ns( CLOCK_MONOTONIC );
+		vsnprintf( entry->msg, STR_BUFFER_SIZE, fmt, args );
+		entry->level = level;
+		log_queue_push_end( &log_queue );
+		pthread_mutex_unlock( &queue_mutex );
+		return;
+	}
+	pthread_mutex_lock( &file_mutex );
+	if( g_file.fd == -1 ) {
+		vsyslog( level, fmt, args );
+	}
+	else {
+		log_entry_t entry;
+		entry.time_ns = log_time_ns( CLOCK_MONOTONIC );
+		vsnprintf( entry.msg, STR_BUFFER_SIZE, fmt, args );
+		entry.level = level;
+		if(
+				RET_SUCCESS != log_file_append( &g_file, &entry )
+				|| RET_SUCCESS != log_file_flush( &g_file )
+		) {
+			log_file_fail( &g_file, "write" );
+		}
+	}
+	pthread_mutex_unlock( &file_mutex );
+}
+
+uint64_t log_time_ns(
+		const clockid_t clock
+)
+{
+	struct timespec time;
+	clock_gettime( clock, &time );
+	return (uint64_t )time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+ret_t log_file_open(
+		log_file_t* file
+)
+{
+	char filename[STR_BUFFER_SIZE];
+	snprintf( filename, STR_BUFFER_SIZE, "%s.%u", file->path, file->index );
+	file->fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+	if( file->fd == -1 ) {
+		return RET_FAILURE;
+	}
+	if( file->max_count > 0 && file->index >= file->max_count ) {
+		snprintf( filename, STR_BUFFER_SIZE, "%s.%u", file->path, file->index - file->max_count );
+		unlink( filename );
+	}
+	log_file_header_t header;
+	memcpy( header.magic, LOG_FILE_MAGIC, sizeof(header.magic) );
+	header.monotonic_ns = log_time_ns( CLOCK_MONOTONIC );
+	header.realtime_ns = log_time_ns( CLOCK_REALTIME );
+	memcpy( file->buffer, &header, sizeof(header) );
+	file->buffer_size = sizeof(header);
+	file->size = 0;
+	return RET_SUCCESS;
+}
+
+void log_file_close(
+		log_file_t* file
+)
+{
+	close( file->fd );
+	file->fd = -1;
+}
+
+ret_t log_file_append(
+		log_file_t* file,
+		const log_entry_t* entry
+)
+{
+	const size_t len = strnlen( entry->msg, STR_BUFFER_SIZE );
+	const size_t record_size = sizeof(log_file_record_t) + len;
+	if(
+			file->max_size > 0
+			&& file->size + file->buffer_size + record_size > file->max_size
+			&& file->size + file->buffer_size > sizeof(log_file_header_t)
+	) {
+		if( RET_SUCCESS != log_file_flush( file ) ) {
+			return RET_FAILURE;
+		}
+		log_file_close( file );
+		file->index++;
+		if( RET_SUCCESS != log_file_open( file ) ) {
+			return RET_FAILURE;
+		}
+	}
+	if( file->buffer_size + record_size > LOG_FILE_BUFFER_SIZE ) {
+		if( RET_SUCCESS != log_file_flush( file ) ) {
+			return RET_FAILURE;
+		}
+	}
+	const log_file_record_t record = {
+		.time_ns = entry->time_ns,
+		.level = entry->level,
+		.len = len,
+	};
+	memcpy( &file->buffer[file->buffer_size], &record, sizeof(record) );
+	memcpy( &file->buffer[file->buffer_size + sizeof(record)], entry->msg, len );
+	file->buffer_size += record_size;
+	return RET_SUCCESS;
+}
+
+ret_t log_file_flush(
+		log_file_t* file
+)
+{
+	size_t written = 0;
+	while( written < file->buffer_size ) {
+		const ssize_t ret = write( file->fd, &file->buffer[written], file->buffer_size - written );
+		if( ret == -1 ) {
+			if( errno == EINTR ) {
+				continue;
+			}
+			return RET_FAILURE;
+		}
+		written += ret;
+	}
+	file->size += file->buffer_size;
+	file->buffer_size = 0;
+	return RET_SUCCESS;
+}
+
+void log_file_fail(
+		log_file_t* file,
+		const char* what
+)
+{
+	// (logging would recurse)
+	fprintf( stderr, "ERROR: log file '%s.%u': %s: %s. falling back to syslog\n",
+			file->path, file->index,
+			what,
+			strerror( errno )
+	);
+	if( file->fd != -1 ) {
+		log_file_close( file );
+	}
+	file->buffer_size = 0;
+}
+
 DEF_SPSC_QUEUE(log_queue,log_entry_t,DB_LOG,ERR_LOG)
@@ -1,6 +1,41 @@
+#pragma once
+
+#include "global.h"
+
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 
+/***********************
+ * File Sink
+ *
+ * Instead of syslog, log messages may be
+ * written to size-rotated binary files
+ * "<path>.0", "<path>.1", ...
+ * (only the last 'file_max_count' files are kept).
+ * Each file starts with a 'log_file_header_t',
+ * followed by records: a 'log_file_record_t'
+ * and 'len' bytes of message (not 0 terminated).
+ * Timestamps are CLOCK_MONOTONIC, taken
+ * when the message is logged.
+ ***********************/
+
+#define LOG_FILE_MAGIC "SYNLOG01"
+
+typedef struct {
+	char magic[8];
+	// the same instant on both clocks:
+	uint64_t monotonic_ns;
+	uint64_t realtime_ns;
+} log_file_header_t;
+
+typedef struct {
+	uint64_t time_ns;
+	uint32_t level; // syslog level
+	uint32_t len;
+} log_file_record_t;
+
 typedef struct {
 
 		bool time_enable_print;
@@ -18,13 +53,20 @@ typedef struct {
 		bool error_enable_print;
 		bool error_enable_log;
 
+		// NULL: log to syslog
+		const char* file_path;
+		size_t file_max_size; // in bytes
+		uint file_max_count; // 0: keep all
+
 } log_config_t;
 
 /***********************
  * Function Declarations
  ***********************/
 
-void log_init(
+// RET_FAILURE if the log file could not be created
+// (messages go to syslog then):
+ret_t log_init(
 		const char* prefix,
 		const log_config_t config
 );
@@ -55,6 +97,11 @@ void log_error(
 		...
 );
 
+// name of a syslog level ("info", "warning", ...):
+const char* log_level_str(
+		const int level
+);
+
 void log_run(void);
 
 void log_stop(void);
@@ -0,0 +1,273 @@
+#include "pipeline.h"
+
+#include "thread.h"
+#include "semaphore.h"
+#include "output.h"
+
+#include <string.h>
+#include <sched.h>
+
+
+/************************
+ * private utils decl
+*************************/
+
+void* pipeline_stage_run(
+		void* arg
+);
+
+// index of a registered queue, -1 if unknown:
+int pipeline_find_queue(
+		pipeline_t* pipeline,
+		const void* queue
+);
+
+// Kahn's algorithm over the queue edges:
+ret_t pipeline_sort(
+		pipeline_t* pipeline
+);
+
+bool pipeline_is_source(
+		const pipeline_stage_t* stage
+);
+
+/************************
+ * API implementation
+*************************/
+
+void pipeline_init(
+		pipeline_t* pipeline,
+		const char* suffix
+)
+{
+	snprintf( pipeline->suffix, sizeof(pipeline->suffix), "%s", suffix );
+	pipeline->stage_count = 0;
+	pipeline->queue_count = 0;
+	pipeline->running = false;
+	sem_init( &pipeline->running_sem, 0, 0 );
+	sem_init( &pipeline->finished, 0, 0 );
+}
+
+void pipeline_exit(
+		pipeline_t* pipeline
+)
+{
+	sem_destroy( &pipeline->finished );
+	sem_destroy( &pipeline->running_sem );
+}
+
+ret_t pipeline_add_queue(
+		pipeline_t* pipeline,
+		const char* name,
+		void* queue,
+		pipeline_close_func_t close
+)
+{
+	if( pipeline->queue_count >= PIPELINE_MAX_QUEUES ) {
+		log_error( "pipeline: too many queues\n" );
+		return RET_FAILURE;
+	}
+	pipeline->queues[pipeline->queue_count] = (pipeline_queue_t){
+		.name = name,
+		.queue = queue,
+		.close = close,
+		.producer = -1,
+		.consumer = -1,
+	};
+	pipeline->queue_count++;
+	return RET_SUCCESS;
+}
+
+ret_t pipeline_add_stage(
+		pipeline_t* pipeline,
+		const pipeline_stage_decl_t decl
+)
+{
+	if( pipeline->stage_count >= PIPELINE_MAX_STAGES ) {
+		log_error( "pipeline: too many stages\n" );
+		return RET_FAILURE;
+	}
+	const int index = pipeline->stage_count;
+	// connect queues (single producer, single consumer):
+	for( uint i=0; i<PIPELINE_MAX_PORTS && decl.inputs[i] != NULL; i++ ) {
+		const int queue_index = pipeline_find_queue( pipeline, decl.inputs[i] );
+		if( queue_index == -1 || pipeline->queues[queue_index].consumer != -1 ) {
+			log_error( "pipeline: '%s': input %u unknown or already consumed\n", decl.name, i );
+			return RET_FAILURE;
+		}
+		pipeline->queues[queue_index].consumer = index;
+	}
+	for( uint i=0; i<PIPELINE_MAX_PORTS && decl.outputs[i] != NULL; i++ ) {
+		const int queue_index = pipeline_find_queue( pipeline, decl.outputs[i] );
+		if( queue_index == -1 || pipeline->queues[queue_index].producer != -1 ) {
+			log_error( "pipeline: '%s': output %u unknown or already produced\n", decl.name, i );
+			return RET_FAILURE;
+		}
+		pipeline->queues[queue_index].producer = index;
+	}
+	pipeline_stage_t* stage = &pipeline->stages[index];
+	stage->decl = decl;
+	// (a copy: source and destination must not both be in *pipeline)
+	char suffix[sizeof(pipeline->suffix)];
+	memcpy( suffix, pipeline->suffix, sizeof(suffix) );
+	snprintf( stage->thread_name, sizeof(stage->thread_name), "%s%s",
+			decl.name,
+			suffix
+	);
+	stage->ret = RET_SUCCESS;
+	stage->started = false;
+	stage->running = &pipeline->running_sem;
+	stage->finished = &pipeline->finished;
+	// until sorted:
+	pipeline->order[index] = index;
+	pipeline->stage_count++;
+	return RET_SUCCESS;
+}
+
+ret_t pipeline_start(
+		pipeline_t* pipeline
+)
+{
+	if( RET_SUCCESS != pipeline_sort( pipeline ) ) {
+		return RET_FAILURE;
+	}
+	// consumers first:
+	for( int i=pipeline->stage_count-1; i>=0; i-- ) {
+		pipeline_stage_t* stage = &pipeline->stages[pipeline->order[i]];
+		const bool rt = (stage->decl.sched == PIPELINE_SCHED_RT);
+		if( RET_SUCCESS != thread_create(
+				stage->thread_name,
+				&stage->td,
+				pipeline_stage_run,
+				stage,
+				rt ? SCHED_FIFO : SCHED_OTHER,
+				rt ? thread_get_max_priority(SCHED_FIFO) - stage->decl.priority_offset : -1,
+				stage->decl.cpu
+		) ) {
+			log_error( "pipeline: failed to start '%s'\n", stage->thread_name );
+			return RET_FAILURE;
+		}
+		stage->started = true;
+	}
+	for( uint i=0; i<pipeline->stage_count; i++ ) {
+		sem_wait_nointr( &pipeline->running_sem );
+	}
+	pipeline->running = true;
+	return RET_SUCCESS;
+}
+
+void pipeline_stop(
+		pipeline_t* pipeline
+)
+{
+	for( uint i=0; i<pipeline->stage_count; i++ ) {
+		pipeline_stage_t* stage = &pipeline->stages[i];
+		if( pipeline_is_source( stage ) && stage->decl.stop != NULL ) {
+			stage->decl.stop( stage->decl.arg );
+		}
+	}
+}
+
+ret_t pipeline_wait(
+		pipeline_t* pipeline
+)
+{
+	ret_t ret = RET_SUCCESS;
+	// (if the start failed, only drain the started stages)
+	if( pipeline->running ) {
+		sem_wait_nointr( &pipeline->finished );
+	}
+	pipeline_stop( pipeline );
+	for( uint i=0; i<pipeline->stage_count; i++ ) {
+		const uint index = pipeline->order[i];
+		pipeline_stage_t* stage = &pipeline->stages[index];
+		if( stage->started ) {
+			log_verbose( "pipeline: wait for %s\n", stage->thread_name );
+			if( RET_SUCCESS != thread_join_ret( stage->td ) ) {
+				ret = RET_FAILURE;
+			}
+			stage->started = false;
+		}
+		// no more input for the consumers:
+		for( uint q=0; q<pipeline->queue_count; q++ ) {
+			pipeline_queue_t* queue = &pipeline->queues[q];
+			if( queue->producer == (int )index && queue->close != NULL ) {
+				queue->close( queue->queue );
+			}
+		}
+	}
+	return ret;
+}
+
+/************************
+ * private utils impl
+*************************/
+
+void* pipeline_stage_run(
+		void* arg
+)
+{
+	pipeline_stage_t* stage = arg;
+	sem_post( stage->running );
+	stage->ret = stage->decl.run( stage->decl.arg, stage->decl.deadline_us );
+	sem_post( stage->finished );
+	return &stage->ret;
+}
+
+int pipeline_find_queue(
+		pipeline_t* pipeline,
+		const void* queue
+)
+{
+	for( uint i=0; i<pipeline->queue_count; i++ ) {
+		if( pipeline->queues[i].queue == queue ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+ret_t pipeline_sort(
+		pipeline_t* pipeline
+)
+{
+	uint in_degree[PIPELINE_MAX_STAGES] = { 0 };
+	for( uint q=0; q<pipeline->queue_count; q++ ) {
+		const pipeline_queue_t* queue = &pipeline->queues[q];
+		if( queue->producer != -1 && queue->consumer != -1 ) {
+			in_degree[queue->consumer]++;
+		}
+	}
+	uint count = 0;
+	bool sorted[PIPELINE_MAX_STAGES] = { false };
+	while( count < pipeline->stage_count ) {
+		bool progress = false;
+		for( uint i=0; i<pipeline->stage_count; i++ ) {
+			if( sorted[i] || in_degree[i] > 0 ) {
+				continue;
+			}
+			sorted[i] = true;
+			pipeline->order[count] = i;
+			count++;
+			progress = true;
+			for( uint q=0; q<pipeline->queue_count; q++ ) {
+				const pipeline_queue_t* queue = &pipeline->queues[q];
+				if( queue->producer == (int )i && queue->consumer != -1 ) {
+					in_degree[queue->consumer]--;
+				}
+			}
+		}
+		if( !progress ) {
+			log_error( "pipeline: stages form a cycle\n" );
+			return RET_FAILURE;
+		}
+	}
+	return RET_SUCCESS;
+}
+
+bool pipeline_is_source(
+		const pipeline_stage_t* stage
+)
+{
+	return stage->decl.inputs[0] == NULL;
+}
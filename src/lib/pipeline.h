@@ -0,0 +1,144 @@
+/****************************
+ * Pipeline Graph
+ *
+ * stages (one thread each) connected by
+ * single producer / single consumer queues.
+ * Stages declare their input and output queues,
+ * scheduling class and deadline. The pipeline
+ * orders them topologically, starts them
+ * (consumers first) and drains them:
+ *
+ * - 'pipeline_stop' asks all source stages
+ *   (no inputs) to stop producing
+ * - 'pipeline_wait' waits until any stage returns,
+ *   stops the sources and joins the stages
+ *   in topological order. After a stage has been
+ *   joined its output queues are closed, so
+ *   the consumers process all remaining entries
+ *   and return.
+ *
+ * Queues are only referenced by pointer,
+ * 'close' must make the consumer return
+ * once the queue is empty
+ * (e.g. 'NAME_set_should_stop' of an spsc queue).
+ ***************************/
+#pragma once
+
+#include "global.h"
+#include "time.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+
+
+#define PIPELINE_MAX_STAGES 16
+#define PIPELINE_MAX_QUEUES 16
+#define PIPELINE_MAX_PORTS 4
+
+/********************
+ * Types
+********************/
+
+typedef ret_t (*pipeline_run_func_t)(void* arg, const USEC deadline_us);
+typedef void (*pipeline_stop_func_t)(void* arg);
+typedef void (*pipeline_close_func_t)(void* queue);
+
+typedef enum {
+	PIPELINE_SCHED_RT, // SCHED_FIFO
+	PIPELINE_SCHED_BEST_EFFORT, // SCHED_OTHER
+} pipeline_sched_t;
+
+typedef struct {
+	const char* name;
+	pipeline_run_func_t run;
+	// sources only, may be NULL:
+	pipeline_stop_func_t stop;
+	void* arg;
+	pipeline_sched_t sched;
+	// PIPELINE_SCHED_RT only,
+	// below the maximum priority:
+	int priority_offset;
+	int cpu; // -1: no affinity
+	USEC deadline_us;
+	// registered queues, NULL terminated:
+	void* inputs[PIPELINE_MAX_PORTS];
+	void* outputs[PIPELINE_MAX_PORTS];
+} pipeline_stage_decl_t;
+
+typedef struct {
+	pipeline_stage_decl_t decl;
+	char thread_name[16];
+	pthread_t td;
+	ret_t ret;
+	bool started;
+	sem_t* running;
+	sem_t* finished;
+} pipeline_stage_t;
+
+typedef struct {
+	const char* name;
+	void* queue;
+	// NULL: drained outside of the pipeline:
+	pipeline_close_func_t close;
+	// stage indices (-1: none):
+	int producer;
+	int consumer;
+} pipeline_queue_t;
+
+typedef struct {
+	char suffix[8]; // appended to thread names
+	pipeline_stage_t stages[PIPELINE_MAX_STAGES];
+	uint stage_count;
+	pipeline_queue_t queues[PIPELINE_MAX_QUEUES];
+	uint queue_count;
+	// stage indices, topologically sorted:
+	uint order[PIPELINE_MAX_STAGES];
+	// posted by every stage thread when it starts:
+	sem_t running_sem;
+	// posted whenever a stage returns:
+	sem_t finished;
+	// all stages have been started:
+	bool running;
+} pipeline_t;
+
+/********************
+ * Functions
+********************/
+
+void pipeline_init(
+		pipeline_t* pipeline,
+		const char* suffix
+);
+
+void pipeline_exit(
+		pipeline_t* pipeline
+);
+
+ret_t pipeline_add_queue(
+		pipeline_t* pipeline,
+		const char* name,
+		void* queue,
+		pipeline_close_func_t close
+);
+
+ret_t pipeline_add_stage(
+		pipeline_t* pipeline,
+		const pipeline_stage_decl_t decl
+);
+
+// check the graph and start all stages.
+// returns when all stage threads are running:
+ret_t pipeline_start(
+		pipeline_t* pipeline
+);
+
+// may be called from a signal handler,
+// if the stop functions allow it:
+void pipeline_stop(
+		pipeline_t* pipeline
+);
+
+// RET_FAILURE if any stage failed:
+ret_t pipeline_wait(
+		pipeline_t* pipeline
+);
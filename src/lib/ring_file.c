@@ -0,0 +1,299 @@
+#include "ring_file.h"
+
+#include "output.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/************************
+ * private utils decl
+*************************/
+
+size_t ring_file_round_up(
+		const size_t size,
+		const size_t alignment
+);
+
+bool ring_file_header_matches(
+		const ring_file_header_t* header,
+		const ring_file_header_t* expected
+);
+
+// wait for the frames written so far,
+// then copy the index into the file.
+// 'invalidate': drop the entries of the
+// slots overwritten during the next two batches
+ret_t ring_file_write_index(
+		ring_file_t* ring_file,
+		const bool invalidate
+);
+
+// start writeback of a range without waiting for it:
+void ring_file_flush_async(
+		ring_file_t* ring_file,
+		const size_t offset,
+		const size_t size
+);
+
+/************************
+ * API implementation
+*************************/
+
+ret_t ring_file_init(
+		ring_file_t* ring_file,
+		const char* path,
+		const output_format_t format,
+		const uint width,
+		const uint height,
+		const uint slot_count
+)
+{
+	(*ring_file) = (ring_file_t){
+		.fd = -1,
+		.map = NULL,
+		.map_size = 0,
+		.index_buffer = NULL,
+		.index_size = 0,
+		.header = NULL,
+		.index = NULL,
+		.batch_size = 1,
+		.batch_count = 0,
+	};
+	if( slot_count == 0 ) {
+		log_error( "ring_file: slot count must be > 0\n" );
+		return RET_FAILURE;
+	}
+	// (slots and index entries have no frame size)
+	if( format == OUTPUT_FORMAT_JPEG ) {
+		log_error( "ring_file: variable size frames not supported\n" );
+		return RET_FAILURE;
+	}
+	const size_t page_size = sysconf( _SC_PAGESIZE );
+	const size_t frame_size = image_output_size( format, width, height );
+	const size_t slot_size = ring_file_round_up( frame_size, page_size );
+	const size_t data_offset = ring_file_round_up(
+			sizeof(ring_file_header_t) + slot_count * sizeof(ring_file_index_entry_t),
+			page_size
+	);
+	ring_file_header_t expected_header = {
+		.magic = RING_FILE_MAGIC,
+		.version = RING_FILE_VERSION,
+		.format = format,
+		.width = width,
+		.height = height,
+		.frame_size = frame_size,
+		.slot_size = slot_size,
+		.slot_count = slot_count,
+		.data_offset = data_offset,
+		.next_slot = 0,
+		.next_seq = 1,
+	};
+	ring_file->map_size = data_offset + slot_count * slot_size;
+	ring_file->fd = open( path, O_RDWR | O_CREAT, 0644 );
+	if( ring_file->fd == -1 ) {
+		log_error("'%s': %s\n", path, strerror(errno));
+		return RET_FAILURE;
+	}
+	struct stat file_stat;
+	if( -1 == fstat( ring_file->fd, &file_stat ) ) {
+		log_error("'%s': 'fstat' failed: %s\n", path, strerror(errno));
+		close( ring_file->fd );
+		return RET_FAILURE;
+	}
+	const bool file_existed = (size_t )file_stat.st_size >= ring_file->map_size;
+	// reserve all blocks up front,
+	// so writing into the mapping never fails with ENOSPC:
+	if( -1 == fallocate( ring_file->fd, 0, 0, ring_file->map_size ) ) {
+		if( errno != EOPNOTSUPP || -1 == ftruncate( ring_file->fd, ring_file->map_size ) ) {
+			log_error("'%s': 'fallocate' failed: %s\n", path, strerror(errno));
+			close( ring_file->fd );
+			return RET_FAILURE;
+		}
+	}
+	ring_file->map = mmap(
+			NULL,
+			ring_file->map_size,
+			PROT_READ | PROT_WRITE,
+			MAP_SHARED,
+			ring_file->fd,
+			0
+	);
+	if( ring_file->map == MAP_FAILED ) {
+		log_error("'%s': 'mmap' failed: %s\n", path, strerror(errno));
+		ring_file->map = NULL;
+		close( ring_file->fd );
+		return RET_FAILURE;
+	}
+	ring_file->index_size = data_offset;
+	CALLOC( ring_file->index_buffer, data_offset, 1 );
+	ring_file->header = (ring_file_header_t* )ring_file->index_buffer;
+	ring_file->index = (ring_file_index_entry_t* )(ring_file->index_buffer + sizeof(ring_file_header_t));
+	// (two batches in flight must not cover the whole ring)
+	ring_file->batch_size = MAX( 1, MIN( RING_FILE_MAX_BATCH_SIZE, slot_count / 4 ) );
+	const ring_file_header_t* file_header = (const ring_file_header_t* )ring_file->map;
+	if(
+			file_existed
+			&& ring_file_header_matches( file_header, &expected_header )
+			&& file_header->next_slot < slot_count
+	) {
+		memcpy( ring_file->index_buffer, ring_file->map, data_offset );
+		log_verbose( "ring_file: '%s': continuing after frame seq %llu\n",
+				path,
+				(unsigned long long )(ring_file->header->next_seq - 1)
+		);
+	}
+	else {
+		// new file (or incompatible one): start empty
+		(*ring_file->header) = expected_header;
+	}
+	// the slots overwritten first must not be
+	// referenced by the index on disk anymore:
+	if(
+			RET_SUCCESS != ring_file_write_index( ring_file, true )
+			|| -1 == fdatasync( ring_file->fd )
+	) {
+		log_error("'%s': writing index failed: %s\n", path, strerror(errno));
+		ring_file_exit( ring_file );
+		return RET_FAILURE;
+	}
+	madvise( ring_file->map + data_offset, ring_file->map_size - data_offset, MADV_SEQUENTIAL );
+	return RET_SUCCESS;
+}
+
+ret_t ring_file_exit(
+		ring_file_t* ring_file
+)
+{
+	ret_t ret = RET_SUCCESS;
+	if( ring_file->map != NULL ) {
+		if( RET_SUCCESS != ring_file_write_index( ring_file, false ) ) {
+			ret = RET_FAILURE;
+		}
+		if( -1 == msync( ring_file->map, ring_file->map_size, MS_SYNC ) ) {
+			log_error( "ring_file: 'msync' failed: %s\n", strerror(errno) );
+			ret = RET_FAILURE;
+		}
+		if( -1 == munmap( ring_file->map, ring_file->map_size ) ) {
+			log_error( "ring_file: 'munmap' failed: %s\n", strerror(errno) );
+			ret = RET_FAILURE;
+		}
+		ring_file->map = NULL;
+	}
+	FREE( ring_file->index_buffer );
+	ring_file->header = NULL;
+	ring_file->index = NULL;
+	if( ring_file->fd != -1 ) {
+		if( -1 == close( ring_file->fd ) ) {
+			log_error( "ring_file: 'close' failed: %s\n", strerror(errno) );
+			ret = RET_FAILURE;
+		}
+		ring_file->fd = -1;
+	}
+	return ret;
+}
+
+ret_t ring_file_write_frame(
+		ring_file_t* ring_file,
+		const uint64_t frame_number,
+		const timeval_t* time,
+		const void* buffer,
+		const size_t buffer_size
+)
+{
+	ring_file_header_t* header = ring_file->header;
+	if( buffer_size < header->frame_size ) {
+		log_error( "ring_file: buffer size too small!\n" );
+		return RET_FAILURE;
+	}
+	const uint64_t slot = header->next_slot;
+	const size_t slot_offset = header->data_offset + slot * header->slot_size;
+	memcpy( ring_file->map + slot_offset, buffer, header->frame_size );
+	ring_file->index[slot] = (ring_file_index_entry_t){
+		.seq = header->next_seq,
+		.frame_number = frame_number,
+		.time_sec = time->tv_sec,
+		.time_nsec = time->tv_nsec,
+	};
+	header->next_seq++;
+	header->next_slot = (slot + 1) % header->slot_count;
+	// writeback in the background:
+	ring_file_flush_async( ring_file, slot_offset, header->slot_size );
+	ring_file->batch_count++;
+	if( ring_file->batch_count >= ring_file->batch_size ) {
+		return ring_file_write_index( ring_file, true );
+	}
+	return RET_SUCCESS;
+}
+
+/************************
+ * private utils impl
+*************************/
+
+size_t ring_file_round_up(
+		const size_t size,
+		const size_t alignment
+)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+bool ring_file_header_matches(
+		const ring_file_header_t* header,
+		const ring_file_header_t* expected
+)
+{
+	return (
+			!memcmp( header->magic, expected->magic, sizeof(header->magic) )
+			&& header->version == expected->version
+			&& header->format == expected->format
+			&& header->width == expected->width
+			&& header->height == expected->height
+			&& header->frame_size == expected->frame_size
+			&& header->slot_size == expected->slot_size
+			&& header->slot_count == expected->slot_count
+			&& header->data_offset == expected->data_offset
+	);
+}
+
+ret_t ring_file_write_index(
+		ring_file_t* ring_file,
+		const bool invalidate
+)
+{
+	// frames of this batch (and the last index) on disk:
+	if( -1 == fdatasync( ring_file->fd ) ) {
+		log_error( "ring_file: 'fdatasync' failed: %s\n", strerror(errno) );
+		return RET_FAILURE;
+	}
+	// (the last index write has completed,
+	// so this does not block on its writeback)
+	memcpy( ring_file->map, ring_file->index_buffer, ring_file->index_size );
+	if( invalidate ) {
+		ring_file_index_entry_t* file_index = (ring_file_index_entry_t* )(ring_file->map + sizeof(ring_file_header_t));
+		const uint64_t slot_count = ring_file->header->slot_count;
+		const uint64_t count = MIN( 2 * ring_file->batch_size, slot_count );
+		for( uint64_t i=0; i<count; i++ ) {
+			file_index[ (ring_file->header->next_slot + i) % slot_count ].seq = 0;
+		}
+	}
+	ring_file->batch_count = 0;
+	ring_file_flush_async( ring_file, 0, ring_file->index_size );
+	return RET_SUCCESS;
+}
+
+void ring_file_flush_async(
+		ring_file_t* ring_file,
+		const size_t offset,
+		const size_t size
+)
+{
+	if( -1 == sync_file_range( ring_file->fd, offset, size, SYNC_FILE_RANGE_WRITE ) ) {
+		// e.g. not supported by the filesystem:
+		msync( ring_file->map + offset, size, MS_ASYNC );
+	}
+}
@@ -0,0 +1,114 @@
+/****************************
+ * Memory Mapped Ring File
+ *
+ * a preallocated file, mapped into memory,
+ * used as a circular log of frames.
+ * Writing a frame is a memcpy into the mapping,
+ * writeback to disk is started asynchronously.
+ *
+ * File layout (all offsets page aligned):
+ *   [ ring_file_header_t | ring_file_index_entry_t[slot_count] ]
+ *   [ slot 0 ]
+ *   ...
+ *   [ slot slot_count-1 ]
+ *
+ * The index (header + entries) is kept in memory
+ * and written to the file in batches: every
+ * 'batch_size' frames, after the data of the batch
+ * has reached the disk ('fdatasync'), so the index
+ * on disk never refers to a frame that has not been
+ * written completely. The entries of the slots
+ * overwritten during the next two batches are
+ * invalidated (seq == 0) in the same write, so a
+ * slot is only overwritten when the index on disk
+ * does not refer to it anymore.
+ * Frames written after the last batch are lost on
+ * a crash or power loss, all others survive.
+ * Opening an existing ring file with the same
+ * geometry continues after the newest frame,
+ * so a restart does not overwrite the history.
+ ***************************/
+#pragma once
+
+#include "global.h"
+#include "image.h"
+#include "time.h"
+
+#include <stdint.h>
+
+
+#define RING_FILE_MAGIC "SYNCRING"
+#define RING_FILE_VERSION 1
+// max. number of frames per index write:
+#define RING_FILE_MAX_BATCH_SIZE 16
+
+/********************
+ * Types
+********************/
+
+// on disk:
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t format; // output_format_t
+	uint32_t width;
+	uint32_t height;
+	uint64_t frame_size;
+	uint64_t slot_size;
+	uint64_t slot_count;
+	uint64_t data_offset; // offset of slot 0
+	uint64_t next_slot;
+	uint64_t next_seq;
+} ring_file_header_t;
+
+// on disk:
+typedef struct {
+	uint64_t seq; // 0: empty / about to be overwritten
+	uint64_t frame_number;
+	int64_t time_sec;
+	int64_t time_nsec;
+} ring_file_index_entry_t;
+
+typedef struct {
+	int fd;
+	byte_t* map;
+	size_t map_size;
+	// index, as written to the file:
+	byte_t* index_buffer;
+	size_t index_size;
+	ring_file_header_t* header;
+	ring_file_index_entry_t* index;
+	uint batch_size;
+	uint batch_count; // frames since the last index write
+} ring_file_t;
+
+/********************
+ * Functions
+********************/
+
+// create (or reopen) and map the ring file:
+ret_t ring_file_init(
+		ring_file_t* ring_file,
+		const char* path,
+		const output_format_t format,
+		const uint width,
+		const uint height,
+		const uint slot_count
+);
+
+// flushes and unmaps the file
+ret_t ring_file_exit(
+		ring_file_t* ring_file
+);
+
+// copy frame into the next slot
+// (overwriting the oldest one).
+// Every 'batch_size' frames, waits for
+// the batch and writes the index
+ret_t ring_file_write_frame(
+		ring_file_t* ring_file,
+		const uint64_t frame_number,
+		const timeval_t* time,
+		const void* buffer,
+		const size_t buffer_size
+);
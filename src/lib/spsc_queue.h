@@ -2,11 +2,26 @@
  * Single Producer -
  * Single Consumer -
  * Blocking - Queue
+ *
+ * Batch API ('push_n' / 'read_n'):
+ * reserve or consume a span of entries
+ * contiguous in memory with one blocking wait,
+ * the rest of the batch is taken without blocking.
+ *
+ * The consumer waits according to a
+ * wait strategy (default: block, see "wait.h").
+ * Whenever it had to wait, the time from the
+ * push of the entry until the consumer runs
+ * is recorded in the wake latency histogram.
  ***************************/
 #pragma once
 
 #include "global.h"
 #include "semaphore.h"
+#include "wait.h"
+#include "histogram.h"
+
+#include <stdint.h>
 
 
 #define DECL_SPSC_QUEUE(NAME,ENTRY_T) \
@@ -20,6 +35,14 @@ typedef struct { \
 	sem_t write_sem; \
 	bool stop; \
 	_Atomic int count; \
+	/* statistics (written by the producer): */ \
+	_Atomic uint64_t push_count; \
+	int peak_count; \
+	/* written by the consumer: */ \
+	uint64_t read_count; \
+	wait_config_t wait_config; \
+	histogram_t wake_latency; /* ns */ \
+	uint64_t* push_times; /* ns, per entry */ \
 } NAME##_t; \
  \
 void NAME##_init( \
@@ -38,6 +61,26 @@ uint NAME##_get_count( \
 		NAME##_t* queue \
 ); \
  \
+/* number of entries pushed so far: */ \
+uint64_t NAME##_get_push_count( \
+		NAME##_t* queue \
+); \
+ \
+/* max number of entries in the queue so far: */ \
+uint NAME##_get_peak_count( \
+		NAME##_t* queue \
+); \
+ \
+/* call before the consumer starts: */ \
+void NAME##_set_wait_config( \
+		NAME##_t* queue, \
+		const wait_config_t config \
+); \
+ \
+const histogram_t* NAME##_get_wake_latency( \
+		NAME##_t* queue \
+); \
+ \
 bool NAME##_get_should_stop( \
 		const NAME##_t* queue \
 ); \
@@ -69,6 +112,34 @@ void NAME##_push_start( \
  \
 void NAME##_push_end( \
 		NAME##_t* queue \
+); \
+ \
+/* wait for at least one entry, then reserve up to \
+   'max_n' entries '(*entries)[0..n-1]'. \
+   returns n, 0 if the queue has been stopped \
+   and is empty: */ \
+uint NAME##_read_n_start( \
+		NAME##_t* queue, \
+		const uint max_n, \
+		ENTRY_T** entries \
+); \
+ \
+void NAME##_read_n_stop_dump( \
+		NAME##_t* queue, \
+		const uint n \
+); \
+ \
+/* wait for at least one free slot, then reserve up to \
+   'max_n' slots '(*entries)[0..n-1]', returns n: */ \
+uint NAME##_push_n_start( \
+		NAME##_t* queue, \
+		const uint max_n, \
+		ENTRY_T** entries \
+); \
+ \
+void NAME##_push_n_end( \
+		NAME##_t* queue, \
+		const uint n \
 );
 
 /*****************
@@ -88,6 +159,13 @@ void NAME##_init( \
 	queue->read_pos = 0; \
 	queue->write_pos = 0; \
 	queue->count = 0; \
+	queue->push_count = 0; \
+	queue->peak_count = 0; \
+	queue->read_count = 0; \
+	queue->wait_config = (wait_config_t){ .strategy = WAIT_BLOCK }; \
+	histogram_init( &queue->wake_latency ); \
+	queue->push_times = NULL; \
+	CALLOC( queue->push_times, queue->max_count, sizeof(uint64_t) ); \
 	if( 0 != sem_init( &queue->read_sem, 0, 0 ) ) { \
 		ERR_LOG( "%s_t: 'sem_init' failed: %s\n", #NAME, strerror( errno )); \
 	} \
@@ -108,6 +186,7 @@ void NAME##_exit( \
 		ERR_LOG( "%s_t: 'sem_destroy' failed: %s\n", #NAME, strerror(errno) ); \
 	} \
 	FREE( queue->entries ); \
+	FREE( queue->push_times ); \
 	queue->max_count = 0; \
 } \
  \
@@ -125,6 +204,53 @@ uint NAME##_get_count( \
 	return queue->count; \
 } \
  \
+uint64_t NAME##_get_push_count( \
+		NAME##_t* queue \
+) \
+{ \
+	return queue->push_count; \
+} \
+ \
+uint NAME##_get_peak_count( \
+		NAME##_t* queue \
+) \
+{ \
+	return queue->peak_count; \
+} \
+ \
+void NAME##_set_wait_config( \
+		NAME##_t* queue, \
+		const wait_config_t config \
+) \
+{ \
+	queue->wait_config = config; \
+} \
+ \
+const histogram_t* NAME##_get_wake_latency( \
+		NAME##_t* queue \
+) \
+{ \
+	return &queue->wake_latency; \
+} \
+ \
+/* consumer side, after waiting for 'read_sem': */ \
+void NAME##_wait_readable( \
+		NAME##_t* queue, \
+		const char* caller \
+) \
+{ \
+	bool waited = false; \
+	if( sem_wait_config( &queue->read_sem, &queue->wait_config, &waited ) ) { \
+		ERR_LOG( "%s: 'sem_wait' failed: %s\n!", caller, strerror( errno ) ); \
+	} \
+	/* (no entry, if woken up by 'set_should_stop') */ \
+	if( waited && queue->push_count > queue->read_count ) { \
+		const uint64_t push_time = queue->push_times[queue->read_pos]; \
+		const uint64_t now = wait_time_ns(); \
+		histogram_add( &queue->wake_latency, (now > push_time) ? (now - push_time) : 0 ); \
+	} \
+} \
+ \
 bool NAME##_get_should_stop( \
 		const NAME##_t* queue \
 ) \
@@ -146,9 +272,7 @@ void NAME##_read_start( \
 		NAME##_t* queue \
 ) \
 { \
-	if( sem_wait_nointr( &queue->read_sem ) ) { \
-		ERR_LOG( "%s_read_start: 'sem_wait' failed: %s\n!", #NAME, strerror( errno ) ); \
-	} \
+	NAME##_wait_readable( queue, #NAME "_read_start" ); \
 } \
  \
 ENTRY_T* NAME##_read_get( \
@@ -173,6 +297,7 @@ void NAME##_read_stop_dump( \
 ) \
 { \
 	queue->read_pos = (queue->read_pos + 1) % queue->max_count; \
+	queue->read_count++; \
 	if( sem_post( &queue->write_sem ) ) { \
 		ERR_LOG( "%s_read_stop_dump: 'sem_post' failed: %s\n", #NAME, strerror( errno ) ); \
 	} \
@@ -188,7 +313,8 @@ void NAME##_push_start( \
 	if( sem_wait( &queue->write_sem ) ) { \
 		ERR_LOG( "%s_push_start: 'sem_wait' failed: %s\n", #NAME, strerror( errno ) ); \
 	} \
-	queue->count++; \
+	const int count = ++queue->count; \
+	queue->peak_count = MAX( queue->peak_count, count ); \
 	DBG_LOG( "%s_t: %d/%d\n", #NAME, queue->count, queue->max_count); \
 	(*entry) = &queue->entries[queue->write_pos]; \
 } \
@@ -197,8 +323,91 @@ void NAME##_push_end( \
 		NAME##_t* queue \
 ) \
 { \
+	queue->push_times[queue->write_pos] = wait_time_ns(); \
 	queue->write_pos = (queue->write_pos+1) % queue->max_count; \
+	queue->push_count++; \
 	if( sem_post( &queue->read_sem ) ) { \
 		ERR_LOG( "%s_push_end: 'sem_post' failed: %s\n", #NAME, strerror( errno ) ); \
 	} \
+} \
+ \
+uint NAME##_read_n_start( \
+		NAME##_t* queue, \
+		const uint max_n, \
+		ENTRY_T** entries \
+) \
+{ \
+	assert( max_n > 0 ); \
+	NAME##_wait_readable( queue, #NAME "_read_n_start" ); \
+	const uint limit = MIN( max_n, queue->max_count - queue->read_pos ); \
+	uint tokens = 1; \
+	while( tokens < limit && 0 == sem_trywait( &queue->read_sem ) ) { \
+		tokens++; \
+	} \
+	/* one token may be the stop signal, \
+	   give it back for the next call: */ \
+	const uint n = MIN( tokens, (uint )(queue->push_count - queue->read_count) ); \
+	for( uint i=n; i<tokens; i++ ) { \
+		if( sem_post( &queue->read_sem ) ) { \
+			ERR_LOG( "%s_read_n_start: 'sem_post' failed: %s\n", #NAME, strerror( errno ) ); \
+		} \
+	} \
+	(*entries) = &queue->entries[queue->read_pos]; \
+	return n; \
+} \
+ \
+void NAME##_read_n_stop_dump( \
+		NAME##_t* queue, \
+		const uint n \
+) \
+{ \
+	queue->read_pos = (queue->read_pos + n) % queue->max_count; \
+	queue->read_count += n; \
+	queue->count -= n; \
+	for( uint i=0; i<n; i++ ) { \
+		if( sem_post( &queue->write_sem ) ) { \
+			ERR_LOG( "%s_read_n_stop_dump: 'sem_post' failed: %s\n", #NAME, strerror( errno ) ); \
+		} \
+	} \
+	DBG_LOG( "%s_t: %d/%d\n", #NAME, queue->count, queue->max_count); \
+} \
+ \
+uint NAME##_push_n_start( \
+		NAME##_t* queue, \
+		const uint max_n, \
+		ENTRY_T** entries \
+) \
+{ \
+	assert( max_n > 0 ); \
+	if( sem_wait_nointr( &queue->write_sem ) ) { \
+		ERR_LOG( "%s_push_n_start: 'sem_wait' failed: %s\n", #NAME, strerror( errno ) ); \
+	} \
+	const uint limit = MIN( max_n, queue->max_count - queue->write_pos ); \
+	uint n = 1; \
+	while( n < limit && 0 == sem_trywait( &queue->write_sem ) ) { \
+		n++; \
+	} \
+	const int count = (queue->count += n); \
+	queue->peak_count = MAX( queue->peak_count, count ); \
+	DBG_LOG( "%s_t: %d/%d\n", #NAME, queue->count, queue->max_count); \
+	(*entries) = &queue->entries[queue->write_pos]; \
+	return n; \
+} \
+ \
+void NAME##_push_n_end( \
+		NAME##_t* queue, \
+		const uint n \
+) \
+{ \
+	const uint64_t push_time = wait_time_ns(); \
+	for( uint i=0; i<n; i++ ) { \
+		queue->push_times[queue->write_pos + i] = push_time; \
+	} \
+	queue->write_pos = (queue->write_pos+n) % queue->max_count; \
+	queue->push_count += n; \
+	for( uint i=0; i<n; i++ ) { \
+		if( sem_post( &queue->read_sem ) ) { \
+			ERR_LOG( "%s_push_n_end: 'sem_post' failed: %s\n", #NAME, strerror( errno ) ); \
+		} \
+	} \
 }
@@ -0,0 +1,56 @@
+#include "wait.h"
+
+#include <string.h>
+
+
+#define CALIBRATION_POLLS 100000
+
+uint64_t wait_calibrate_spin_count(
+		const uint spin_us
+)
+{
+	// poll a semaphore that never becomes available:
+	sem_t sem;
+	sem_init( &sem, 0, 0 );
+	const uint64_t start = wait_time_ns();
+	for( uint i=0; i<CALIBRATION_POLLS; i++ ) {
+		cpu_relax();
+		sem_trywait( &sem );
+	}
+	const uint64_t end = wait_time_ns();
+	const uint64_t duration_ns = MAX( end - start, 1 );
+	sem_destroy( &sem );
+	return (uint64_t )spin_us * 1000 * CALIBRATION_POLLS / duration_ns;
+}
+
+const char* wait_strategy_str(
+		const wait_strategy_t strategy
+)
+{
+	switch( strategy ) {
+		case WAIT_BLOCK: return "block";
+		case WAIT_SPIN: return "spin";
+		case WAIT_SPIN_THEN_BLOCK: return "spin-block";
+	}
+	return "unknown";
+}
+
+ret_t wait_strategy_from_str(
+		const char* str,
+		wait_strategy_t* strategy
+)
+{
+	if( !strcmp( str, "block" ) ) {
+		(*strategy) = WAIT_BLOCK;
+	}
+	else if( !strcmp( str, "spin" ) ) {
+		(*strategy) = WAIT_SPIN;
+	}
+	else if( !strcmp( str, "spin-block" ) ) {
+		(*strategy) = WAIT_SPIN_THEN_BLOCK;
+	}
+	else {
+		return RET_FAILURE;
+	}
+	return RET_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/****************************
+ * Wait Strategies
+ *
+ * how a consumer waits on the semaphore
+ * of its queue:
+ * - WAIT_BLOCK: 'sem_wait', the cpu is free
+ *   for other threads, but every wakeup goes
+ *   through the scheduler (futex)
+ * - WAIT_SPIN: poll, 'cpu_relax' between polls.
+ *   Never sleeps, only for threads with
+ *   a dedicated (isolated) cpu
+ * - WAIT_SPIN_THEN_BLOCK: poll for a calibrated
+ *   number of iterations, then block
+ ***************************/
+#pragma once
+
+#include "global.h"
+#include "semaphore.h"
+
+#include <stdint.h>
+#include <time.h>
+
+
+/********************
+ * Types
+********************/
+
+typedef enum {
+	WAIT_BLOCK,
+	WAIT_SPIN,
+	WAIT_SPIN_THEN_BLOCK,
+} wait_strategy_t;
+
+typedef struct {
+	wait_strategy_t strategy;
+	// WAIT_SPIN_THEN_BLOCK only,
+	// see 'wait_calibrate_spin_count':
+	uint64_t spin_count;
+} wait_config_t;
+
+/********************
+ * Functions
+********************/
+
+// hint to the cpu that we are busy waiting
+// (saves power, frees resources for
+// the sibling hyperthread):
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__( "yield" ::: "memory" );
+#else
+	__asm__ __volatile__( "" ::: "memory" );
+#endif
+}
+
+static inline uint64_t wait_time_ns(void)
+{
+	struct timespec time;
+	clock_gettime( CLOCK_MONOTONIC, &time );
+	return (uint64_t )time.tv_sec * 1000 * 1000 * 1000 + time.tv_nsec;
+}
+
+// like 'sem_wait_nointr'.
+// '*waited': the semaphore was not
+// available immediately:
+static inline int sem_wait_config(
+		sem_t* sem,
+		const wait_config_t* config,
+		bool* waited
+)
+{
+	(*waited) = false;
+	if( 0 == sem_trywait( sem ) ) {
+		return 0;
+	}
+	(*waited) = true;
+	if( config->strategy != WAIT_BLOCK ) {
+		for(
+				uint64_t i=0;
+				config->strategy == WAIT_SPIN || i < config->spin_count;
+				i++
+		) {
+			cpu_relax();
+			if( 0 == sem_trywait( sem ) ) {
+				return 0;
+			}
+		}
+	}
+	return sem_wait_nointr( sem );
+}
+
+// number of polls in 'sem_wait_config'
+// taking about 'spin_us' on this machine:
+uint64_t wait_calibrate_spin_count(
+		const uint spin_us
+);
+
+const char* wait_strategy_str(
+		const wait_strategy_t strategy
+);
+
+// "block", "spin", "spin-block":
+ret_t wait_strategy_from_str(
+		const char* str,
+		wait_strategy_t* strategy
+);
@@ -0,0 +1,382 @@
+#include "zip_stream.h"
+
+#include "output.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+
+// output is collected in the stdio buffer
+// and written in big chunks:
+#define WRITE_BUFFER_SIZE (256*1024)
+#define DEFLATE_BUFFER_SIZE (64*1024)
+
+#define LOCAL_HEADER_SIGNATURE 0x04034b50
+#define DATA_DESCRIPTOR_SIGNATURE 0x08074b50
+#define CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define END_OF_CENTRAL_DIR_SIGNATURE 0x06054b50
+
+#define VERSION_NEEDED 20 // deflate
+#define VERSION_MADE_BY ((3 << 8) | VERSION_NEEDED) // unix
+// bit 3: sizes and CRC in data descriptor
+// bit 11: filename is UTF-8
+#define FLAGS ((1 << 3) | (1 << 11))
+#define METHOD_DEFLATE 8
+#define EXTERNAL_ATTR (0100644u << 16)
+
+/************************
+ * private utils decl
+*************************/
+
+ret_t zip_stream_write(
+		zip_stream_t* zip_stream,
+		const void* buffer,
+		const size_t buffer_size
+);
+
+// run deflate, write all output available:
+ret_t zip_stream_deflate(
+		zip_stream_t* zip_stream,
+		const int flush
+);
+
+ret_t zip_stream_free(
+		zip_stream_t* zip_stream
+);
+
+byte_t* put_u16(
+		byte_t* dst,
+		const uint16_t val
+);
+
+byte_t* put_u32(
+		byte_t* dst,
+		const uint32_t val
+);
+
+/************************
+ * API implementation
+*************************/
+
+ret_t zip_stream_open(
+		zip_stream_t* zip_stream,
+		const char* filename,
+		const uint max_entries,
+		const int compression_level
+)
+{
+	(*zip_stream) = (zip_stream_t){
+		.file = NULL,
+		.file_buffer = NULL,
+		.deflate_buffer = NULL,
+		.entries = NULL,
+		.max_entries = max_entries,
+		.entry_count = 0,
+		.entry_open = false,
+		.offset = 0,
+	};
+	{
+		const time_t now = time(NULL);
+		struct tm local_time;
+		localtime_r( &now, &local_time );
+		zip_stream->dos_time =
+			(local_time.tm_hour << 11)
+			| (local_time.tm_min << 5)
+			| (local_time.tm_sec / 2);
+		zip_stream->dos_date =
+			((MAX(local_time.tm_year, 80) - 80) << 9)
+			| ((local_time.tm_mon + 1) << 5)
+			| local_time.tm_mday;
+	}
+	if( Z_OK != deflateInit2(
+				&zip_stream->z_stream,
+				compression_level,
+				Z_DEFLATED,
+				-MAX_WBITS, // raw deflate, no zlib header
+				8,
+				Z_DEFAULT_STRATEGY
+	)) {
+		log_error( "'%s': 'deflateInit2' failed\n", filename );
+		return RET_FAILURE;
+	}
+	CALLOC( zip_stream->entries, max_entries, sizeof(zip_stream_entry_t) );
+	CALLOC( zip_stream->deflate_buffer, DEFLATE_BUFFER_SIZE, 1 );
+	CALLOC( zip_stream->file_buffer, WRITE_BUFFER_SIZE, 1 );
+	zip_stream->file = fopen( filename, "w" );
+	if( zip_stream->file == NULL ) {
+		log_error("'%s': %s\n", filename, strerror(errno));
+		zip_stream_free( zip_stream );
+		return RET_FAILURE;
+	}
+	if( 0 != setvbuf( zip_stream->file, zip_stream->file_buffer, _IOFBF, WRITE_BUFFER_SIZE ) ) {
+		log_error("'%s': 'setvbuf' failed\n", filename);
+	}
+	return RET_SUCCESS;
+}
+
+ret_t zip_stream_close(
+		zip_stream_t* zip_stream
+)
+{
+	if( zip_stream->file == NULL ) {
+		return RET_SUCCESS;
+	}
+	ret_t ret = RET_SUCCESS;
+	if( zip_stream->entry_open ) {
+		ret = zip_stream_entry_end( zip_stream );
+	}
+	// central directory:
+	const uint64_t central_dir_offset = zip_stream->offset;
+	for( uint i=0; i<zip_stream->entry_count && ret == RET_SUCCESS; i++ ) {
+		const zip_stream_entry_t* entry = &zip_stream->entries[i];
+		const uint16_t name_length = strlen( entry->name );
+		byte_t header[46];
+		byte_t* pos = header;
+		pos = put_u32( pos, CENTRAL_HEADER_SIGNATURE );
+		pos = put_u16( pos, VERSION_MADE_BY );
+		pos = put_u16( pos, VERSION_NEEDED );
+		pos = put_u16( pos, FLAGS );
+		pos = put_u16( pos, METHOD_DEFLATE );
+		pos = put_u16( pos, zip_stream->dos_time );
+		pos = put_u16( pos, zip_stream->dos_date );
+		pos = put_u32( pos, entry->crc );
+		pos = put_u32( pos, entry->compressed_size );
+		pos = put_u32( pos, entry->size );
+		pos = put_u16( pos, name_length );
+		pos = put_u16( pos, 0 ); // extra field length
+		pos = put_u16( pos, 0 ); // comment length
+		pos = put_u16( pos, 0 ); // disk number
+		pos = put_u16( pos, 0 ); // internal attributes
+		pos = put_u32( pos, EXTERNAL_ATTR );
+		pos = put_u32( pos, entry->offset );
+		if(
+				RET_SUCCESS != zip_stream_write( zip_stream, header, sizeof(header) )
+				|| RET_SUCCESS != zip_stream_write( zip_stream, entry->name, name_length )
+		) {
+			ret = RET_FAILURE;
+		}
+	}
+	if( ret == RET_SUCCESS ) {
+		if( zip_stream->offset > UINT32_MAX ) {
+			log_error( "zip archive too big (zip64 not supported)\n" );
+			ret = RET_FAILURE;
+		}
+	}
+	if( ret == RET_SUCCESS ) {
+		byte_t end_record[22];
+		byte_t* pos = end_record;
+		pos = put_u32( pos, END_OF_CENTRAL_DIR_SIGNATURE );
+		pos = put_u16( pos, 0 ); // disk number
+		pos = put_u16( pos, 0 ); // disk with central dir
+		pos = put_u16( pos, zip_stream->entry_count );
+		pos = put_u16( pos, zip_stream->entry_count );
+		pos = put_u32( pos, zip_stream->offset - central_dir_offset );
+		pos = put_u32( pos, central_dir_offset );
+		pos = put_u16( pos, 0 ); // comment length
+		ret = zip_stream_write( zip_stream, end_record, sizeof(end_record) );
+	}
+	if( RET_SUCCESS != zip_stream_free( zip_stream ) ) {
+		ret = RET_FAILURE;
+	}
+	return ret;
+}
+
+ret_t zip_stream_entry_start(
+		zip_stream_t* zip_stream,
+		const char* name
+)
+{
+	if( zip_stream->entry_open ) {
+		log_error( "zip entry still open\n" );
+		return RET_FAILURE;
+	}
+	if( zip_stream->entry_count >= zip_stream->max_entries ) {
+		log_error( "too many zip entries (max: %u)\n", zip_stream->max_entries );
+		return RET_FAILURE;
+	}
+	if( zip_stream->offset > UINT32_MAX ) {
+		log_error( "zip archive too big (zip64 not supported)\n" );
+		return RET_FAILURE;
+	}
+	const size_t name_length = strlen( name );
+	if( name_length >= ZIP_STREAM_NAME_MAX ) {
+		log_error( "zip entry name too long: '%s'\n", name );
+		return RET_FAILURE;
+	}
+	zip_stream_entry_t* entry = &zip_stream->entries[zip_stream->entry_count];
+	(*entry) = (zip_stream_entry_t){
+		.crc = crc32( 0, Z_NULL, 0 ),
+		.compressed_size = 0,
+		.size = 0,
+		.offset = zip_stream->offset,
+	};
+	strcpy( entry->name, name );
+	byte_t header[30];
+	byte_t* pos = header;
+	pos = put_u32( pos, LOCAL_HEADER_SIGNATURE );
+	pos = put_u16( pos, VERSION_NEEDED );
+	pos = put_u16( pos, FLAGS );
+	pos = put_u16( pos, METHOD_DEFLATE );
+	pos = put_u16( pos, zip_stream->dos_time );
+	pos = put_u16( pos, zip_stream->dos_date );
+	// crc and sizes follow in the data descriptor:
+	pos = put_u32( pos, 0 );
+	pos = put_u32( pos, 0 );
+	pos = put_u32( pos, 0 );
+	pos = put_u16( pos, name_length );
+	pos = put_u16( pos, 0 ); // extra field length
+	if(
+			RET_SUCCESS != zip_stream_write( zip_stream, header, sizeof(header) )
+			|| RET_SUCCESS != zip_stream_write( zip_stream, name, name_length )
+	) {
+		return RET_FAILURE;
+	}
+	if( Z_OK != deflateReset( &zip_stream->z_stream ) ) {
+		log_error( "'deflateReset' failed\n" );
+		return RET_FAILURE;
+	}
+	zip_stream->entry_open = true;
+	return RET_SUCCESS;
+}
+
+ret_t zip_stream_entry_write(
+		zip_stream_t* zip_stream,
+		const void* buffer,
+		const size_t buffer_size
+)
+{
+	if( !zip_stream->entry_open ) {
+		log_error( "no zip entry open\n" );
+		return RET_FAILURE;
+	}
+	zip_stream_entry_t* entry = &zip_stream->entries[zip_stream->entry_count];
+	if( (uint64_t )entry->size + buffer_size > UINT32_MAX ) {
+		log_error( "zip entry too big (zip64 not supported)\n" );
+		return RET_FAILURE;
+	}
+	entry->crc = crc32( entry->crc, buffer, buffer_size );
+	entry->size += buffer_size;
+	zip_stream->z_stream.next_in = (Bytef* )buffer;
+	zip_stream->z_stream.avail_in = buffer_size;
+	return zip_stream_deflate( zip_stream, Z_NO_FLUSH );
+}
+
+ret_t zip_stream_entry_end(
+		zip_stream_t* zip_stream
+)
+{
+	if( !zip_stream->entry_open ) {
+		log_error( "no zip entry open\n" );
+		return RET_FAILURE;
+	}
+	zip_stream_entry_t* entry = &zip_stream->entries[zip_stream->entry_count];
+	zip_stream->z_stream.next_in = Z_NULL;
+	zip_stream->z_stream.avail_in = 0;
+	if( RET_SUCCESS != zip_stream_deflate( zip_stream, Z_FINISH ) ) {
+		return RET_FAILURE;
+	}
+	byte_t descriptor[16];
+	byte_t* pos = descriptor;
+	pos = put_u32( pos, DATA_DESCRIPTOR_SIGNATURE );
+	pos = put_u32( pos, entry->crc );
+	pos = put_u32( pos, entry->compressed_size );
+	pos = put_u32( pos, entry->size );
+	if( RET_SUCCESS != zip_stream_write( zip_stream, descriptor, sizeof(descriptor) ) ) {
+		return RET_FAILURE;
+	}
+	zip_stream->entry_count++;
+	zip_stream->entry_open = false;
+	return RET_SUCCESS;
+}
+
+/************************
+ * private utils impl
+*************************/
+
+ret_t zip_stream_write(
+		zip_stream_t* zip_stream,
+		const void* buffer,
+		const size_t buffer_size
+)
+{
+	if( buffer_size != fwrite( buffer, 1, buffer_size, zip_stream->file ) ) {
+		log_error( "writing zip archive failed: %s\n", strerror(errno) );
+		return RET_FAILURE;
+	}
+	zip_stream->offset += buffer_size;
+	return RET_SUCCESS;
+}
+
+ret_t zip_stream_deflate(
+		zip_stream_t* zip_stream,
+		const int flush
+)
+{
+	zip_stream_entry_t* entry = &zip_stream->entries[zip_stream->entry_count];
+	z_stream* stream = &zip_stream->z_stream;
+	int z_ret;
+	do {
+		stream->next_out = zip_stream->deflate_buffer;
+		stream->avail_out = DEFLATE_BUFFER_SIZE;
+		z_ret = deflate( stream, flush );
+		if( z_ret == Z_STREAM_ERROR ) {
+			log_error( "'deflate' failed\n" );
+			return RET_FAILURE;
+		}
+		const size_t out_size = DEFLATE_BUFFER_SIZE - stream->avail_out;
+		if( (uint64_t )entry->compressed_size + out_size > UINT32_MAX ) {
+			log_error( "zip entry too big (zip64 not supported)\n" );
+			return RET_FAILURE;
+		}
+		if( RET_SUCCESS != zip_stream_write( zip_stream, zip_stream->deflate_buffer, out_size ) ) {
+			return RET_FAILURE;
+		}
+		entry->compressed_size += out_size;
+	} while(
+			stream->avail_out == 0
+			|| (flush == Z_FINISH && z_ret != Z_STREAM_END)
+	);
+	return RET_SUCCESS;
+}
+
+ret_t zip_stream_free(
+		zip_stream_t* zip_stream
+)
+{
+	ret_t ret = RET_SUCCESS;
+	if( zip_stream->file != NULL ) {
+		if( 0 != fclose( zip_stream->file ) ) {
+			log_error( "closing zip archive failed: %s\n", strerror(errno) );
+			ret = RET_FAILURE;
+		}
+		zip_stream->file = NULL;
+	}
+	deflateEnd( &zip_stream->z_stream );
+	FREE( zip_stream->file_buffer );
+	FREE( zip_stream->deflate_buffer );
+	FREE( zip_stream->entries );
+	return ret;
+}
+
+byte_t* put_u16(
+		byte_t* dst,
+		const uint16_t val
+)
+{
+	dst[0] = val & 0xff;
+	dst[1] = (val >> 8) & 0xff;
+	return dst + 2;
+}
+
+byte_t* put_u32(
+		byte_t* dst,
+		const uint32_t val
+)
+{
+	dst[0] = val & 0xff;
+	dst[1] = (val >> 8) & 0xff;
+	dst[2] = (val >> 16) & 0xff;
+	dst[3] = (val >> 24) & 0xff;
+	return dst + 4;
+}
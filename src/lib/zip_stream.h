@@ -0,0 +1,85 @@
+/****************************
+ * Streaming Zip Writer
+ *
+ * writes zip archives sequentially:
+ * entry data is deflated and written to disk
+ * while it is added, sizes and CRC follow
+ * in a data descriptor after the data.
+ * Only the central directory is kept in memory
+ * (one small record per entry, bounded by 'max_entries')
+ * and written when the archive is closed.
+ *
+ * Limitations: no zip64 (archive < 4 GiB)
+ ***************************/
+#pragma once
+
+#include "global.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zlib.h>
+
+
+#define ZIP_STREAM_NAME_MAX 256
+
+/********************
+ * Types
+********************/
+
+typedef struct {
+	char name[ZIP_STREAM_NAME_MAX];
+	uint32_t crc;
+	uint32_t compressed_size;
+	uint32_t size;
+	uint32_t offset; // of the local header
+} zip_stream_entry_t;
+
+typedef struct {
+	FILE* file;
+	char* file_buffer;
+	z_stream z_stream;
+	byte_t* deflate_buffer;
+	uint16_t dos_time;
+	uint16_t dos_date;
+	// central directory:
+	zip_stream_entry_t* entries;
+	uint max_entries;
+	uint entry_count;
+	bool entry_open;
+	// current file position:
+	uint64_t offset;
+} zip_stream_t;
+
+/********************
+ * Functions
+********************/
+
+ret_t zip_stream_open(
+		zip_stream_t* zip_stream,
+		const char* filename,
+		const uint max_entries,
+		const int compression_level // zlib level, e.g. Z_DEFAULT_COMPRESSION
+);
+
+// write central directory and close the file:
+ret_t zip_stream_close(
+		zip_stream_t* zip_stream
+);
+
+ret_t zip_stream_entry_start(
+		zip_stream_t* zip_stream,
+		const char* name
+);
+
+// append data to the current entry
+// (may be called multiple times):
+ret_t zip_stream_entry_write(
+		zip_stream_t* zip_stream,
+		const void* buffer,
+		const size_t buffer_size
+);
+
+ret_t zip_stream_entry_end(
+		zip_stream_t* zip_stream
+);
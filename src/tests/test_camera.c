@@ -5,6 +5,8 @@
 #include <linux/videodev2.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 
 #define CHECK_CAMERA_SUCCESS( CALL ) \
@@ -272,8 +274,74 @@ START_TEST(test_camera_list_formats) {
 	camera_exit(&camera);
 }
 
+START_TEST(test_camera_list_modes_cached) {
+	camera_t camera;
+	camera_zero( &camera );
+	const char dev_name[] = "/dev/video0";
+	camera_init(
+			&camera,
+			dev_name
+	);
+	char cache_dir[] = "/tmp/test_camera_XXXXXX";
+	ck_assert_ptr_nonnull( mkdtemp( cache_dir ) );
+	{
+		static camera_mode_descrs_t modes;
+		static camera_mode_descrs_t cached_modes;
+		bool from_cache = true;
+		CHECK_CAMERA_SUCCESS( camera_list_modes(
+					&camera,
+					&modes
+		));
+		// first run: enumerate and fill the cache:
+		CHECK_CAMERA_SUCCESS( camera_list_modes_cached(
+					&camera,
+					cache_dir,
+					&cached_modes,
+					&from_cache
+		));
+		ck_assert( !from_cache );
+		ck_assert_int_eq( cached_modes.count, modes.count );
+		// second run: read the cache:
+		memset( &cached_modes, 0, sizeof(cached_modes) );
+		CHECK_CAMERA_SUCCESS( camera_list_modes_cached(
+					&camera,
+					cache_dir,
+					&cached_modes,
+					&from_cache
+		));
+		ck_assert( from_cache );
+		ck_assert_int_eq( cached_modes.count, modes.count );
+		for( unsigned int i=0; i<modes.count; i++ ) {
+			ck_assert( camera_mode_descr_equal( &cached_modes.mode_descrs[i], &modes.mode_descrs[i] ) );
+		}
+		// camera still initialized:
+		ck_assert_int_ge( camera.dev_file, 0 );
+		ck_assert_ptr_null( camera.buffer_container.buffers );
+	}
+	{
+		char cmd[STR_BUFFER_SIZE];
+		snprintf( cmd, STR_BUFFER_SIZE, "rm -r '%s'", cache_dir );
+		ck_assert_int_eq( system( cmd ), 0 );
+	}
+	camera_exit(&camera);
+}
+END_TEST
+
 // negative tests:
 
+START_TEST(test_camera_list_modes_cached_uninitialized) {
+	camera_t camera;
+	camera_zero( &camera );
+	static camera_mode_descrs_t modes;
+	CHECK_CAMERA_FAILURE( camera_list_modes_cached(
+			&camera,
+			"/tmp",
+			&modes,
+			NULL
+	) );
+}
+END_TEST
+
 START_TEST(test_camera_list_formats_uninitialized) {
 	camera_t camera;
 	camera_zero( &camera );
@@ -506,8 +574,10 @@ Suite* camera_suite() {
 		tcase_add_test(test_case, test_camera_set_mode_no_change);
 		tcase_add_test(test_case, test_camera_set_mode);
 		tcase_add_test(test_case, test_camera_list_formats);
+		tcase_add_test(test_case, test_camera_list_modes_cached);
 		// negative:
 		tcase_add_test(test_case, test_camera_list_formats_uninitialized);
+		tcase_add_test(test_case, test_camera_list_modes_cached_uninitialized);
 		tcase_add_test(test_case, test_camera_set_mode_uninitialized);
 		tcase_add_test(test_case, test_camera_set_mode_too_large_size);
 		suite_add_tcase(suite, test_case);
@@ -0,0 +1,144 @@
+#include "lib/container.h"
+#include "lib/global.h"
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+#define CHECK_CONTAINER_SUCCESS( CALL ) \
+	if( CALL != RET_SUCCESS ) { \
+		ck_abort_msg( "'" #CALL "' failed" ); \
+	}
+
+#define TEST_CONTAINER_WIDTH 4
+#define TEST_CONTAINER_HEIGHT 4
+
+/***********************
+ * test case: rotate
+***********************/
+
+// check the frames listed in an index file
+// against the container file,
+// returns the number of frames:
+uint test_container_check_file(
+		const char* dir,
+		const uint file_counter,
+		const uint64_t first_frame
+)
+{
+	char path[STR_BUFFER_SIZE];
+	snprintf( path, STR_BUFFER_SIZE, "%s/video%04u.pgm", dir, file_counter );
+	FILE* file = fopen( path, "r" );
+	ck_assert_msg( file != NULL, "missing '%s'", path );
+	snprintf( path, STR_BUFFER_SIZE, "%s/video%04u.idx", dir, file_counter );
+	FILE* index_file = fopen( path, "r" );
+	ck_assert_msg( index_file != NULL, "missing '%s'", path );
+	uint count = 0;
+	unsigned long frame_number, time_sec, time_usec;
+	size_t offset, size;
+	while( 5 == fscanf( index_file, "%lu %zu %zu %lu.%lu\n",
+			&frame_number,
+			&offset,
+			&size,
+			&time_sec,
+			&time_usec
+	)) {
+		ck_assert_uint_eq( frame_number, first_frame + count );
+		ck_assert_uint_eq( time_sec, frame_number );
+		ck_assert_uint_eq( size, TEST_CONTAINER_WIDTH * TEST_CONTAINER_HEIGHT );
+		byte_t data[TEST_CONTAINER_WIDTH * TEST_CONTAINER_HEIGHT];
+		ck_assert_int_eq( fseek( file, offset, SEEK_SET ), 0 );
+		ck_assert_uint_eq( fread( data, 1, size, file ), size );
+		for( uint i=0; i<size; i++ ) {
+			ck_assert_uint_eq( data[i], (byte_t )frame_number );
+		}
+		count++;
+	}
+	ck_assert( feof( index_file ) );
+	fclose( index_file );
+	fclose( file );
+	return count;
+}
+
+START_TEST(test_container_rotate) {
+	char dir[] = "/tmp/test_container_XXXXXX";
+	ck_assert( mkdtemp( dir ) != NULL );
+	container_t container;
+	CHECK_CONTAINER_SUCCESS( container_init(
+			&container,
+			dir,
+			OUTPUT_FORMAT_GRAY,
+			TEST_CONTAINER_WIDTH, TEST_CONTAINER_HEIGHT,
+			0,
+			2
+	) );
+	byte_t frame[TEST_CONTAINER_WIDTH * TEST_CONTAINER_HEIGHT];
+	for( uint64_t i=0; i<5; i++ ) {
+		memset( frame, (byte_t )i, sizeof(frame) );
+		const timeval_t time = { .tv_sec = i, .tv_nsec = 0 };
+		CHECK_CONTAINER_SUCCESS( container_write_frame(
+				&container,
+				i,
+				&time,
+				frame,
+				sizeof(frame)
+		) );
+	}
+	CHECK_CONTAINER_SUCCESS( container_exit( &container ) );
+	// 2 + 2 + 1 frames:
+	ck_assert_uint_eq( test_container_check_file( dir, 0, 0 ), 2 );
+	ck_assert_uint_eq( test_container_check_file( dir, 1, 2 ), 2 );
+	ck_assert_uint_eq( test_container_check_file( dir, 2, 4 ), 1 );
+	char path[STR_BUFFER_SIZE];
+	snprintf( path, STR_BUFFER_SIZE, "%s/video%04u.pgm", dir, 3 );
+	ck_assert( access( path, F_OK ) != 0 );
+	// cleanup:
+	for( uint i=0; i<3; i++ ) {
+		snprintf( path, STR_BUFFER_SIZE, "%s/video%04u.pgm", dir, i );
+		unlink( path );
+		snprintf( path, STR_BUFFER_SIZE, "%s/video%04u.idx", dir, i );
+		unlink( path );
+	}
+	rmdir( dir );
+}
+END_TEST
+
+START_TEST(test_container_buffer_too_small) {
+	char dir[] = "/tmp/test_container_XXXXXX";
+	ck_assert( mkdtemp( dir ) != NULL );
+	container_t container;
+	CHECK_CONTAINER_SUCCESS( container_init(
+			&container,
+			dir,
+			OUTPUT_FORMAT_GRAY,
+			TEST_CONTAINER_WIDTH, TEST_CONTAINER_HEIGHT,
+			0,
+			0
+	) );
+	byte_t frame[TEST_CONTAINER_WIDTH * TEST_CONTAINER_HEIGHT] = { 0 };
+	const timeval_t time = { .tv_sec = 0, .tv_nsec = 0 };
+	ck_assert_int_eq( container_write_frame(
+			&container,
+			0,
+			&time,
+			frame,
+			sizeof(frame) - 1
+	), RET_FAILURE );
+	CHECK_CONTAINER_SUCCESS( container_exit( &container ) );
+	rmdir( dir );
+}
+END_TEST
+
+Suite* container_suite() {
+	Suite* suite = suite_create("container");
+	{
+		TCase* test_case = tcase_create("rotate");
+		tcase_add_test(test_case, test_container_rotate);
+		tcase_add_test(test_case, test_container_buffer_too_small);
+		suite_add_tcase(suite, test_case);
+	}
+	return suite;
+}
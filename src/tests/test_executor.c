@@ -0,0 +1,128 @@
+#include "lib/executor.h"
+#include "lib/global.h"
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define CHECK_EXECUTOR_SUCCESS( CALL ) \
+	if( CALL != RET_SUCCESS ) { \
+		ck_abort_msg( "'" #CALL "' failed" ); \
+	}
+
+#define TEST_WORKER_COUNT 4
+#define TEST_STRAND_COUNT 3
+#define TEST_TASK_COUNT 10000
+
+/***********************
+ * test case: executor
+***********************/
+
+const int test_executor_cpus[TEST_WORKER_COUNT] = { -1, -1, -1, -1 };
+
+typedef struct {
+	executor_strand_t strand;
+	// only accessed by the strand's tasks:
+	uint next;
+	uint out_of_order;
+	uint count;
+} test_strand_t;
+
+typedef struct {
+	test_strand_t* strand;
+	uint value;
+} test_strand_task_t;
+
+_Atomic uint test_executor_count;
+
+void test_executor_count_task(
+		void* arg
+)
+{
+	(void )arg;
+	// (keep the workers busy while tasks are submitted)
+	usleep( 10 );
+	test_executor_count++;
+}
+
+void test_executor_strand_task(
+		void* arg
+)
+{
+	test_strand_task_t* task = arg;
+	test_strand_t* strand = task->strand;
+	if( task->value != strand->next ) {
+		strand->out_of_order++;
+	}
+	strand->next = task->value + 1;
+	strand->count++;
+}
+
+// executor_exit: all submitted tasks run
+START_TEST(test_executor_drain_on_exit) {
+	executor_t executor;
+	test_executor_count = 0;
+	CHECK_EXECUTOR_SUCCESS( executor_init(
+			&executor,
+			"test",
+			test_executor_cpus,
+			TEST_WORKER_COUNT,
+			4
+	) );
+	for( uint i=0; i<1000; i++ ) {
+		executor_submit( &executor, test_executor_count_task, NULL );
+	}
+	CHECK_EXECUTOR_SUCCESS( executor_exit( &executor ) );
+	ck_assert_uint_eq( test_executor_count, 1000 );
+}
+END_TEST
+
+// tasks of a strand run in the order they have been posted,
+// strands interleaved with plain tasks:
+START_TEST(test_executor_strand_order) {
+	static test_strand_t strands[TEST_STRAND_COUNT];
+	static test_strand_task_t tasks[TEST_STRAND_COUNT][TEST_TASK_COUNT];
+	executor_t executor;
+	test_executor_count = 0;
+	CHECK_EXECUTOR_SUCCESS( executor_init(
+			&executor,
+			"test",
+			test_executor_cpus,
+			TEST_WORKER_COUNT,
+			8
+	) );
+	for( uint s=0; s<TEST_STRAND_COUNT; s++ ) {
+		memset( &strands[s], 0, sizeof(strands[s]) );
+		executor_strand_init( &strands[s].strand, &executor, 16 );
+	}
+	for( uint i=0; i<TEST_TASK_COUNT; i++ ) {
+		if( i % 100 == 0 ) {
+			executor_submit( &executor, test_executor_count_task, NULL );
+		}
+		for( uint s=0; s<TEST_STRAND_COUNT; s++ ) {
+			tasks[s][i] = (test_strand_task_t){ .strand = &strands[s], .value = i };
+			executor_strand_post( &strands[s].strand, test_executor_strand_task, &tasks[s][i] );
+		}
+	}
+	CHECK_EXECUTOR_SUCCESS( executor_exit( &executor ) );
+	ck_assert_uint_eq( test_executor_count, TEST_TASK_COUNT / 100 );
+	for( uint s=0; s<TEST_STRAND_COUNT; s++ ) {
+		ck_assert_uint_eq( strands[s].count, TEST_TASK_COUNT );
+		ck_assert_uint_eq( strands[s].out_of_order, 0 );
+		executor_strand_exit( &strands[s].strand );
+	}
+}
+END_TEST
+
+Suite* executor_suite() {
+	Suite* suite = suite_create("executor");
+	{
+		TCase* test_case = tcase_create("executor");
+		tcase_add_test(test_case, test_executor_drain_on_exit);
+		tcase_add_test(test_case, test_executor_strand_order);
+		suite_add_tcase(suite, test_case);
+	}
+	return suite;
+}
@@ -4,6 +4,9 @@
 #include <check.h>
 #include <linux/videodev2.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <jpeglib.h>
 
 #define CHECK_IMAGE_SUCCESS( CALL ) \
 	if( CALL != RET_SUCCESS ) { \
@@ -438,6 +441,76 @@ START_TEST(test_image_convert_XRGB32) {
 }
 END_TEST
 
+// every pixel value of the formats converted by
+// table lookup, against the bit layout of each format.
+// Pixels are read as little endian words
+// ('big_endian': bytes swapped first):
+typedef struct {
+	uint pixelformat;
+	uint size;
+	bool big_endian;
+	uint shift[3]; // red, green, blue
+	uint bits[3];
+} test_pixel_layout_t;
+
+START_TEST(test_image_convert_lut_all_values) {
+	const test_pixel_layout_t layouts[] = {
+		{ V4L2_PIX_FMT_RGB332, 1, false, { 5, 2, 0 }, { 3, 3, 2 } },
+		{ V4L2_PIX_FMT_XRGB444, 2, false, { 8, 4, 0 }, { 4, 4, 4 } },
+		{ V4L2_PIX_FMT_XRGB555, 2, false, { 10, 5, 0 }, { 5, 5, 5 } },
+		{ V4L2_PIX_FMT_RGB565, 2, false, { 11, 5, 0 }, { 5, 6, 5 } },
+		{ V4L2_PIX_FMT_XRGB555X, 2, true, { 10, 5, 0 }, { 5, 5, 5 } },
+		{ V4L2_PIX_FMT_RGB565X, 2, true, { 11, 5, 0 }, { 5, 6, 5 } },
+	};
+	for( uint l=0; l<sizeof(layouts)/sizeof(layouts[0]); l++ ) {
+		const test_pixel_layout_t* layout = &layouts[l];
+		const uint count = 1u << (8*layout->size);
+		// one row per 256 values:
+		const img_format_t format = {
+			.width = 256, .height = count / 256,
+			.pixelformat = layout->pixelformat,
+			.sizeimage = count * layout->size,
+			.bytesperline = 256 * layout->size,
+		};
+		byte_t* src_buffer = malloc( count * layout->size );
+		byte_t* dst_buffer = malloc( count * 3 );
+		ck_assert_ptr_nonnull( src_buffer );
+		ck_assert_ptr_nonnull( dst_buffer );
+		for( uint value=0; value<count; value++ ) {
+			src_buffer[value * layout->size] = value & 0xff;
+			if( layout->size == 2 ) {
+				src_buffer[value * layout->size + 1] = value >> 8;
+			}
+		}
+		CHECK_IMAGE_SUCCESS( image_convert_to_rgb(
+				format,
+				src_buffer,
+				dst_buffer, count * 3
+		) );
+		for( uint value=0; value<count; value++ ) {
+			const uint word = layout->big_endian
+				? ((value & 0xff) << 8) | (value >> 8)
+				: value;
+			for( uint c=0; c<3; c++ ) {
+				const uint max = (1u << layout->bits[c]) - 1;
+				const uint channel = (word >> layout->shift[c]) & max;
+				// (channels are scaled as by 'RANGE_FROM_TO')
+				const uint expected_channel = channel / max * 255;
+				if( dst_buffer[value*3 + c] != expected_channel ) {
+					ck_abort_msg( "format %u, value 0x%04x, channel %u: %u != %u",
+							l, value, c,
+							dst_buffer[value*3 + c],
+							expected_channel
+					);
+				}
+			}
+		}
+		free( dst_buffer );
+		free( src_buffer );
+	}
+}
+END_TEST
+
 START_TEST(test_image_convert_YUYV) {
 	const test_args_t args = test_args_YUYV();
 	byte_t dst_buffer[args.format.width * args.format.height * 3];
@@ -538,6 +611,311 @@ START_TEST(test_image_convert_1byte_padding_undersized) {
 }
 END_TEST
 
+START_TEST(test_image_convert_yuv420) {
+	const test_args_t args = test_args_YUYV();
+	byte_t dst_buffer[image_yuv420_size(args.format.width, args.format.height)];
+	memset(dst_buffer, 0, sizeof(dst_buffer));
+	{
+		ret_t ret = image_convert_to_yuv420(
+				args.format,
+				args.src_buffer,
+				dst_buffer, sizeof(dst_buffer)
+		);
+		ck_assert( ret == RET_SUCCESS );
+	}
+	const byte_t expected_yuv420[] = {
+		// Y:
+		76, 76, 149, 149,
+		29, 29, 255, 255,
+		// U:
+		170, 86,
+		// V:
+		181, 75
+	};
+	ck_assert_int_eq( sizeof(dst_buffer), sizeof(expected_yuv420) );
+	ck_assert_mem_eq( dst_buffer, expected_yuv420, sizeof(dst_buffer) );
+}
+END_TEST
+
+START_TEST(test_image_convert_yuv420_to_rgb) {
+	// both lines share the same chroma,
+	// so subsampling looses no information:
+	const img_format_t format = {
+		.width = 4, .height = 2,
+		.pixelformat = V4L2_PIX_FMT_YUYV,
+		.sizeimage = 16,
+		.bytesperline = 8
+	};
+	const byte_t src_buffer[] = {
+		76, 84, 76, 255, /**/ 149, 43, 149, 21,
+		29, 84, 29, 255, /**/ 255, 43, 255, 21
+	};
+	byte_t expected_rgb[image_rgb_size(format.width, format.height)];
+	ck_assert( RET_SUCCESS == image_convert_to_rgb(
+			format,
+			src_buffer,
+			expected_rgb, sizeof(expected_rgb)
+	) );
+	byte_t yuv420_buffer[image_yuv420_size(format.width, format.height)];
+	ck_assert( RET_SUCCESS == image_convert_to_yuv420(
+			format,
+			src_buffer,
+			yuv420_buffer, sizeof(yuv420_buffer)
+	) );
+	byte_t dst_buffer[image_rgb_size(format.width, format.height)];
+	ck_assert( RET_SUCCESS == image_yuv420_to_rgb(
+			format.width, format.height,
+			yuv420_buffer, sizeof(yuv420_buffer),
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	for( uint i=0; i<sizeof(dst_buffer); ++i ) {
+		ck_assert_int_le( abs((int )expected_rgb[i] - (int )dst_buffer[i]), 1 );
+	}
+}
+END_TEST
+
+// planar formats, same pixels as in
+// 'test_image_convert_yuv420_to_rgb':
+const byte_t planar_test_yuyv[] = {
+	76, 84, 76, 255, /**/ 149, 43, 149, 21,
+	29, 84, 29, 255, /**/ 255, 43, 255, 21
+};
+
+// padded lines:
+const img_format_t planar_test_format_nv12 = {
+	.width = 4, .height = 2,
+	.pixelformat = V4L2_PIX_FMT_NV12,
+	.sizeimage = 18,
+	.bytesperline = 6
+};
+const byte_t planar_test_nv12[] = {
+	76, 76, 149, 149, 0, 0,
+	29, 29, 255, 255, 0, 0,
+	84, 255, 43, 21, 0, 0,
+};
+
+const img_format_t planar_test_format_yu12 = {
+	.width = 4, .height = 2,
+	.pixelformat = V4L2_PIX_FMT_YUV420,
+	.sizeimage = 12,
+	.bytesperline = 4
+};
+const byte_t planar_test_yu12[] = {
+	76, 76, 149, 149,
+	29, 29, 255, 255,
+	84, 43,
+	255, 21,
+};
+
+START_TEST(test_image_convert_planar_to_rgb) {
+	const img_format_t yuyv_format = {
+		.width = 4, .height = 2,
+		.pixelformat = V4L2_PIX_FMT_YUYV,
+		.sizeimage = 16,
+		.bytesperline = 8
+	};
+	byte_t expected_rgb[image_rgb_size(4, 2)];
+	CHECK_IMAGE_SUCCESS( image_convert_to_rgb(
+			yuyv_format,
+			planar_test_yuyv,
+			expected_rgb, sizeof(expected_rgb)
+	) );
+	byte_t dst_buffer[image_rgb_size(4, 2)];
+	CHECK_IMAGE_SUCCESS( image_convert_to_rgb(
+			planar_test_format_nv12,
+			planar_test_nv12,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	for( uint i=0; i<sizeof(dst_buffer); ++i ) {
+		ck_assert_int_le( abs((int )expected_rgb[i] - (int )dst_buffer[i]), 1 );
+	}
+	memset( dst_buffer, 0, sizeof(dst_buffer) );
+	CHECK_IMAGE_SUCCESS( image_convert_to_rgb(
+			planar_test_format_yu12,
+			planar_test_yu12,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	for( uint i=0; i<sizeof(dst_buffer); ++i ) {
+		ck_assert_int_le( abs((int )expected_rgb[i] - (int )dst_buffer[i]), 1 );
+	}
+	// grey: the luma plane only
+	img_format_t grey_format = planar_test_format_nv12;
+	grey_format.pixelformat = V4L2_PIX_FMT_GREY;
+	grey_format.sizeimage = 12;
+	CHECK_IMAGE_SUCCESS( image_convert_to_rgb(
+			grey_format,
+			planar_test_nv12,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	for( uint i=0; i<sizeof(dst_buffer); ++i ) {
+		const uint pixel = i/3;
+		ck_assert_uint_eq( dst_buffer[i], planar_test_nv12[(pixel/4)*6 + pixel%4] );
+	}
+}
+END_TEST
+
+START_TEST(test_image_convert_planar_to_yuv420) {
+	byte_t expected_yuv420[image_yuv420_size(4, 2)];
+	CHECK_IMAGE_SUCCESS( image_convert_to_yuv420(
+			planar_test_format_yu12,
+			planar_test_yu12,
+			expected_yuv420, sizeof(expected_yuv420)
+	) );
+	ck_assert_mem_eq( expected_yuv420, planar_test_yu12, sizeof(expected_yuv420) );
+	byte_t dst_buffer[image_yuv420_size(4, 2)];
+	CHECK_IMAGE_SUCCESS( image_convert_to_yuv420(
+			planar_test_format_nv12,
+			planar_test_nv12,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	ck_assert_mem_eq( dst_buffer, expected_yuv420, sizeof(dst_buffer) );
+	// too small:
+	img_format_t format = planar_test_format_nv12;
+	format.sizeimage = 12;
+	CHECK_IMAGE_FAILURE( image_convert_to_yuv420(
+			format,
+			planar_test_nv12,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+}
+END_TEST
+
+START_TEST(test_image_convert_gray) {
+	const test_args_t args = test_args_YUYV();
+	const byte_t expected_gray[] = {
+		76, 76, 149, 149,
+		29, 29, 255, 255
+	};
+	byte_t dst_buffer[image_output_size(OUTPUT_FORMAT_GRAY, 4, 2)];
+	ck_assert_uint_eq( sizeof(dst_buffer), sizeof(expected_gray) );
+	CHECK_IMAGE_SUCCESS( image_convert(
+			args.format,
+			OUTPUT_FORMAT_GRAY,
+			args.src_buffer, args.format.sizeimage,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	ck_assert_mem_eq( dst_buffer, expected_gray, sizeof(dst_buffer) );
+	// planar: the Y plane
+	CHECK_IMAGE_SUCCESS( image_convert(
+			planar_test_format_yu12,
+			OUTPUT_FORMAT_GRAY,
+			planar_test_yu12, planar_test_format_yu12.sizeimage,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	ck_assert_mem_eq( dst_buffer, planar_test_yu12, sizeof(dst_buffer) );
+	// no luma:
+	const test_args_t args_rgb = test_args_RGB24();
+	CHECK_IMAGE_FAILURE( image_convert(
+			args_rgb.format,
+			OUTPUT_FORMAT_GRAY,
+			args_rgb.src_buffer, args_rgb.format.sizeimage,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+}
+END_TEST
+
+START_TEST(test_image_resize) {
+	// 4x4 -> 2x2 and 1x1: averages
+	const byte_t gray[] = {
+		0, 2, 10, 10,
+		4, 6, 10, 10,
+		100, 100, 0, 0,
+		100, 100, 255, 255,
+	};
+	byte_t dst_buffer[4] = { 0 };
+	CHECK_IMAGE_SUCCESS( image_resize(
+			OUTPUT_FORMAT_GRAY,
+			4, 4, gray, sizeof(gray),
+			2, 2, dst_buffer, sizeof(dst_buffer)
+	) );
+	const byte_t expected_box_2[] = { 3, 10, 100, 128 };
+	ck_assert_mem_eq( dst_buffer, expected_box_2, sizeof(expected_box_2) );
+	CHECK_IMAGE_SUCCESS( image_resize(
+			OUTPUT_FORMAT_GRAY,
+			4, 4, gray, sizeof(gray),
+			1, 1, dst_buffer, 1
+	) );
+	// (sum of all samples: 962)
+	ck_assert_uint_eq( dst_buffer[0], (962 + 8) / 16 );
+	// RGB 3x1 -> 2x1: bilinear, channels separately
+	const byte_t rgb[] = {
+		0, 255, 0, /**/ 120, 255, 60, /**/ 240, 255, 120,
+	};
+	byte_t dst_rgb[6];
+	CHECK_IMAGE_SUCCESS( image_resize(
+			OUTPUT_FORMAT_RGB,
+			3, 1, rgb, sizeof(rgb),
+			2, 1, dst_rgb, sizeof(dst_rgb)
+	) );
+	const byte_t expected_bilinear[] = {
+		30, 255, 15, /**/ 210, 255, 105,
+	};
+	ck_assert_mem_eq( dst_rgb, expected_bilinear, sizeof(expected_bilinear) );
+	CHECK_IMAGE_FAILURE( image_resize(
+			OUTPUT_FORMAT_RGB,
+			3, 1, rgb, sizeof(rgb),
+			2, 1, dst_rgb, sizeof(dst_rgb)-1
+	) );
+}
+END_TEST
+
+START_TEST(test_image_converter_output_size) {
+	const test_args_t args = test_args_YUYV();
+	image_converter_t converter;
+	CHECK_IMAGE_SUCCESS( image_converter_init( &converter, args.format, OUTPUT_FORMAT_GRAY ) );
+	CHECK_IMAGE_FAILURE( image_converter_set_output_size( &converter, 8, 4 ) );
+	CHECK_IMAGE_SUCCESS( image_converter_set_output_size( &converter, 2, 1 ) );
+	ck_assert_uint_eq( converter.dst_size, 2 );
+	byte_t dst_buffer[2];
+	CHECK_IMAGE_SUCCESS( image_converter_run(
+			&converter,
+			args.src_buffer, args.format.sizeimage,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	// luma 76, 76, 149, 149 / 29, 29, 255, 255:
+	const byte_t expected_gray[] = { 53, 202 };
+	ck_assert_mem_eq( dst_buffer, expected_gray, sizeof(expected_gray) );
+	image_converter_exit( &converter );
+}
+END_TEST
+
+START_TEST(test_image_convert_yuv420_unsupported) {
+	const test_args_t args = test_args_RGB24();
+	byte_t dst_buffer[image_yuv420_size(args.format.width, args.format.height)];
+	CHECK_IMAGE_FAILURE( image_convert_to_yuv420(
+			args.format,
+			args.src_buffer,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+}
+END_TEST
+
+START_TEST(test_image_converter) {
+	const test_args_t args = test_args_RGB332();
+	image_converter_t converter;
+	ck_assert( RET_SUCCESS == image_converter_init( &converter, args.format, OUTPUT_FORMAT_RGB ) );
+	ck_assert_uint_eq( converter.dst_size, image_rgb_size( args.format.width, args.format.height ) );
+	byte_t dst_buffer[args.format.width * args.format.height * 3];
+	// same kernel for every frame:
+	for( uint i=0; i<2; i++ ) {
+		memset(dst_buffer, 0, sizeof(dst_buffer));
+		ck_assert( RET_SUCCESS == image_converter_run(
+				&converter,
+				args.src_buffer, args.format.sizeimage,
+				dst_buffer, sizeof(dst_buffer)
+		) );
+		ck_assert_mem_eq( dst_buffer, expected, sizeof(dst_buffer) );
+	}
+	CHECK_IMAGE_FAILURE( image_converter_run(
+			&converter,
+			args.src_buffer, args.format.sizeimage,
+			dst_buffer, sizeof(dst_buffer)-1
+	) );
+	CHECK_IMAGE_FAILURE( image_converter_init( &converter, args.format, OUTPUT_FORMAT_YUV420 ) );
+	CHECK_IMAGE_FAILURE( image_converter_init( &converter, args.format, OUTPUT_FORMAT_JPEG ) );
+}
+END_TEST
+
 START_TEST(test_image_diff_yuyv_same) {
 	const test_args_t args = test_args_YUYV();
 	byte_t src_buffer_1[sizeof(args.src_buffer)];
@@ -583,6 +961,31 @@ START_TEST(test_image_diff_yuyv_small_difference) {
 }
 END_TEST
 
+START_TEST(test_image_diff_planar) {
+	byte_t src_buffer[sizeof(planar_test_nv12)];
+	memcpy( src_buffer, planar_test_nv12, sizeof(src_buffer) );
+	// padding and chroma are ignored:
+	src_buffer[4] += 64;
+	src_buffer[12] += 64;
+	float result = 1;
+	CHECK_IMAGE_SUCCESS( image_diff(
+			planar_test_format_nv12,
+			planar_test_nv12,
+			src_buffer,
+			&result
+	) );
+	ck_assert_float_eq_tol( result, 0, 0.0001 );
+	src_buffer[7] += 64;
+	CHECK_IMAGE_SUCCESS( image_diff(
+			planar_test_format_nv12,
+			planar_test_nv12,
+			src_buffer,
+			&result
+	) );
+	ck_assert_float_eq_tol( result, (64.0/256.0) / 8, 0.0001 );
+}
+END_TEST
+
 START_TEST(test_image_diff_yuyv_very_different) {
 	const test_args_t args = test_args_YUYV();
 	byte_t src_buffer_1[sizeof(args.src_buffer)];
@@ -612,6 +1015,310 @@ START_TEST(test_image_diff_yuyv_very_different) {
 }
 END_TEST
 
+// MJPEG:
+
+// 16x16 frame, each 8x8 block has one colour
+// (so that the DC coefficients are exact):
+const byte_t jpeg_block_colors[4][3] = {
+	{ 200, 40, 40 }, { 40, 200, 40 },
+	{ 40, 40, 200 }, { 128, 128, 128 },
+};
+
+#define JPEG_TEST_SIZE 16
+
+void jpeg_test_rgb(
+		byte_t* rgb,
+		const byte_t offset
+)
+{
+	for( uint y=0; y<JPEG_TEST_SIZE; y++ ) {
+	for( uint x=0; x<JPEG_TEST_SIZE; x++ ) {
+		const byte_t* color = jpeg_block_colors[(y/8)*2 + x/8];
+		for( uint c=0; c<3; c++ ) {
+			rgb[(y*JPEG_TEST_SIZE + x)*3 + c] = color[c] + offset;
+		}
+	}
+	}
+}
+
+// caller frees 'jpeg':
+void jpeg_test_encode(
+		const byte_t* rgb,
+		unsigned char** jpeg,
+		unsigned long* jpeg_size
+)
+{
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr error;
+	cinfo.err = jpeg_std_error( &error );
+	jpeg_create_compress( &cinfo );
+	(*jpeg) = NULL;
+	(*jpeg_size) = 0;
+	jpeg_mem_dest( &cinfo, jpeg, jpeg_size );
+	cinfo.image_width = JPEG_TEST_SIZE;
+	cinfo.image_height = JPEG_TEST_SIZE;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+	jpeg_set_defaults( &cinfo );
+	jpeg_set_quality( &cinfo, 100, TRUE );
+	// no chroma subsampling:
+	cinfo.comp_info[0].h_samp_factor = 1;
+	cinfo.comp_info[0].v_samp_factor = 1;
+	jpeg_start_compress( &cinfo, TRUE );
+	while( cinfo.next_scanline < cinfo.image_height ) {
+		JSAMPROW row = (JSAMPROW )&rgb[cinfo.next_scanline * JPEG_TEST_SIZE * 3];
+		jpeg_write_scanlines( &cinfo, &row, 1 );
+	}
+	jpeg_finish_compress( &cinfo );
+	jpeg_destroy_compress( &cinfo );
+}
+
+const img_format_t jpeg_test_format = {
+	.width = JPEG_TEST_SIZE, .height = JPEG_TEST_SIZE,
+	.pixelformat = V4L2_PIX_FMT_MJPEG,
+};
+
+START_TEST(test_image_convert_mjpeg_to_rgb) {
+	byte_t rgb[JPEG_TEST_SIZE*JPEG_TEST_SIZE*3];
+	jpeg_test_rgb( rgb, 0 );
+	unsigned char* jpeg;
+	unsigned long jpeg_size;
+	jpeg_test_encode( rgb, &jpeg, &jpeg_size );
+	byte_t dst_buffer[image_rgb_size(JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_SUCCESS( image_convert(
+			jpeg_test_format,
+			OUTPUT_FORMAT_RGB,
+			jpeg, jpeg_size,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	// lossy:
+	for( uint i=0; i<sizeof(dst_buffer); ++i ) {
+		ck_assert_int_le( abs((int )rgb[i] - (int )dst_buffer[i]), 8 );
+	}
+	free( jpeg );
+}
+END_TEST
+
+START_TEST(test_image_convert_mjpeg_to_yuv420) {
+	byte_t rgb[JPEG_TEST_SIZE*JPEG_TEST_SIZE*3];
+	jpeg_test_rgb( rgb, 0 );
+	unsigned char* jpeg;
+	unsigned long jpeg_size;
+	jpeg_test_encode( rgb, &jpeg, &jpeg_size );
+	byte_t yuv420_buffer[image_yuv420_size(JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_SUCCESS( image_convert(
+			jpeg_test_format,
+			OUTPUT_FORMAT_YUV420,
+			jpeg, jpeg_size,
+			yuv420_buffer, sizeof(yuv420_buffer)
+	) );
+	byte_t dst_buffer[image_rgb_size(JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_SUCCESS( image_yuv420_to_rgb(
+			JPEG_TEST_SIZE, JPEG_TEST_SIZE,
+			yuv420_buffer, sizeof(yuv420_buffer),
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	for( uint i=0; i<sizeof(dst_buffer); ++i ) {
+		ck_assert_int_le( abs((int )rgb[i] - (int )dst_buffer[i]), 8 );
+	}
+	// luma only:
+	byte_t gray_buffer[image_output_size(OUTPUT_FORMAT_GRAY, JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_SUCCESS( image_convert(
+			jpeg_test_format,
+			OUTPUT_FORMAT_GRAY,
+			jpeg, jpeg_size,
+			gray_buffer, sizeof(gray_buffer)
+	) );
+	ck_assert_mem_eq( gray_buffer, yuv420_buffer, sizeof(gray_buffer) );
+	free( jpeg );
+}
+END_TEST
+
+START_TEST(test_image_convert_mjpeg_invalid) {
+	const byte_t src_buffer[64] = { 0xff, 0xd8, 0x00 };
+	byte_t dst_buffer[image_rgb_size(JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_FAILURE( image_convert(
+			jpeg_test_format,
+			OUTPUT_FORMAT_RGB,
+			src_buffer, sizeof(src_buffer),
+			dst_buffer, sizeof(dst_buffer)
+	) );
+}
+END_TEST
+
+START_TEST(test_image_convert_mjpeg_wrong_size) {
+	byte_t rgb[JPEG_TEST_SIZE*JPEG_TEST_SIZE*3];
+	jpeg_test_rgb( rgb, 0 );
+	unsigned char* jpeg;
+	unsigned long jpeg_size;
+	jpeg_test_encode( rgb, &jpeg, &jpeg_size );
+	img_format_t format = jpeg_test_format;
+	format.width = 8;
+	format.height = 8;
+	byte_t dst_buffer[image_rgb_size(JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_FAILURE( image_convert(
+			format,
+			OUTPUT_FORMAT_RGB,
+			jpeg, jpeg_size,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	free( jpeg );
+}
+END_TEST
+
+START_TEST(test_image_jpeg_luma) {
+	byte_t rgb[JPEG_TEST_SIZE*JPEG_TEST_SIZE*3];
+	jpeg_test_rgb( rgb, 0 );
+	unsigned char* jpeg;
+	unsigned long jpeg_size;
+	jpeg_test_encode( rgb, &jpeg, &jpeg_size );
+	image_luma_t luma;
+	image_luma_init( &luma, JPEG_TEST_SIZE, JPEG_TEST_SIZE );
+	CHECK_IMAGE_SUCCESS( image_jpeg_luma( jpeg, jpeg_size, &luma ) );
+	// one pixel per 8x8 block:
+	ck_assert_uint_eq( luma.width, JPEG_TEST_SIZE/8 );
+	ck_assert_uint_eq( luma.height, JPEG_TEST_SIZE/8 );
+	for( uint i=0; i<4; i++ ) {
+		const byte_t* color = jpeg_block_colors[i];
+		const float expected_y = 0.299*color[0] + 0.587*color[1] + 0.114*color[2];
+		ck_assert_float_eq_tol( luma.data[i], expected_y, 2 );
+	}
+	image_luma_exit( &luma );
+	free( jpeg );
+}
+END_TEST
+
+START_TEST(test_image_luma_diff) {
+	byte_t rgb[JPEG_TEST_SIZE*JPEG_TEST_SIZE*3];
+	unsigned char* jpeg_1;
+	unsigned long jpeg_size_1;
+	jpeg_test_rgb( rgb, 0 );
+	jpeg_test_encode( rgb, &jpeg_1, &jpeg_size_1 );
+	unsigned char* jpeg_2;
+	unsigned long jpeg_size_2;
+	jpeg_test_rgb( rgb, 32 );
+	jpeg_test_encode( rgb, &jpeg_2, &jpeg_size_2 );
+	image_luma_t luma_1;
+	image_luma_t luma_2;
+	image_luma_init( &luma_1, JPEG_TEST_SIZE, JPEG_TEST_SIZE );
+	image_luma_init( &luma_2, JPEG_TEST_SIZE, JPEG_TEST_SIZE );
+	CHECK_IMAGE_SUCCESS( image_jpeg_luma( jpeg_1, jpeg_size_1, &luma_1 ) );
+	CHECK_IMAGE_SUCCESS( image_jpeg_luma( jpeg_2, jpeg_size_2, &luma_2 ) );
+	{
+		float result = 1;
+		CHECK_IMAGE_SUCCESS( image_luma_diff( &luma_1, &luma_1, &result ) );
+		ck_assert_float_eq_tol( result, 0, 0.001 );
+	}
+	{
+		// all pixels brighter by 32:
+		float result = 0;
+		CHECK_IMAGE_SUCCESS( image_luma_diff( &luma_1, &luma_2, &result ) );
+		ck_assert_float_eq_tol( result, 32.0 / 256.0, 0.01 );
+	}
+	image_luma_exit( &luma_1 );
+	image_luma_exit( &luma_2 );
+	free( jpeg_1 );
+	free( jpeg_2 );
+}
+END_TEST
+
+START_TEST(test_image_convert_mjpeg_to_jpeg) {
+	byte_t rgb[JPEG_TEST_SIZE*JPEG_TEST_SIZE*3];
+	jpeg_test_rgb( rgb, 0 );
+	unsigned char* jpeg;
+	unsigned long jpeg_size;
+	jpeg_test_encode( rgb, &jpeg, &jpeg_size );
+	byte_t dst_buffer[image_output_size(OUTPUT_FORMAT_JPEG, JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_SUCCESS( image_convert(
+			jpeg_test_format,
+			OUTPUT_FORMAT_JPEG,
+			jpeg, jpeg_size,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	ck_assert_uint_eq( image_converted_size( jpeg_test_format, OUTPUT_FORMAT_JPEG, jpeg_size ), jpeg_size );
+	ck_assert_mem_eq( dst_buffer, jpeg, jpeg_size );
+	// raw input:
+	img_format_t format = jpeg_test_format;
+	format.pixelformat = V4L2_PIX_FMT_YUYV;
+	CHECK_IMAGE_FAILURE( image_convert(
+			format,
+			OUTPUT_FORMAT_JPEG,
+			jpeg, jpeg_size,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	free( jpeg );
+}
+END_TEST
+
+// remove all DHT segments (as UVC cameras do):
+size_t jpeg_test_strip_huffman_tables(
+		byte_t* jpeg,
+		size_t jpeg_size
+)
+{
+	size_t pos = 2;
+	while( jpeg[pos+1] != 0xda ) {
+		const size_t segment_size = 2 + ((jpeg[pos+2] << 8) | jpeg[pos+3]);
+		if( jpeg[pos+1] == 0xc4 ) {
+			memmove( &jpeg[pos], &jpeg[pos + segment_size], jpeg_size - pos - segment_size );
+			jpeg_size -= segment_size;
+		}
+		else {
+			pos += segment_size;
+		}
+	}
+	return jpeg_size;
+}
+
+START_TEST(test_image_jpeg_header) {
+	byte_t rgb[JPEG_TEST_SIZE*JPEG_TEST_SIZE*3];
+	jpeg_test_rgb( rgb, 0 );
+	unsigned char* jpeg;
+	unsigned long jpeg_size;
+	jpeg_test_encode( rgb, &jpeg, &jpeg_size );
+	byte_t expected[image_rgb_size(JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_SUCCESS( image_convert(
+			jpeg_test_format,
+			OUTPUT_FORMAT_RGB,
+			jpeg, jpeg_size,
+			expected, sizeof(expected)
+	) );
+	const size_t stripped_size = jpeg_test_strip_huffman_tables( jpeg, jpeg_size );
+	ck_assert_uint_lt( stripped_size, jpeg_size );
+	// SOI, COM, DHT + stripped frame:
+	byte_t file[IMAGE_JPEG_HEADER_MAX_SIZE + jpeg_size];
+	size_t header_size = 0;
+	CHECK_IMAGE_SUCCESS( image_jpeg_header(
+			jpeg, stripped_size,
+			"123.456",
+			file, IMAGE_JPEG_HEADER_MAX_SIZE,
+			&header_size
+	) );
+	const byte_t comment[] = { 0xff, 0xd8, 0xff, 0xfe, 0x00, 0x09, '1', '2', '3', '.', '4', '5', '6' };
+	ck_assert_mem_eq( file, comment, sizeof(comment) );
+	memcpy( &file[header_size], &jpeg[2], stripped_size - 2 );
+	byte_t dst_buffer[image_rgb_size(JPEG_TEST_SIZE, JPEG_TEST_SIZE)];
+	CHECK_IMAGE_SUCCESS( image_convert(
+			jpeg_test_format,
+			OUTPUT_FORMAT_RGB,
+			file, header_size + stripped_size - 2,
+			dst_buffer, sizeof(dst_buffer)
+	) );
+	ck_assert_mem_eq( dst_buffer, expected, sizeof(expected) );
+	// existing tables are kept:
+	free( jpeg );
+	jpeg_test_encode( rgb, &jpeg, &jpeg_size );
+	CHECK_IMAGE_SUCCESS( image_jpeg_header(
+			jpeg, jpeg_size,
+			NULL,
+			file, IMAGE_JPEG_HEADER_MAX_SIZE,
+			&header_size
+	) );
+	ck_assert_uint_eq( header_size, 2 );
+	free( jpeg );
+}
+END_TEST
+
 /***********************
  * test suite
 ***********************/
@@ -631,6 +1338,7 @@ Suite* image_suite() {
 		tcase_add_test(test_case, test_image_convert_BGR666);
 		tcase_add_test(test_case, test_image_convert_XBGR32);
 		tcase_add_test(test_case, test_image_convert_XRGB32);
+		tcase_add_test(test_case, test_image_convert_lut_all_values);
 
 		tcase_add_test(test_case, test_image_convert_YUYV);
 
@@ -639,6 +1347,23 @@ Suite* image_suite() {
 		tcase_add_test(test_case, test_image_convert_1byte_undersized);
 		tcase_add_test(test_case, test_image_convert_1byte_padding_undersized);
 
+		tcase_add_test(test_case, test_image_convert_yuv420);
+		tcase_add_test(test_case, test_image_convert_yuv420_to_rgb);
+		tcase_add_test(test_case, test_image_convert_yuv420_unsupported);
+		tcase_add_test(test_case, test_image_convert_planar_to_rgb);
+		tcase_add_test(test_case, test_image_convert_planar_to_yuv420);
+		tcase_add_test(test_case, test_image_converter);
+		tcase_add_test(test_case, test_image_convert_gray);
+		tcase_add_test(test_case, test_image_resize);
+		tcase_add_test(test_case, test_image_converter_output_size);
+
+		tcase_add_test(test_case, test_image_convert_mjpeg_to_rgb);
+		tcase_add_test(test_case, test_image_convert_mjpeg_to_yuv420);
+		tcase_add_test(test_case, test_image_convert_mjpeg_invalid);
+		tcase_add_test(test_case, test_image_convert_mjpeg_wrong_size);
+		tcase_add_test(test_case, test_image_convert_mjpeg_to_jpeg);
+		tcase_add_test(test_case, test_image_jpeg_header);
+
 		suite_add_tcase(suite, test_case);
 	}
 	{
@@ -646,6 +1371,9 @@ Suite* image_suite() {
 		tcase_add_test(test_case, test_image_diff_yuyv_same);
 		tcase_add_test(test_case, test_image_diff_yuyv_small_difference);
 		tcase_add_test(test_case, test_image_diff_yuyv_very_different);
+		tcase_add_test(test_case, test_image_diff_planar);
+		tcase_add_test(test_case, test_image_jpeg_luma);
+		tcase_add_test(test_case, test_image_luma_diff);
 		suite_add_tcase(suite, test_case);
 	}
 	return suite;
@@ -0,0 +1,139 @@
+#include "lib/name_template.h"
+#include "lib/global.h"
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/***********************
+ * test case: fields
+***********************/
+
+START_TEST(test_name_template_field) {
+	name_template_t name_template;
+	name_template_init( &name_template );
+	name_template_append( &name_template, "image" );
+	const uint counter = name_template_append_field( &name_template, 4 );
+	name_template_append( &name_template, ".ppm" );
+	ck_assert( name_template_is_valid( &name_template ) );
+	ck_assert_str_eq( name_template_str( &name_template ), "image0000.ppm" );
+	name_template_set( &name_template, counter, 42 );
+	ck_assert_str_eq( name_template_str( &name_template ), "image0042.ppm" );
+	ck_assert_uint_eq( name_template_length( &name_template ), strlen("image0042.ppm") );
+}
+END_TEST
+
+START_TEST(test_name_template_grow_shrink) {
+	name_template_t name_template;
+	name_template_init( &name_template );
+	name_template_append( &name_template, "image" );
+	const uint counter = name_template_append_field( &name_template, 4 );
+	name_template_append( &name_template, ".ppm" );
+	name_template_set( &name_template, counter, 9999 );
+	ck_assert_str_eq( name_template_str( &name_template ), "image9999.ppm" );
+	// one more digit:
+	name_template_set( &name_template, counter, 10000 );
+	ck_assert_str_eq( name_template_str( &name_template ), "image10000.ppm" );
+	ck_assert_uint_eq( name_template_length( &name_template ), strlen("image10000.ppm") );
+	// back to the minimum width:
+	name_template_set( &name_template, counter, 7 );
+	ck_assert_str_eq( name_template_str( &name_template ), "image0007.ppm" );
+	ck_assert_uint_eq( name_template_length( &name_template ), strlen("image0007.ppm") );
+	ck_assert( name_template_is_valid( &name_template ) );
+}
+END_TEST
+
+START_TEST(test_name_template_multiple_fields) {
+	name_template_t name_template;
+	name_template_init( &name_template );
+	name_template_append( &name_template, "pkg" );
+	const uint package = name_template_append_field( &name_template, 2 );
+	name_template_append( &name_template, "/" );
+	const uint time = name_template_append_time( &name_template );
+	name_template_append( &name_template, "_" );
+	const uint counter = name_template_append_field( &name_template, 3 );
+	ck_assert( name_template_is_valid( &name_template ) );
+	const timeval_t frame_time = { .tv_sec = 123, .tv_nsec = 45 * 1000 * 1000 };
+	name_template_set_time( &name_template, time, &frame_time );
+	name_template_set( &name_template, counter, 1 );
+	ck_assert_str_eq( name_template_str( &name_template ), "pkg00/123.045_001" );
+	// widening the first field moves all following ones:
+	name_template_set( &name_template, package, 12345 );
+	ck_assert_str_eq( name_template_str( &name_template ), "pkg12345/123.045_001" );
+	name_template_set( &name_template, counter, 2 );
+	ck_assert_str_eq( name_template_str( &name_template ), "pkg12345/123.045_002" );
+	name_template_set( &name_template, package, 3 );
+	name_template_set( &name_template, time, 4 );
+	ck_assert_str_eq( name_template_str( &name_template ), "pkg03/4.045_002" );
+	ck_assert_uint_eq( name_template_length( &name_template ), strlen("pkg03/4.045_002") );
+}
+END_TEST
+
+/***********************
+ * test case: overflow
+***********************/
+
+START_TEST(test_name_template_append_overflow) {
+	char text[STR_BUFFER_SIZE];
+	memset( text, 'x', STR_BUFFER_SIZE-1 );
+	text[STR_BUFFER_SIZE-1] = '\0';
+	name_template_t name_template;
+	name_template_init( &name_template );
+	name_template_append( &name_template, text );
+	ck_assert( name_template_is_valid( &name_template ) );
+	// (no space left for the terminating 0)
+	name_template_append( &name_template, "x" );
+	ck_assert( !name_template_is_valid( &name_template ) );
+	ck_assert_uint_eq( name_template_length( &name_template ), STR_BUFFER_SIZE-1 );
+	// too many fields:
+	name_template_init( &name_template );
+	for( uint i=0; i<NAME_TEMPLATE_MAX_FIELDS; i++ ) {
+		name_template_append_field( &name_template, 1 );
+	}
+	ck_assert( name_template_is_valid( &name_template ) );
+	name_template_append_field( &name_template, 1 );
+	ck_assert( !name_template_is_valid( &name_template ) );
+}
+END_TEST
+
+START_TEST(test_name_template_set_overflow) {
+	// the field can not grow beyond 'str':
+	char text[STR_BUFFER_SIZE];
+	const uint text_size = STR_BUFFER_SIZE - 4;
+	memset( text, 'x', text_size );
+	text[text_size] = '\0';
+	name_template_t name_template;
+	name_template_init( &name_template );
+	name_template_append( &name_template, "/" );
+	const uint counter = name_template_append_field( &name_template, 1 );
+	name_template_append( &name_template, text );
+	ck_assert( name_template_is_valid( &name_template ) );
+	ck_assert_uint_eq( name_template_length( &name_template ), STR_BUFFER_SIZE - 2 );
+	name_template_set( &name_template, counter, 123456789012 );
+	ck_assert( !name_template_is_valid( &name_template ) );
+	// the field keeps its width, the text after it is unchanged:
+	ck_assert_uint_eq( name_template_length( &name_template ), STR_BUFFER_SIZE - 2 );
+	ck_assert_uint_eq( strlen( name_template_str( &name_template ) ), STR_BUFFER_SIZE - 2 );
+	ck_assert_int_eq( name_template_str( &name_template )[1], '2' );
+	ck_assert_str_eq( &name_template_str( &name_template )[2], text );
+}
+END_TEST
+
+Suite* name_template_suite() {
+	Suite* suite = suite_create("name_template");
+	{
+		TCase* test_case = tcase_create("fields");
+		tcase_add_test(test_case, test_name_template_field);
+		tcase_add_test(test_case, test_name_template_grow_shrink);
+		tcase_add_test(test_case, test_name_template_multiple_fields);
+		suite_add_tcase(suite, test_case);
+	}
+	{
+		TCase* test_case = tcase_create("overflow");
+		tcase_add_test(test_case, test_name_template_append_overflow);
+		tcase_add_test(test_case, test_name_template_set_overflow);
+		suite_add_tcase(suite, test_case);
+	}
+	return suite;
+}
@@ -0,0 +1,178 @@
+#include "lib/ring_file.h"
+#include "lib/global.h"
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+#define CHECK_RING_FILE_SUCCESS( CALL ) \
+	if( CALL != RET_SUCCESS ) { \
+		ck_abort_msg( "'" #CALL "' failed" ); \
+	}
+
+#define TEST_RING_FILE_WIDTH 16
+#define TEST_RING_FILE_HEIGHT 16
+#define TEST_RING_FILE_SLOTS 8
+
+/***********************
+ * test case: reopen
+***********************/
+
+void test_ring_file_write(
+		ring_file_t* ring_file,
+		const uint64_t first_frame,
+		const uint count
+)
+{
+	byte_t frame[TEST_RING_FILE_WIDTH * TEST_RING_FILE_HEIGHT];
+	for( uint64_t i=first_frame; i<first_frame+count; i++ ) {
+		memset( frame, (byte_t )i, sizeof(frame) );
+		const timeval_t time = { .tv_sec = i, .tv_nsec = 0 };
+		CHECK_RING_FILE_SUCCESS( ring_file_write_frame(
+				ring_file,
+				i,
+				&time,
+				frame,
+				sizeof(frame)
+		) );
+	}
+}
+
+// every valid entry describes the frame in its slot:
+uint test_ring_file_check_entries(
+		const ring_file_t* ring_file
+)
+{
+	const ring_file_header_t* header = ring_file->header;
+	uint valid_count = 0;
+	for( uint64_t slot=0; slot<header->slot_count; slot++ ) {
+		const ring_file_index_entry_t* entry = &ring_file->index[slot];
+		if( entry->seq == 0 ) {
+			continue;
+		}
+		valid_count++;
+		// (frame i has been written with seq i+1)
+		ck_assert_uint_eq( entry->seq, entry->frame_number + 1 );
+		ck_assert_int_eq( entry->time_sec, entry->frame_number );
+		ck_assert_uint_eq( entry->frame_number % header->slot_count, slot );
+		const byte_t* data = ring_file->map + header->data_offset + slot * header->slot_size;
+		for( uint64_t i=0; i<header->frame_size; i++ ) {
+			ck_assert_uint_eq( data[i], (byte_t )entry->frame_number );
+		}
+	}
+	return valid_count;
+}
+
+void test_ring_file_path(
+		char* path
+)
+{
+	strcpy( path, "/tmp/test_ring_file_XXXXXX" );
+	int fd = mkstemp( path );
+	ck_assert_int_ne( fd, -1 );
+	close( fd );
+}
+
+START_TEST(test_ring_file_continue) {
+	char path[STR_BUFFER_SIZE];
+	test_ring_file_path( path );
+	ring_file_t ring_file;
+	CHECK_RING_FILE_SUCCESS( ring_file_init(
+			&ring_file,
+			path,
+			OUTPUT_FORMAT_GRAY,
+			TEST_RING_FILE_WIDTH, TEST_RING_FILE_HEIGHT,
+			TEST_RING_FILE_SLOTS
+	) );
+	ck_assert_uint_eq( ring_file.header->next_seq, 1 );
+	ck_assert_uint_eq( test_ring_file_check_entries( &ring_file ), 0 );
+	test_ring_file_write( &ring_file, 0, 5 );
+	CHECK_RING_FILE_SUCCESS( ring_file_exit( &ring_file ) );
+	// reopen:
+	CHECK_RING_FILE_SUCCESS( ring_file_init(
+			&ring_file,
+			path,
+			OUTPUT_FORMAT_GRAY,
+			TEST_RING_FILE_WIDTH, TEST_RING_FILE_HEIGHT,
+			TEST_RING_FILE_SLOTS
+	) );
+	ck_assert_uint_eq( ring_file.header->next_seq, 6 );
+	ck_assert_uint_eq( ring_file.header->next_slot, 5 );
+	ck_assert_uint_eq( test_ring_file_check_entries( &ring_file ), 5 );
+	// wrap around:
+	test_ring_file_write( &ring_file, 5, 10 );
+	CHECK_RING_FILE_SUCCESS( ring_file_exit( &ring_file ) );
+	CHECK_RING_FILE_SUCCESS( ring_file_init(
+			&ring_file,
+			path,
+			OUTPUT_FORMAT_GRAY,
+			TEST_RING_FILE_WIDTH, TEST_RING_FILE_HEIGHT,
+			TEST_RING_FILE_SLOTS
+	) );
+	ck_assert_uint_eq( ring_file.header->next_seq, 16 );
+	ck_assert_uint_eq( ring_file.header->next_slot, 15 % TEST_RING_FILE_SLOTS );
+	ck_assert_uint_eq( test_ring_file_check_entries( &ring_file ), TEST_RING_FILE_SLOTS );
+	CHECK_RING_FILE_SUCCESS( ring_file_exit( &ring_file ) );
+	// other geometry: start empty
+	CHECK_RING_FILE_SUCCESS( ring_file_init(
+			&ring_file,
+			path,
+			OUTPUT_FORMAT_GRAY,
+			TEST_RING_FILE_WIDTH, TEST_RING_FILE_HEIGHT / 2,
+			TEST_RING_FILE_SLOTS
+	) );
+	ck_assert_uint_eq( ring_file.header->next_seq, 1 );
+	ck_assert_uint_eq( ring_file.header->next_slot, 0 );
+	CHECK_RING_FILE_SUCCESS( ring_file_exit( &ring_file ) );
+	unlink( path );
+}
+END_TEST
+
+// the index in the file never refers
+// to slots that are about to be overwritten:
+START_TEST(test_ring_file_index_on_disk) {
+	char path[STR_BUFFER_SIZE];
+	test_ring_file_path( path );
+	ring_file_t ring_file;
+	CHECK_RING_FILE_SUCCESS( ring_file_init(
+			&ring_file,
+			path,
+			OUTPUT_FORMAT_GRAY,
+			TEST_RING_FILE_WIDTH, TEST_RING_FILE_HEIGHT,
+			TEST_RING_FILE_SLOTS
+	) );
+	const uint batch_size = ring_file.batch_size;
+	ck_assert_uint_lt( 2 * batch_size, TEST_RING_FILE_SLOTS );
+	for( uint64_t frame=0; frame<3 * TEST_RING_FILE_SLOTS; frame++ ) {
+		const ring_file_header_t* file_header = (const ring_file_header_t* )ring_file.map;
+		const ring_file_index_entry_t* file_index = (const ring_file_index_entry_t* )(ring_file.map + sizeof(ring_file_header_t));
+		// the index in the file lags behind by less than one batch:
+		ck_assert_uint_le( ring_file.header->next_seq - file_header->next_seq, batch_size - 1 );
+		// the slot written next is not referenced:
+		ck_assert_uint_eq( file_index[ ring_file.header->next_slot ].seq, 0 );
+		// valid entries in the file are valid in memory:
+		for( uint64_t slot=0; slot<TEST_RING_FILE_SLOTS; slot++ ) {
+			if( file_index[slot].seq != 0 ) {
+				ck_assert_uint_eq( file_index[slot].seq, ring_file.index[slot].seq );
+			}
+		}
+		test_ring_file_write( &ring_file, frame, 1 );
+	}
+	CHECK_RING_FILE_SUCCESS( ring_file_exit( &ring_file ) );
+	unlink( path );
+}
+END_TEST
+
+Suite* ring_file_suite() {
+	Suite* suite = suite_create("ring_file");
+	{
+		TCase* test_case = tcase_create("reopen");
+		tcase_add_test(test_case, test_ring_file_continue);
+		tcase_add_test(test_case, test_ring_file_index_on_disk);
+		suite_add_tcase(suite, test_case);
+	}
+	return suite;
+}
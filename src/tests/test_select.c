@@ -0,0 +1,304 @@
+// (the tick estimators are internal to select)
+#include "exe/synchronome/select.c"
+#include "lib/global.h"
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+
+#define TEST_SELECT_ACQ_INTERVAL 0.1
+#define TEST_SELECT_START_SEC 100
+
+/***********************
+ * test case: estimate_tick_time
+***********************/
+
+// diffs sampled from a parabola with its
+// vertex 'offset' frames from the peak diff:
+void test_select_push_tick_diffs(
+		diff_statistics_t* diff_statistics,
+		const float offset
+)
+{
+	for( int x=-1; x<=1; x++ ) {
+		float* dst = NULL;
+		diff_buffer_push_start( &diff_statistics->diff_buffer, &dst );
+		(*dst) = 10 - 4 * (x - offset) * (x - offset);
+		diff_buffer_push_end( &diff_statistics->diff_buffer );
+	}
+}
+
+void test_select_push_diff(
+		diff_statistics_t* diff_statistics,
+		const float diff
+)
+{
+	float* dst = NULL;
+	diff_buffer_push_start( &diff_statistics->diff_buffer, &dst );
+	(*dst) = diff;
+	diff_buffer_push_end( &diff_statistics->diff_buffer );
+}
+
+START_TEST(test_select_estimate_tick_offset) {
+	const float offsets[] = { -0.45, -0.25, 0, 0.1, 0.3, 0.5 };
+	const timeval_t tick_frame_time = { .tv_sec = TEST_SELECT_START_SEC, .tv_nsec = 0 };
+	for( uint i=0; i<sizeof(offsets)/sizeof(offsets[0]); i++ ) {
+		diff_statistics_t diff_statistics = { 0 };
+		diff_buffer_init( &diff_statistics.diff_buffer, diff_buffer_max_count );
+		for( uint j=0; j<5; j++ ) {
+			test_select_push_diff( &diff_statistics, 1 );
+		}
+		test_select_push_tick_diffs( &diff_statistics, offsets[i] );
+		const tick_measurement_t measurement = estimate_tick_time(
+				tick_frame_time,
+				TEST_SELECT_ACQ_INTERVAL,
+				&diff_statistics
+		);
+		ck_assert( measurement.valid );
+		ck_assert_double_eq_tol( measurement.frame_time, TEST_SELECT_START_SEC, 1e-9 );
+		// offset 0: in the middle between the two frames:
+		ck_assert_double_eq_tol(
+				measurement.tick_time,
+				TEST_SELECT_START_SEC - TEST_SELECT_ACQ_INTERVAL * (0.5 - offsets[i]),
+				1e-6
+		);
+		diff_buffer_exit( &diff_statistics.diff_buffer );
+	}
+}
+END_TEST
+
+START_TEST(test_select_estimate_tick_limits) {
+	const timeval_t tick_frame_time = { .tv_sec = TEST_SELECT_START_SEC, .tv_nsec = 0 };
+	diff_statistics_t diff_statistics = { 0 };
+	diff_buffer_init( &diff_statistics.diff_buffer, diff_buffer_max_count );
+	// too few diffs (right after the bootstrap burst):
+	test_select_push_diff( &diff_statistics, 1 );
+	test_select_push_diff( &diff_statistics, 10 );
+	tick_measurement_t measurement = estimate_tick_time(
+			tick_frame_time,
+			TEST_SELECT_ACQ_INTERVAL,
+			&diff_statistics
+	);
+	ck_assert( !measurement.valid );
+	test_select_push_diff( &diff_statistics, 0 );
+	measurement = estimate_tick_time(
+			tick_frame_time,
+			TEST_SELECT_ACQ_INTERVAL,
+			&diff_statistics
+	);
+	ck_assert( measurement.valid );
+	// vertex outside the frame interval: clamped
+	test_select_push_diff( &diff_statistics, 12 );
+	test_select_push_diff( &diff_statistics, 10 );
+	test_select_push_diff( &diff_statistics, 0 );
+	measurement = estimate_tick_time(
+			tick_frame_time,
+			TEST_SELECT_ACQ_INTERVAL,
+			&diff_statistics
+	);
+	ck_assert( measurement.valid );
+	ck_assert_double_eq_tol( measurement.tick_time, TEST_SELECT_START_SEC - TEST_SELECT_ACQ_INTERVAL, 1e-6 );
+	// no peak: in the middle
+	test_select_push_diff( &diff_statistics, 5 );
+	test_select_push_diff( &diff_statistics, 5 );
+	test_select_push_diff( &diff_statistics, 5 );
+	measurement = estimate_tick_time(
+			tick_frame_time,
+			TEST_SELECT_ACQ_INTERVAL,
+			&diff_statistics
+	);
+	ck_assert( measurement.valid );
+	ck_assert_double_eq_tol( measurement.tick_time, TEST_SELECT_START_SEC - TEST_SELECT_ACQ_INTERVAL / 2, 1e-6 );
+	diff_buffer_exit( &diff_statistics.diff_buffer );
+}
+END_TEST
+
+/***********************
+ * test case: pll
+***********************/
+
+void test_select_dump_frame(
+		void* context,
+		frame_buffer_t frame
+)
+{
+	(void )context;
+	(void )frame;
+}
+
+timeval_t test_select_frame_time(
+		const uint frame
+)
+{
+	const uint64_t ns = (uint64_t )frame * (uint64_t )(TEST_SELECT_ACQ_INTERVAL * 1000 * 1000 * 1000 + 0.5);
+	return (timeval_t){
+		.tv_sec = TEST_SELECT_START_SEC + ns / (1000 * 1000 * 1000),
+		.tv_nsec = ns % (1000 * 1000 * 1000),
+	};
+}
+
+// feed the PLL a tick sequence with a period
+// off by 'drift' from the nominal one.
+// Measured tick times are off by up to
+// a tenth of a frame (as from 'estimate_tick_time'),
+// some ticks may not be detected at all.
+// Every tick interval must be selected once,
+// by a frame inside the interval:
+void test_select_pll_run(
+		const uint frames_per_tick,
+		const double drift,
+		const double first_tick, // in frames
+		const uint missed_tick // every n-th tick is not detected (0: none)
+)
+{
+	const double acq_interval = TEST_SELECT_ACQ_INTERVAL;
+	const double clock_tick_interval = frames_per_tick * acq_interval;
+	const double tick_period = clock_tick_interval * (1 + drift);
+	const double tick_start = TEST_SELECT_START_SEC + first_tick * acq_interval;
+	const uint tick_count = 400;
+	const uint frame_count = tick_count * tick_period / acq_interval;
+	uint max_frame_acc_count;
+	ck_assert_int_eq( select_get_frame_acc_count(
+			acq_interval,
+			clock_tick_interval,
+			TICK_ESTIMATOR_PLL,
+			&max_frame_acc_count
+	), RET_SUCCESS );
+	frame_window_t frame_window;
+	select_queue_t output_queue;
+	const uint buffer_count = max_frame_acc_count + 2;
+	frame_window_init( &frame_window, max_frame_acc_count, buffer_count, test_select_dump_frame, NULL );
+	select_queue_init( &output_queue, 2 );
+	pll_state_t state = { 0 };
+	bool synced = false;
+	int last_tick = -1;
+	bool prev_tick_detected = false;
+	double prev_tick_time = 0;
+	int last_interval = -1;
+	for( uint frame=0; frame<frame_count; frame++ ) {
+		const acq_entry_t entry = {
+			.time = test_select_frame_time( frame ),
+			.frame = { .data = NULL, .index = frame % buffer_count, .size = 0 },
+			.bootstrap = false,
+		};
+		frame_window_push( &frame_window, &entry );
+		const uint frame_acc_count = frame_window_get_count( &frame_window );
+		const double time = time_sec_from_timespec( &entry.time );
+		// a tick between the previous and this frame?
+		const int tick = floor( (time - tick_start) / tick_period );
+		const double tick_time = tick_start + tick * tick_period;
+		const bool tick_detected =
+			frame > 0
+			&& tick >= 0
+			&& tick > last_tick
+			&& !(missed_tick > 0 && tick % missed_tick == missed_tick - 1);
+		last_tick = tick;
+		// measured one frame later:
+		tick_measurement_t measurement = { .valid = false };
+		if( prev_tick_detected ) {
+			const double frame_time = time - acq_interval;
+			const double error = acq_interval * ((int )(frame * 7 % 5) - 2) / 20;
+			measurement = (tick_measurement_t){
+				.valid = true,
+				.frame_time = frame_time,
+				.tick_time = MAX( frame_time - acq_interval, MIN( frame_time, prev_tick_time + error ) ),
+			};
+		}
+		prev_tick_detected = tick_detected;
+		prev_tick_time = tick_time;
+		if( !synced ) {
+			if( tick_detected ) {
+				pll_tick_parser_init( entry.time, acq_interval, clock_tick_interval, &state );
+				synced = true;
+			}
+			continue;
+		}
+		ck_assert_int_eq( pll_tick_parser(
+				entry.time,
+				acq_interval,
+				clock_tick_interval,
+				&measurement,
+				frame_acc_count,
+				-1,
+				&state,
+				&frame_window,
+				&output_queue
+		), 0 );
+		while( select_queue_get_count( &output_queue ) > 0 ) {
+			select_queue_read_start( &output_queue );
+			select_entry_t* selected = select_queue_read_get( &output_queue );
+			const double selected_time = time_sec_from_timespec( &selected->time );
+			const int interval = floor( (selected_time - tick_start) / tick_period );
+			ck_assert_msg( interval == last_interval + 1,
+					"%u frames per tick, drift %+.3f: frame %.3fs selected in tick interval %d, expected %d",
+					frames_per_tick,
+					drift,
+					selected_time,
+					interval,
+					last_interval + 1
+			);
+			last_interval = interval;
+			frame_window_unpin( &frame_window, &selected->frame );
+			select_queue_read_stop_dump( &output_queue );
+		}
+	}
+	// (the last intervals are selected after the loop)
+	ck_assert_int_ge( last_interval, (int )tick_count - 3 );
+	select_queue_exit( &output_queue );
+	frame_window_exit( &frame_window );
+}
+
+// phase of the first tick between two frames:
+const double test_select_pll_phases[] = { 0.05, 0.3, 0.5, 0.7, 0.95 };
+
+START_TEST(test_select_pll_2_frames_per_tick) {
+	for( uint i=0; i<sizeof(test_select_pll_phases)/sizeof(test_select_pll_phases[0]); i++ ) {
+		test_select_pll_run( 2, 0, test_select_pll_phases[i], 0 );
+		test_select_pll_run( 2, +0.005, test_select_pll_phases[i], 0 );
+		test_select_pll_run( 2, -0.005, test_select_pll_phases[i], 0 );
+	}
+}
+END_TEST
+
+START_TEST(test_select_pll_3_frames_per_tick) {
+	for( uint i=0; i<sizeof(test_select_pll_phases)/sizeof(test_select_pll_phases[0]); i++ ) {
+		test_select_pll_run( 3, 0, test_select_pll_phases[i], 0 );
+		test_select_pll_run( 3, +0.02, test_select_pll_phases[i], 0 );
+		test_select_pll_run( 3, -0.02, test_select_pll_phases[i], 0 );
+	}
+}
+END_TEST
+
+// a tick below the threshold must not
+// make the PLL lose track:
+START_TEST(test_select_pll_missed_ticks) {
+	for( uint i=0; i<sizeof(test_select_pll_phases)/sizeof(test_select_pll_phases[0]); i++ ) {
+		test_select_pll_run( 2, 0, test_select_pll_phases[i], 37 );
+		test_select_pll_run( 2, +0.005, test_select_pll_phases[i], 37 );
+		test_select_pll_run( 2, -0.005, test_select_pll_phases[i], 37 );
+		test_select_pll_run( 3, 0, test_select_pll_phases[i], 37 );
+		test_select_pll_run( 3, +0.02, test_select_pll_phases[i], 37 );
+		test_select_pll_run( 3, -0.02, test_select_pll_phases[i], 37 );
+	}
+}
+END_TEST
+
+Suite* select_suite() {
+	Suite* suite = suite_create("select");
+	{
+		TCase* test_case = tcase_create("estimate_tick_time");
+		tcase_add_test(test_case, test_select_estimate_tick_offset);
+		tcase_add_test(test_case, test_select_estimate_tick_limits);
+		suite_add_tcase(suite, test_case);
+	}
+	{
+		TCase* test_case = tcase_create("pll");
+		tcase_add_test(test_case, test_select_pll_2_frames_per_tick);
+		tcase_add_test(test_case, test_select_pll_3_frames_per_tick);
+		tcase_add_test(test_case, test_select_pll_missed_ticks);
+		suite_add_tcase(suite, test_case);
+	}
+	return suite;
+}